@@ -4,29 +4,22 @@
 #ifndef ALU_H
 #define ALU_H
 
+#include "isa.h"
+
 /**** ALU_WORD0 ****/
-#define ALU_WORD0_SRC0_SEL_POS				0
-#define ALU_WORD0_SRC0_REL_POS				9
-#define ALU_WORD0_SRC0_CHAN_POS				10
-#define ALU_WORD0_SRC0_NEG_POS				12
-#define ALU_WORD0_SRC1_SEL_POS				13
-#define ALU_WORD0_SRC1_REL_POS				22
-#define ALU_WORD0_SRC1_CHAN_POS				23
-#define ALU_WORD0_SRC1_NEG_POS				25
-#define ALU_WORD0_INDEX_MODE_POS			26
-#define ALU_WORD0_PRED_SEL_POS				29
-#define ALU_WORD0_LAST_POS				31
-#define ALU_WORD0_SRC0_SEL_BITS				9
-#define ALU_WORD0_SRC0_REL_BITS				1
-#define ALU_WORD0_SRC0_CHAN_BITS			2
-#define ALU_WORD0_SRC0_NEG_BITS				1
-#define ALU_WORD0_SRC1_SEL_BITS				9
-#define ALU_WORD0_SRC1_REL_BITS				1
-#define ALU_WORD0_SRC1_CHAN_BITS			2
-#define ALU_WORD0_SRC1_NEG_BITS				1
-#define ALU_WORD0_INDEX_MODE_BITS			3
-#define ALU_WORD0_PRED_SEL_BITS				2
-#define ALU_WORD0_LAST_BITS				1
+#define ALU_WORD0_FIELDS(X, a)							\
+	X(a, ALU_WORD0, SRC0_SEL, src0_sel, 0, 9)				\
+	X(a, ALU_WORD0, SRC0_REL, src0_rel, 9, 1)				\
+	X(a, ALU_WORD0, SRC0_CHAN, src0_chan, 10, 2)				\
+	X(a, ALU_WORD0, SRC0_NEG, src0_neg, 12, 1)				\
+	X(a, ALU_WORD0, SRC1_SEL, src1_sel, 13, 9)				\
+	X(a, ALU_WORD0, SRC1_REL, src1_rel, 22, 1)				\
+	X(a, ALU_WORD0, SRC1_CHAN, src1_chan, 23, 2)				\
+	X(a, ALU_WORD0, SRC1_NEG, src1_neg, 25, 1)				\
+	X(a, ALU_WORD0, INDEX_MODE, index_mode, 26, 3)				\
+	X(a, ALU_WORD0, PRED_SEL, pred_sel, 29, 2)				\
+	X(a, ALU_WORD0, LAST, last, 31, 1)
+enum { ALU_WORD0_FIELDS(ISA_CONSTS, ) };
 
 #define INDEX_AR_X					0
 #define INDEX_LOOP					4
@@ -41,42 +34,33 @@
 #define ALU_SRC_PARAM_BASE				0x1c0
 
 /**** ALU_WORD1_OP2 ****/
-#define ALU_WORD1_OP2_SRC0_ABS_POS			0
-#define ALU_WORD1_OP2_SRC1_ABS_POS			1
-#define ALU_WORD1_OP2_UPDATE_EXEC_MASK_POS		2
-#define ALU_WORD1_OP2_UPDATE_PRED_POS			3
-#define ALU_WORD1_OP2_WRITE_ENABLE_POS			4
-#define ALU_WORD1_OP2_OUT_MOD_POS			5
-#define ALU_WORD1_OP2_SRC0_ABS_BITS			1
-#define ALU_WORD1_OP2_SRC1_ABS_BITS			1
-#define ALU_WORD1_OP2_UPDATE_EXEC_MASK_BITS		1
-#define ALU_WORD1_OP2_UPDATE_PRED_BITS			1
-#define ALU_WORD1_OP2_WRITE_ENABLE_BITS			1
-#define ALU_WORD1_OP2_OUT_MOD_BITS			2
+#define ALU_WORD1_OP2_FIELDS(X, a)						\
+	X(a, ALU_WORD1_OP2, SRC0_ABS, src0_abs, 0, 1)				\
+	X(a, ALU_WORD1_OP2, SRC1_ABS, src1_abs, 1, 1)				\
+	X(a, ALU_WORD1_OP2, UPDATE_EXEC_MASK, update_exec_mask, 2, 1)		\
+	X(a, ALU_WORD1_OP2, UPDATE_PRED, update_pred, 3, 1)			\
+	X(a, ALU_WORD1_OP2, WRITE_ENABLE, write_enable, 4, 1)			\
+	X(a, ALU_WORD1_OP2, OUT_MOD, omod, 5, 2)
+enum { ALU_WORD1_OP2_FIELDS(ISA_CONSTS, ) };
 
 /**** ALU_WORD1_OP3 ****/
-#define ALU_WORD1_OP3_SRC2_SEL_POS			0
-#define ALU_WORD1_OP3_SRC2_REL_POS			9
-#define ALU_WORD1_OP3_SRC2_CHAN_POS			10
-#define ALU_WORD1_OP3_SRC2_NEG_POS			12
-#define ALU_WORD1_OP3_SRC2_SEL_BITS			9
-#define ALU_WORD1_OP3_SRC2_REL_BITS			1
-#define ALU_WORD1_OP3_SRC2_CHAN_BITS			2
-#define ALU_WORD1_OP3_SRC2_NEG_BITS			1
+#define ALU_WORD1_OP3_FIELDS(X, a)						\
+	X(a, ALU_WORD1_OP3, SRC2_SEL, src2_sel, 0, 9)				\
+	X(a, ALU_WORD1_OP3, SRC2_REL, src2_rel, 9, 1)				\
+	X(a, ALU_WORD1_OP3, SRC2_CHAN, src2_chan, 10, 2)			\
+	X(a, ALU_WORD1_OP3, SRC2_NEG, src2_neg, 12, 1)
+enum { ALU_WORD1_OP3_FIELDS(ISA_CONSTS, ) };
 
 /**** ALU_WORD1 ****/
-#define ALU_WORD1_INST_POS				7
-#define ALU_WORD1_BANK_SWIZZLE_POS			18
-#define ALU_WORD1_DST_GPR_POS				21
-#define ALU_WORD1_DST_REL_POS				28
-#define ALU_WORD1_DST_CHAN_POS				29
-#define ALU_WORD1_CLAMP_POS				31
-#define ALU_WORD1_INST_BITS				11
-#define ALU_WORD1_BANK_SWIZZLE_BITS			3
-#define ALU_WORD1_DST_GPR_BITS				7
-#define ALU_WORD1_DST_REL_BITS				1
-#define ALU_WORD1_DST_CHAN_BITS				2
-#define ALU_WORD1_CLAMP_BITS				1
+/* OP2 or OP3, and then these. */
+#define ALU_WORD1_FIELDS(X, a)							\
+	X(a, ALU_WORD1, INST, alu_inst, 7, 11)					\
+	X(a, ALU_WORD1, BANK_SWIZZLE, bank_swizzle, 18, 3)			\
+	X(a, ALU_WORD1, DST_GPR, dst_gpr, 21, 7)				\
+	X(a, ALU_WORD1, DST_REL, dst_rel, 28, 1)				\
+	X(a, ALU_WORD1, DST_CHAN, dst_chan, 29, 2)				\
+	X(a, ALU_WORD1, CLAMP, clamp, 31, 1)
+enum { ALU_WORD1_FIELDS(ISA_CONSTS, ) };
 
 #define ALU_INST_INTERP_XY				214
 #define ALU_INST_INTERP_ZW				215
@@ -89,41 +73,18 @@
 
 
 struct inst_alu_w0 {
-	int				src0_sel;
-	int				src0_rel;
-	int				src0_chan;
-	int				src0_neg;
-	int				src1_sel;
-	int				src1_rel;
-	int				src1_chan;
-	int				src1_neg;
-	int				index_mode;
-	int				pred_sel;
-	int				last;
+	ALU_WORD0_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_alu_w1 {
 	/* Only in op2 */
-	int				src0_abs;
-	int				src1_abs;
-	int				update_exec_mask;
-	int				update_pred;
-	int				write_enable;
-	int				omod;
+	ALU_WORD1_OP2_FIELDS(ISA_MEMBER, )
 
 	/* Only in op3. */
-	int				src2_sel;
-	int				src2_rel;
-	int				src2_chan;
-	int				src2_neg;
+	ALU_WORD1_OP3_FIELDS(ISA_MEMBER, )
 
 	/* In op2 and op3 */
-	int				alu_inst;
-	int				bank_swizzle;
-	int				dst_gpr;
-	int				dst_rel;
-	int				dst_chan;
-	int				clamp;
+	ALU_WORD1_FIELDS(ISA_MEMBER, )
 };
 
 /* Instructions */
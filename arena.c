@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bits.h"
+#include "arena.h"
+
+static
+struct arena_chunk *arena_new_chunk(struct arena *this, size_t size)
+{
+	struct arena_chunk *c, **pc;
+
+	if (size < ARENA_CHUNK_SIZE)
+		size = ARENA_CHUNK_SIZE;
+
+	/* data, too, is aligned; sizeof(*c) is a multiple of it. */
+	size = align_up(size, ARENA_ALIGN);
+	c = aligned_alloc(1 << ARENA_ALIGN, sizeof(*c) + size);
+	if (c == NULL)
+		return NULL;
+	c->next = NULL;
+	c->size = size;
+	c->used = 0;
+
+	/* Append, so that a reset arena reuses the chunks in order. */
+	for (pc = &this->head; *pc; pc = &(*pc)->next)
+		;
+	*pc = c;
+	return c;
+}
+
+void *arena_alloc(struct arena *this, size_t size)
+{
+	struct arena_chunk *c;
+	void *p;
+
+	size = align_up(size, ARENA_ALIGN);
+
+	/* Skip the chunks, left from before a reset, that are too small. */
+	for (c = this->curr; c; c = c->next) {
+		if (c->size - c->used >= size)
+			break;
+	}
+
+	if (c == NULL) {
+		c = arena_new_chunk(this, size);
+		if (c == NULL)
+			return NULL;
+	}
+
+	p = &c->data[c->used];
+	c->used += size;
+	this->curr = c;
+	this->last = p;
+	return p;
+}
+
+/* The most recent allocation grows in place, if there is room. */
+void *arena_realloc(struct arena *this, void *p, size_t old_size,
+		    size_t new_size)
+{
+	struct arena_chunk *c;
+	void *q;
+
+	c = this->curr;
+	old_size = align_up(old_size, ARENA_ALIGN);
+	if (p && p == this->last && new_size >= old_size &&
+	    c->size - c->used >= align_up(new_size, ARENA_ALIGN) - old_size) {
+		c->used += align_up(new_size, ARENA_ALIGN) - old_size;
+		return p;
+	}
+
+	q = arena_alloc(this, new_size);
+	if (q && p)
+		memcpy(q, p, old_size < new_size ? old_size : new_size);
+	return q;
+}
+
+void arena_reset(struct arena *this)
+{
+	struct arena_chunk *c;
+
+	for (c = this->head; c; c = c->next)
+		c->used = 0;
+	this->curr = this->head;
+	this->last = NULL;
+}
+
+void arena_destruct(struct arena *this)
+{
+	struct arena_chunk *c, *n;
+
+	for (c = this->head; c; c = n) {
+		n = c->next;
+		free(c);
+	}
+	arena_construct(this);
+}
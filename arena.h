@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#define ARENA_CHUNK_SIZE		(1024 * 1024)
+#define ARENA_ALIGN			4	/* Bit position; 16 bytes. */
+
+struct arena_chunk {
+	struct arena_chunk		*next;
+	size_t				size;
+	size_t				used;
+	_Alignas(1 << ARENA_ALIGN) char	data[];
+};
+
+/*
+ * Bump allocator. Nothing is freed individually; arena_reset releases every
+ * allocation at once but keeps the chunks, so that a reused arena stops
+ * calling malloc once it has grown to the size of the largest run.
+ */
+struct arena {
+	struct arena_chunk		*head;
+	struct arena_chunk		*curr;
+	void				*last;	/* Most recent allocation */
+};
+
+static inline
+void arena_construct(struct arena *this)
+{
+	this->head = this->curr = NULL;
+	this->last = NULL;
+}
+
+void	*arena_alloc(struct arena *this, size_t size);
+void	*arena_realloc(struct arena *this, void *p, size_t old_size,
+		       size_t new_size);
+void	arena_reset(struct arena *this);
+void	arena_destruct(struct arena *this);
+#endif
@@ -1 +1,3 @@
-cc -O3 -Wall -Wextra -Wpedantic main.c cf.c vtx.c alu.c tex.c -g
+cc -O3 -Wall -Wextra -Wpedantic -c egasm.c par.c pipe.c inc.c cache.c memo.c isa.c soa.c dis.c cf.c vtx.c alu.c tex.c sym.c kw.c scan.c arena.c -g
+ar rcs libegasm.a egasm.o par.o pipe.o inc.o cache.o memo.o isa.o soa.o dis.o cf.o vtx.o alu.o tex.o sym.o kw.o scan.o arena.o
+cc -O3 -Wall -Wextra -Wpedantic main.c batch.c stream.c watch.c serve.c uring.c out.c dump.c libegasm.a -lpthread -g
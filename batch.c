@@ -0,0 +1,761 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <linux/stat.h>
+
+#include "main.h"
+#include "cli.h"
+#include "uring.h"
+
+#define BATCH_IO_DEPTH			8	/* Inputs in flight, per worker */
+#define BATCH_IO_BUF_SIZE		(256 * 1024)	/* Of each fixed buffer */
+
+/* The requests of a slot, in turn; in the low bits of their user_data. */
+enum batch_io_op {
+	BATCH_IO_STAT,
+	BATCH_IO_OPEN,
+	BATCH_IO_READ,
+};
+
+/*
+ * An input on its way in through the ring; job is -1 if the slot is free. An
+ * input that the ring fails to read, for any reason, is read the usual way.
+ */
+struct batch_slot {
+	struct statx			stx;
+	char				*buf;
+	size_t				size;
+	size_t				done;	/* Read so far */
+	int				job;
+	int				fd;
+	int				pending;	/* Requests in flight */
+	int				err;
+	bool				fixed;	/* buf is registered */
+	bool				ready;
+};
+
+struct batch_job {
+	const char			*path;
+	size_t				size;	/* Of the input */
+	int				err;
+};
+
+/*
+ * The jobs not yet taken by a worker; [head, tail) of batch.jobs. The owner
+ * takes from the head. A thief takes the back half, and makes it its own.
+ */
+struct batch_deque {
+	pthread_mutex_t			lock;
+	int				head;
+	int				tail;
+};
+
+struct batch;
+struct batch_worker {
+	struct batch			*b;
+	struct batch_deque		dq;
+
+	/* Reset, not freed, between the jobs. */
+	struct asm_base			as;
+	struct memo			memo;
+	struct out_buf			out;	/* For hex; made on first use */
+	bool				has_out;
+
+	/* The inputs are read through the ring, where there is one. */
+	struct uring			ring;
+	struct batch_slot		slots[BATCH_IO_DEPTH];
+	char				*fixed;	/* Registered; one per slot */
+	int				num_busy;
+	bool				has_ring;
+	bool				lost;	/* Requests left in flight */
+
+	pthread_t			thread;
+	int				id;
+	int				num_steals;
+};
+
+struct batch {
+	const struct cli_opts		*opts;
+	struct cache			*cache;		/* -c, if set */
+	struct batch_job		*jobs;
+	struct batch_worker		*workers;
+	int				num_jobs;
+	int				num_workers;
+};
+
+static
+int batch_worker_pop(struct batch_worker *this)
+{
+	int j;
+
+	j = -1;
+	pthread_mutex_lock(&this->dq.lock);
+	if (this->dq.head < this->dq.tail)
+		j = this->dq.head++;
+	pthread_mutex_unlock(&this->dq.lock);
+	return j;
+}
+
+/* Only one lock is held at a time. Returns -1 once every deque is empty. */
+static
+int batch_worker_steal(struct batch_worker *this)
+{
+	int i, n, head, tail;
+	struct batch *b;
+	struct batch_deque *dq;
+
+	b = this->b;
+	for (i = 1; i < b->num_workers; ++i) {
+		dq = &b->workers[(this->id + i) % b->num_workers].dq;
+
+		pthread_mutex_lock(&dq->lock);
+		n = dq->tail - dq->head;
+		tail = dq->tail;
+		head = tail - (n + 1) / 2;
+		if (n > 0)
+			dq->tail = head;
+		pthread_mutex_unlock(&dq->lock);
+		if (n <= 0)
+			continue;
+
+		/* Keep the first for now, and the rest for the thieves. */
+		pthread_mutex_lock(&this->dq.lock);
+		this->dq.head = head + 1;
+		this->dq.tail = tail;
+		pthread_mutex_unlock(&this->dq.lock);
+		++this->num_steals;
+		return head;
+	}
+	return -1;
+}
+
+/* outdir/name.out, for .../name.s; .bin or .h for the other formats. */
+static
+int batch_out_path(const char *dir, const char *path, const char *ext,
+		   char *out, size_t size)
+{
+	int len, ret;
+	const char *name;
+
+	name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	len = strlen(name);
+	if (len > 2 && !strcmp(&name[len - 2], ".s"))
+		len -= 2;
+
+	ret = snprintf(out, size, "%s/%.*s%s", dir, len, name, ext);
+	if (ret < 0 || (size_t)ret >= size)
+		return ENAMETOOLONG;
+	return 0;
+}
+
+/*
+ * The assembled input, or, with cached_fd >= 0, the cache entry of an input
+ * seen before. Through a new cache entry, if key is set.
+ */
+static
+int batch_worker_write(struct batch_worker *this, const char *path,
+		       const struct cache_key *key, int cached_fd,
+		       size_t cached_size)
+{
+	int fd, err;
+	char out[PATH_MAX];
+	const struct cli_opts *opts;
+
+	opts = this->b->opts;
+	if (opts->fmt == OUT_HEX && !this->has_out && cached_fd < 0) {
+		err = out_buf_construct(&this->out);
+		if (err)
+			return err;
+		this->has_out = true;
+	}
+
+	err = batch_out_path(opts->out_dir, path, out_fmt_ext(opts->fmt), out,
+			     sizeof(out));
+	if (err)
+		return err;
+
+	fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return errno;
+
+	if (cached_fd >= 0)
+		err = cache_copy(cached_fd, fd, cached_size);
+	else if (key)
+		err = out_write_cache(this->b->cache, key, &this->out, fd,
+				      opts->fmt, &this->as, 1);
+	else
+		err = out_write(&this->out, fd, opts->fmt, &this->as, 1);
+	if (close(fd) && !err)
+		err = errno;
+	if (err)
+		unlink(out);
+	return err;
+}
+
+/* Assemble the input of job j, as read into buf, and write its output. */
+static
+void batch_worker_assemble(struct batch_worker *this, int j, const char *buf,
+			   size_t size)
+{
+	int fd, err;
+	size_t cached_size;
+	struct batch_job *job;
+	struct egasm_diag diag;
+	struct cache_key key;
+
+	job = &this->b->jobs[j];
+	job->size = size;
+
+	if (this->b->cache) {
+		out_cache_key(buf, size, this->b->opts->fmt, &key);
+		if (cache_open(this->b->cache, &key, &fd, &cached_size) == 0) {
+			err = batch_worker_write(this, job->path, NULL, fd,
+						 cached_size);
+			close(fd);
+			goto done;
+		}
+	}
+
+	asm_base_reset(&this->as, buf, size);
+	err = asm_base_assemble(&this->as, &diag);
+	if (err) {
+		printf("%s:%d: %s err %d, i = %zx, inst = %d\n", job->path,
+		       diag.line, diag.stage, err, diag.pos, diag.inst);
+		job->err = err;
+		return;
+	}
+	err = batch_worker_write(this, job->path, this->b->cache ? &key : NULL,
+				 -1, 0);
+done:
+	if (err)
+		printf("%s: %s\n", job->path, strerror(err));
+	job->err = err;
+}
+
+static
+void batch_worker_do(struct batch_worker *this, int j)
+{
+	int err;
+	struct batch_job *job;
+	struct input in;
+
+	job = &this->b->jobs[j];
+	err = input_open(&in, job->path);
+	if (err) {
+		printf("%s: %s\n", job->path, strerror(err));
+		job->err = err;
+		return;
+	}
+	batch_worker_assemble(this, j, in.buf, in.size);
+	input_close(&in);
+}
+
+/* Without a ring, or without registered buffers, if either fails. */
+static
+void batch_worker_ring_construct(struct batch_worker *this)
+{
+	int i;
+	struct iovec iov[BATCH_IO_DEPTH];
+
+	for (i = 0; i < BATCH_IO_DEPTH; ++i)
+		this->slots[i].job = -1;
+	if (uring_construct(&this->ring, BATCH_IO_DEPTH))
+		return;
+	this->has_ring = true;
+
+	this->fixed = malloc(BATCH_IO_DEPTH * BATCH_IO_BUF_SIZE);
+	if (this->fixed == NULL)
+		return;
+	for (i = 0; i < BATCH_IO_DEPTH; ++i) {
+		iov[i].iov_base = &this->fixed[i * BATCH_IO_BUF_SIZE];
+		iov[i].iov_len = BATCH_IO_BUF_SIZE;
+	}
+	if (uring_register_buffers(&this->ring, iov, BATCH_IO_DEPTH)) {
+		free(this->fixed);
+		this->fixed = NULL;
+	}
+}
+
+static
+void batch_worker_ring_destruct(struct batch_worker *this)
+{
+	if (this->has_ring)
+		uring_destruct(&this->ring);
+	/* The kernel may still write into it. */
+	if (!this->lost)
+		free(this->fixed);
+}
+
+/* The slot's next request; the queue has room for one per slot. */
+static
+struct io_uring_sqe *batch_slot_sqe(struct batch_worker *this, int s, int op)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = uring_get_sqe(&this->ring);
+	assert(sqe);
+	sqe->user_data = (uint64_t)s << 2 | op;
+	++this->slots[s].pending;
+	return sqe;
+}
+
+/*
+ * Measure the input first; only a regular file is opened through the ring.
+ * Opening anything else, such as a pipe, is left to the usual way, which must
+ * be the only one to open it.
+ */
+static
+void batch_slot_start(struct batch_worker *this, int s, int j)
+{
+	struct batch_slot *slot;
+	struct io_uring_sqe *sqe;
+
+	slot = &this->slots[s];
+	memset(slot, 0, sizeof(*slot));
+	slot->job = j;
+	slot->fd = -1;
+	++this->num_busy;
+
+	sqe = batch_slot_sqe(this, s, BATCH_IO_STAT);
+	sqe->opcode = IORING_OP_STATX;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (uintptr_t)this->b->jobs[j].path;
+	sqe->len = STATX_TYPE | STATX_SIZE;
+	sqe->off = (uintptr_t)&slot->stx;
+}
+
+static
+void batch_slot_open(struct batch_worker *this, int s)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = batch_slot_sqe(this, s, BATCH_IO_OPEN);
+	sqe->opcode = IORING_OP_OPENAT;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (uintptr_t)this->b->jobs[this->slots[s].job].path;
+	sqe->open_flags = O_RDONLY | O_CLOEXEC;
+}
+
+/* The rest of the input; into its slot's fixed buffer, if it fits. */
+static
+void batch_slot_read(struct batch_worker *this, int s)
+{
+	struct batch_slot *slot;
+	struct io_uring_sqe *sqe;
+
+	slot = &this->slots[s];
+	if (slot->buf == NULL && this->fixed &&
+	    slot->size <= BATCH_IO_BUF_SIZE) {
+		slot->buf = &this->fixed[s * BATCH_IO_BUF_SIZE];
+		slot->fixed = true;
+	} else if (slot->buf == NULL) {
+		slot->buf = malloc(slot->size);
+		if (slot->buf == NULL) {
+			slot->err = ENOMEM;
+			return;
+		}
+	}
+
+	sqe = batch_slot_sqe(this, s, BATCH_IO_READ);
+	sqe->opcode = slot->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	sqe->fd = slot->fd;
+	sqe->addr = (uintptr_t)&slot->buf[slot->done];
+	sqe->len = slot->size - slot->done;
+	sqe->off = slot->done;
+	sqe->buf_index = s;
+}
+
+static
+void batch_slot_complete(struct batch_worker *this,
+			 const struct io_uring_cqe *cqe)
+{
+	int res;
+	struct batch_slot *slot;
+
+	slot = &this->slots[cqe->user_data >> 2];
+	res = cqe->res;
+	--slot->pending;
+	if (res < 0 && !slot->err)
+		slot->err = -res;
+
+	switch (cqe->user_data & 3) {
+	case BATCH_IO_STAT:
+		if (res >= 0 && !S_ISREG(slot->stx.stx_mode))
+			slot->err = EINVAL;
+		slot->size = slot->stx.stx_size;
+		if (!slot->err && slot->size)
+			batch_slot_open(this, cqe->user_data >> 2);
+		break;
+	case BATCH_IO_OPEN:
+		if (res >= 0)
+			slot->fd = res;
+		break;
+	default:
+		if (res == 0)
+			slot->size = slot->done;	/* Shrunk */
+		else if (res > 0)
+			slot->done += res;
+		break;
+	}
+
+	if (!slot->pending && !slot->err && slot->fd >= 0 &&
+	    slot->done < slot->size)
+		batch_slot_read(this, cqe->user_data >> 2);
+	if (!slot->pending)
+		slot->ready = true;
+}
+
+static
+void batch_slot_finish(struct batch_worker *this, int s)
+{
+	struct batch_slot *slot;
+
+	slot = &this->slots[s];
+	if (slot->fd >= 0)
+		close(slot->fd);
+	if (slot->err)
+		batch_worker_do(this, slot->job);
+	else
+		batch_worker_assemble(this, slot->job,
+				      slot->buf ? slot->buf : "", slot->size);
+	if (!slot->fixed)
+		free(slot->buf);
+	slot->job = -1;
+	--this->num_busy;
+}
+
+/*
+ * Once the ring has failed with err: take back the requests the kernel has not
+ * taken, and wait for the rest, which may still write into the slots. No slot
+ * starts another. Should waiting fail too, some are left pending.
+ */
+static
+void batch_worker_drain_ring(struct batch_worker *this, int err)
+{
+	int i, n;
+	struct batch_slot *slot;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+
+	for (i = 0; i < BATCH_IO_DEPTH; ++i) {
+		slot = &this->slots[i];
+		if (slot->job >= 0 && !slot->err)
+			slot->err = err;
+	}
+	while ((sqe = uring_unqueue(&this->ring)) != NULL) {
+		slot = &this->slots[sqe->user_data >> 2];
+		if (--slot->pending == 0)
+			slot->ready = true;
+	}
+
+	for (;;) {
+		while ((cqe = uring_peek(&this->ring)) != NULL) {
+			batch_slot_complete(this, cqe);
+			uring_seen(&this->ring);
+		}
+		for (i = 0, n = 0; i < BATCH_IO_DEPTH; ++i)
+			n += this->slots[i].job >= 0 && this->slots[i].pending;
+		if (n == 0)
+			return;
+		err = uring_submit(&this->ring, 1);
+		if (err && err != EAGAIN && err != EBUSY)
+			return;
+	}
+}
+
+/*
+ * Keep up to BATCH_IO_DEPTH inputs on their way in through the ring, and
+ * assemble each as soon as it has been read. Should the ring itself fail, the
+ * inputs in it, and the rest, are read the usual way.
+ */
+static
+void batch_worker_run_ring(struct batch_worker *this)
+{
+	int i, j, err, num_ready;
+	struct io_uring_cqe *cqe;
+	struct batch_slot *slot;
+
+	for (;;) {
+		for (i = 0, j = 0; i < BATCH_IO_DEPTH && j >= 0; ++i) {
+			if (this->slots[i].job >= 0)
+				continue;
+			j = batch_worker_pop(this);
+			if (j < 0)
+				j = batch_worker_steal(this);
+			if (j >= 0)
+				batch_slot_start(this, i, j);
+		}
+		if (this->num_busy == 0)
+			return;
+
+		for (i = 0, num_ready = 0; i < BATCH_IO_DEPTH; ++i)
+			num_ready += this->slots[i].job >= 0 &&
+				this->slots[i].ready;
+		/* EBUSY, or EAGAIN, wants the completions reaped first. */
+		err = uring_submit(&this->ring, num_ready ? 0 : 1);
+		if (err && err != EAGAIN && err != EBUSY)
+			break;
+
+		while ((cqe = uring_peek(&this->ring)) != NULL) {
+			batch_slot_complete(this, cqe);
+			uring_seen(&this->ring);
+		}
+		for (i = 0; i < BATCH_IO_DEPTH; ++i) {
+			if (this->slots[i].job >= 0 && this->slots[i].ready)
+				batch_slot_finish(this, i);
+		}
+	}
+
+	batch_worker_drain_ring(this, err);
+	for (i = 0; i < BATCH_IO_DEPTH; ++i) {
+		slot = &this->slots[i];
+		if (slot->job < 0)
+			continue;
+		if (slot->pending) {
+			/* Its buf and fd are left to the requests. */
+			this->lost = true;
+			slot->fixed = true;
+			slot->fd = -1;
+		}
+		batch_slot_finish(this, i);
+	}
+}
+
+static
+void *batch_worker_run(void *arg)
+{
+	int j;
+	struct batch_worker *this;
+
+	this = arg;
+	if (this->has_ring)
+		batch_worker_run_ring(this);
+	for (;;) {
+		j = batch_worker_pop(this);
+		if (j < 0)
+			j = batch_worker_steal(this);
+		if (j < 0)
+			break;
+		batch_worker_do(this, j);
+	}
+	return NULL;
+}
+
+/* One path per line. Blank lines, and lines that begin with #, are skipped. */
+static
+int batch_read_manifest(const char *path, char ***out_paths, int *out_num)
+{
+	int err, num, max;
+	size_t i, e;
+	char **paths, **t;
+	struct input in;
+
+	err = input_open(&in, path);
+	if (err)
+		return err;
+
+	paths = NULL;
+	num = max = 0;
+	for (i = 0; i < in.size; i = e + 1) {
+		for (e = i; e < in.size && in.buf[e] != '\n'; ++e)
+			;
+		if (e == i || in.buf[i] == '#')
+			continue;
+
+		if (num == max) {
+			max = max ? 2 * max : 256;
+			t = realloc(paths, max * sizeof(*paths));
+			if (t == NULL) {
+				err = ENOMEM;
+				break;
+			}
+			paths = t;
+		}
+
+		/* Without any \r of a \r\n */
+		paths[num] = strndup(&in.buf[i], e - i - (in.buf[e - 1] == '\r'));
+		if (paths[num] == NULL) {
+			err = ENOMEM;
+			break;
+		}
+		++num;
+	}
+	input_close(&in);
+
+	*out_paths = paths;
+	*out_num = num;
+	return err;
+}
+
+static
+double batch_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Assemble every input into its own file under opts->out_dir, on a pool of
+ * work-stealing threads. Each output depends only on its input.
+ */
+int batch_main(const struct cli_opts *opts, char **paths, int num_paths)
+{
+	int i, err, num_listed, num_failed, num_steals, num_rings;
+	char **listed;
+	double start, secs;
+	size_t size;
+	unsigned long lookups, hits;
+	struct batch b;
+	struct batch_worker *w;
+	struct cache cache;
+
+	listed = NULL;
+	num_listed = 0;
+	if (opts->manifest) {
+		err = batch_read_manifest(opts->manifest, &listed, &num_listed);
+		if (err) {
+			printf("%s: %s\n", opts->manifest, strerror(err));
+			goto out;
+		}
+	}
+
+	if (mkdir(opts->out_dir, 0777) && errno != EEXIST) {
+		err = errno;
+		printf("%s: %s\n", opts->out_dir, strerror(err));
+		goto out;
+	}
+
+	memset(&b, 0, sizeof(b));
+	b.opts = opts;
+	if (opts->cache_dir) {
+		b.cache = &cache;
+		err = cache_construct(&cache, opts->cache_dir,
+				      opts->cache_size);
+		if (err) {
+			printf("%s: %s\n", opts->cache_dir, strerror(err));
+			goto out;
+		}
+	}
+	b.num_jobs = num_listed + num_paths;
+	b.jobs = calloc(b.num_jobs + 1, sizeof(*b.jobs));
+	if (b.jobs == NULL) {
+		err = ENOMEM;
+		goto close;
+	}
+	for (i = 0; i < num_listed; ++i)
+		b.jobs[i].path = listed[i];
+	for (i = 0; i < num_paths; ++i)
+		b.jobs[num_listed + i].path = paths[i];
+
+	b.num_workers = opts->num_threads;
+	if (b.num_workers == 0)
+		b.num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (b.num_workers > b.num_jobs)
+		b.num_workers = b.num_jobs;
+	if (b.num_workers < 1)
+		b.num_workers = 1;
+
+	b.workers = calloc(b.num_workers, sizeof(*b.workers));
+	if (b.workers == NULL) {
+		free(b.jobs);
+		err = ENOMEM;
+		goto close;
+	}
+
+	/* Start with equal, contiguous, shares. */
+	for (i = 0; i < b.num_workers; ++i) {
+		w = &b.workers[i];
+		w->b = &b;
+		w->id = i;
+		pthread_mutex_init(&w->dq.lock, NULL);
+		w->dq.head = (long)i * b.num_jobs / b.num_workers;
+		w->dq.tail = (long)(i + 1) * b.num_jobs / b.num_workers;
+		asm_base_construct(&w->as, "", 0);
+		memo_construct(&w->memo);
+		w->as.memo = &w->memo;
+		w->as.single_pass = opts->single_pass;
+		batch_worker_ring_construct(w);
+	}
+
+	start = batch_now();
+	for (i = 1; i < b.num_workers; ++i) {
+		w = &b.workers[i];
+		err = pthread_create(&w->thread, NULL, batch_worker_run, w);
+		if (err)
+			break;
+	}
+
+	/* The threads not created leave their jobs to be stolen. */
+	batch_worker_run(&b.workers[0]);
+	while (--i > 0)
+		pthread_join(b.workers[i].thread, NULL);
+	secs = batch_now() - start;
+
+	err = 0;
+	size = 0;
+	num_failed = num_steals = num_rings = 0;
+	lookups = hits = 0;
+	for (i = 0; i < b.num_jobs; ++i) {
+		size += b.jobs[i].size;
+		if (b.jobs[i].err == 0)
+			continue;
+		if (err == 0)
+			err = b.jobs[i].err;
+		++num_failed;
+	}
+
+	for (i = 0; i < b.num_workers; ++i) {
+		w = &b.workers[i];
+		num_steals += w->num_steals;
+		num_rings += w->has_ring;
+		lookups += w->memo.lookups;
+		hits += w->memo.hits;
+		asm_base_destruct(&w->as);
+		memo_destruct(&w->memo);
+		batch_worker_ring_destruct(w);
+		if (w->has_out)
+			out_buf_destruct(&w->out);
+		pthread_mutex_destroy(&w->dq.lock);
+	}
+
+	printf("%d shaders, %d failed, %.3f s, %.1f shaders/s, %.1f MB/s, "
+	       "%d threads, %d steals, %s\n", b.num_jobs, num_failed, secs,
+	       secs > 0 ? b.num_jobs / secs : 0,
+	       secs > 0 ? size / secs / 1e6 : 0, b.num_workers, num_steals,
+	       num_rings ? "io_uring" : "sync reads");
+
+	printf("memo: %lu hits, %lu lookups, %.1f%%\n", hits, lookups,
+	       lookups ? 100.0 * hits / lookups : 0);
+
+	if (b.cache) {
+		printf("cache: %lu hits, %lu misses, %lu stores, %lu evictions\n",
+		       cache.stats.hits, cache.stats.misses, cache.stats.stores,
+		       cache.stats.evictions);
+	}
+
+	free(b.workers);
+	free(b.jobs);
+close:
+	if (b.cache)
+		cache_destruct(b.cache);
+out:
+	for (i = 0; i < num_listed; ++i)
+		free(listed[i]);
+	free(listed);
+	return err;
+}
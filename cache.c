@@ -0,0 +1,411 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+
+#include "main.h"
+
+#define CACHE_C1			0x87c37b91114253d5ull
+#define CACHE_C2			0x4cf5ad432745937full
+#define CACHE_TMP_PREFIX		".tmp."
+#define CACHE_TMP_AGE			3600	/* Left by a crash, if older */
+#define CACHE_COPY_SIZE			(64 * 1024)
+
+static inline
+uint64_t cache_rotl(uint64_t v, int r)
+{
+	return (v << r) | (v >> (64 - r));
+}
+
+static inline
+uint64_t cache_fmix(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdull;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ull;
+	k ^= k >> 33;
+	return k;
+}
+
+/* Little-endian, so that a directory can be shared across hosts. */
+static inline
+uint64_t cache_load(const char *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+/* MurmurHash3 x64 128, seeded with 128 bits; in and out may alias. */
+static
+void cache_hash(const char *buf, size_t len, const uint64_t in[2],
+		uint64_t out[2])
+{
+	size_t i;
+	uint64_t h1, h2, k1, k2;
+	char tail[16];
+
+	h1 = in[0];
+	h2 = in[1];
+	for (i = 0; i + 16 <= len; i += 16) {
+		k1 = cache_load(&buf[i]);
+		k2 = cache_load(&buf[i + 8]);
+
+		k1 *= CACHE_C1;
+		k1 = cache_rotl(k1, 31);
+		k1 *= CACHE_C2;
+		h1 ^= k1;
+		h1 = cache_rotl(h1, 27);
+		h1 += h2;
+		h1 = h1 * 5 + 0x52dce729;
+
+		k2 *= CACHE_C2;
+		k2 = cache_rotl(k2, 33);
+		k2 *= CACHE_C1;
+		h2 ^= k2;
+		h2 = cache_rotl(h2, 31);
+		h2 += h1;
+		h2 = h2 * 5 + 0x38495ab5;
+	}
+
+	/* Zero-padded; a zero half mixes in as nothing, as in the original. */
+	if (i < len) {
+		memset(tail, 0, sizeof(tail));
+		memcpy(tail, &buf[i], len - i);
+		k1 = cache_load(tail);
+		k2 = cache_load(&tail[8]);
+
+		k2 *= CACHE_C2;
+		k2 = cache_rotl(k2, 33);
+		k2 *= CACHE_C1;
+		h2 ^= k2;
+
+		k1 *= CACHE_C1;
+		k1 = cache_rotl(k1, 31);
+		k1 *= CACHE_C2;
+		h1 ^= k1;
+	}
+
+	h1 ^= len;
+	h2 ^= len;
+	h1 += h2;
+	h2 += h1;
+	h1 = cache_fmix(h1);
+	h2 = cache_fmix(h2);
+	h1 += h2;
+	h2 += h1;
+	out[0] = h1;
+	out[1] = h2;
+}
+
+/*
+ * The tag names what is stored, such as an output format. It and the version
+ * seed the hash of the input.
+ */
+void cache_key(const char *buf, size_t len, const char *tag,
+	       struct cache_key *out)
+{
+	int n;
+	char name[64];
+	uint64_t seed[2];
+
+	n = snprintf(name, sizeof(name), "egasm %d %s", CACHE_VERSION, tag);
+	if (n >= (int)sizeof(name))
+		n = sizeof(name) - 1;
+	memset(seed, 0, sizeof(seed));
+	cache_hash(name, n, seed, seed);
+	cache_hash(buf, len, seed, out->h);
+}
+
+static
+int cache_path(const struct cache *this, const struct cache_key *key,
+	       char *out, size_t size)
+{
+	int ret;
+
+	ret = snprintf(out, size, "%s/%016llx%016llx", this->dir,
+		       (unsigned long long)key->h[0],
+		       (unsigned long long)key->h[1]);
+	if (ret < 0 || (size_t)ret >= size)
+		return ENAMETOOLONG;
+	return 0;
+}
+
+static
+bool cache_is_entry(const char *name)
+{
+	return strspn(name, "0123456789abcdef") == CACHE_NAME_LEN &&
+		name[CACHE_NAME_LEN] == 0;
+}
+
+int cache_construct(struct cache *this, const char *dir, size_t max_size)
+{
+	if (mkdir(dir, 0777) && errno != EEXIST)
+		return errno;
+
+	memset(this, 0, sizeof(*this));
+	this->dir = strdup(dir);
+	if (this->dir == NULL)
+		return ENOMEM;
+	this->max_size = max_size;
+	this->size = -1;
+	pthread_mutex_init(&this->lock, NULL);
+	return 0;
+}
+
+void cache_destruct(struct cache *this)
+{
+	pthread_mutex_destroy(&this->lock);
+	free(this->dir);
+}
+
+/*
+ * On a hit, the entry, open for reading, and its size. Any error is a miss;
+ * ENOENT is the usual one.
+ */
+int cache_open(struct cache *this, const struct cache_key *key,
+	       int *out_fd, size_t *out_size)
+{
+	int fd, err;
+	char path[PATH_MAX];
+	struct stat st;
+
+	fd = -1;
+	err = cache_path(this, key, path, sizeof(path));
+	if (!err) {
+		fd = open(path, O_RDONLY);
+		err = fd < 0 ? errno : 0;
+	}
+	if (!err && fstat(fd, &st))
+		err = errno;
+
+	pthread_mutex_lock(&this->lock);
+	if (err)
+		++this->stats.misses;
+	else
+		++this->stats.hits;
+	pthread_mutex_unlock(&this->lock);
+
+	if (err) {
+		if (fd >= 0)
+			close(fd);
+		return err;
+	}
+
+	/* A use; eviction goes by the mtimes. */
+	futimens(fd, NULL);
+	*out_fd = fd;
+	*out_size = st.st_size;
+	return 0;
+}
+
+int cache_tmp_open(struct cache *this, struct cache_tmp *tmp)
+{
+	int ret;
+
+	ret = snprintf(tmp->path, sizeof(tmp->path), "%s/" CACHE_TMP_PREFIX
+		       "XXXXXX", this->dir);
+	if (ret < 0 || (size_t)ret >= sizeof(tmp->path))
+		return ENAMETOOLONG;
+	tmp->fd = mkstemp(tmp->path);
+	if (tmp->fd < 0)
+		return errno;
+	return 0;
+}
+
+void cache_tmp_abort(struct cache_tmp *tmp)
+{
+	close(tmp->fd);
+	unlink(tmp->path);
+}
+
+struct cache_ent {
+	struct timespec			mtime;
+	size_t				size;
+	char				name[CACHE_NAME_LEN + 1];
+};
+
+static
+int cache_ent_cmp(const void *a, const void *b)
+{
+	const struct cache_ent *x = a, *y = b;
+
+	if (x->mtime.tv_sec != y->mtime.tv_sec)
+		return x->mtime.tv_sec < y->mtime.tv_sec ? -1 : 1;
+	if (x->mtime.tv_nsec != y->mtime.tv_nsec)
+		return x->mtime.tv_nsec < y->mtime.tv_nsec ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Measure the entries, and, beyond max_size, unlink the least recently used
+ * down to 3/4 of it, so that the puts that follow do not scan again. Called
+ * with the lock held.
+ */
+static
+void cache_evict(struct cache *this)
+{
+	int i, n, max, dfd;
+	size_t size, target;
+	time_t now;
+	DIR *d;
+	struct dirent *de;
+	struct stat st;
+	struct cache_ent *ents, *t;
+
+	this->size = 0;
+	d = opendir(this->dir);
+	if (d == NULL)
+		return;
+	dfd = dirfd(d);
+	now = time(NULL);
+
+	ents = NULL;
+	n = max = 0;
+	size = 0;
+	while ((de = readdir(d)) != NULL) {
+		if (fstatat(dfd, de->d_name, &st, AT_SYMLINK_NOFOLLOW))
+			continue;
+
+		if (!strncmp(de->d_name, CACHE_TMP_PREFIX,
+			     sizeof(CACHE_TMP_PREFIX) - 1)) {
+			if (now - st.st_mtime > CACHE_TMP_AGE)
+				unlinkat(dfd, de->d_name, 0);
+			continue;
+		}
+		if (!cache_is_entry(de->d_name))
+			continue;
+
+		if (n == max) {
+			max = max ? 2 * max : 256;
+			t = realloc(ents, max * sizeof(*t));
+			if (t == NULL)
+				break;
+			ents = t;
+		}
+		ents[n].mtime = st.st_mtim;
+		ents[n].size = st.st_size;
+		memcpy(ents[n].name, de->d_name, sizeof(ents[n].name));
+		size += st.st_size;
+		++n;
+	}
+
+	if (size > this->max_size) {
+		qsort(ents, n, sizeof(*ents), cache_ent_cmp);
+		target = this->max_size / 4 * 3;
+		for (i = 0; i < n && size > target; ++i) {
+			if (unlinkat(dfd, ents[i].name, 0))
+				continue;
+			size -= ents[i].size;
+			++this->stats.evictions;
+		}
+	}
+	this->size = size;
+	free(ents);
+	closedir(d);
+}
+
+/* Close the entry, and move it into place, atomically. */
+int cache_put(struct cache *this, const struct cache_key *key,
+	      struct cache_tmp *tmp)
+{
+	int err;
+	char path[PATH_MAX];
+	struct stat st;
+
+	err = fstat(tmp->fd, &st) ? errno : 0;
+	if (close(tmp->fd) && !err)
+		err = errno;
+	if (!err)
+		err = cache_path(this, key, path, sizeof(path));
+	if (!err && rename(tmp->path, path))
+		err = errno;
+	if (err) {
+		unlink(tmp->path);
+		return err;
+	}
+
+	pthread_mutex_lock(&this->lock);
+	++this->stats.stores;
+	if (this->size != (size_t)-1)
+		this->size += st.st_size;
+	if (this->max_size &&
+	    (this->size == (size_t)-1 || this->size > this->max_size))
+		cache_evict(this);
+	pthread_mutex_unlock(&this->lock);
+	return 0;
+}
+
+static
+int cache_write_all(int fd, const char *p, size_t n)
+{
+	ssize_t ret;
+
+	while (n) {
+		ret = write(fd, p, n);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return errno;
+		p += ret;
+		n -= ret;
+	}
+	return 0;
+}
+
+/*
+ * The first size bytes of from, to the current position of to. With sendfile,
+ * or, where it cannot, such as onto a file opened to append, with pread.
+ */
+int cache_copy(int from, int to, size_t size)
+{
+	int err;
+	off_t off;
+	ssize_t ret;
+	size_t n;
+	char buf[CACHE_COPY_SIZE];
+
+	for (off = 0; (size_t)off < size;) {
+		ret = sendfile(to, from, &off, size - off);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0 && (errno == EINVAL || errno == ENOSYS))
+			break;
+		if (ret < 0)
+			return errno;
+		if (ret == 0)
+			return EIO;	/* Shrunk */
+	}
+
+	while ((size_t)off < size) {
+		n = size - off < sizeof(buf) ? size - off : sizeof(buf);
+		ret = pread(from, buf, n, off);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return errno;
+		if (ret == 0)
+			return EIO;
+		err = cache_write_all(to, buf, ret);
+		if (err)
+			return err;
+		off += ret;
+	}
+	return 0;
+}
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+
+/* Bumped whenever the output for some input changes. */
+#define CACHE_VERSION			1
+#define CACHE_NAME_LEN			32	/* The key, in hex */
+
+/* Of an input, the assembler's version, and what is stored for it. */
+struct cache_key {
+	uint64_t			h[2];
+};
+
+/* An entry being written; renamed into place only once complete. */
+struct cache_tmp {
+	char				path[PATH_MAX];
+	int				fd;
+};
+
+/*
+ * Content-addressed, on-disk, cache of outputs, one file per entry, named
+ * after its key. The least recently used entries are evicted once the entries
+ * exceed max_size; a hit counts as a use. Several processes, and the threads
+ * of one, can share a directory.
+ */
+struct cache {
+	char				*dir;
+	size_t				max_size;	/* 0 for no limit */
+	size_t				size;		/* -1 until scanned */
+	struct egasm_cache_stats	stats;
+	pthread_mutex_t			lock;		/* For the above */
+};
+
+int	cache_construct(struct cache *this, const char *dir, size_t max_size);
+void	cache_destruct(struct cache *this);
+void	cache_key(const char *buf, size_t len, const char *tag,
+		  struct cache_key *out);
+int	cache_open(struct cache *this, const struct cache_key *key,
+		   int *out_fd, size_t *out_size);
+int	cache_tmp_open(struct cache *this, struct cache_tmp *tmp);
+void	cache_tmp_abort(struct cache_tmp *tmp);
+int	cache_put(struct cache *this, const struct cache_key *key,
+		  struct cache_tmp *tmp);
+int	cache_copy(int from, int to, size_t size);
+#endif
@@ -22,19 +22,16 @@ int inst_cf_parse_cc(struct inst_cf *this)
 	all = container_of(this, struct inst_all, u.cf);
 	base = &all->base;
 
-	if (inst_base_is_next_token(base, ".") == false)
+	if (inst_base_is_next_punct(base, '.') == false)
 		return EINVAL;
 
-	if (inst_base_is_next_token(base, "a"))
-		this->w1.cond = CF_COND_ACTIVE;
-	else if (inst_base_is_next_token(base, "f"))
-		this->w1.cond = CF_COND_FALSE;
-	else if (inst_base_is_next_token(base, "b"))
-		this->w1.cond = CF_COND_BOOL;
-	else if (inst_base_is_next_token(base, "nb"))
-		this->w1.cond = CF_COND_NOT_BOOL;
-	else
-		return EINVAL;
+	switch (inst_base_get_next_kw(base)) {
+	case KW_A:	this->w1.cond = CF_COND_ACTIVE; break;
+	case KW_F:	this->w1.cond = CF_COND_FALSE; break;
+	case KW_B:	this->w1.cond = CF_COND_BOOL; break;
+	case KW_NB:	this->w1.cond = CF_COND_NOT_BOOL; break;
+	default:	return EINVAL;
+	}
 
 	if (this->w1.cond == CF_COND_ACTIVE || this->w1.cond == CF_COND_FALSE)
 		return 0;
@@ -57,18 +54,8 @@ int inst_cf_encode(struct inst_cf *this)
 	base = &all->base;
 	w = base->w;
 
-	w[0] |= bits_set(CF_WORD0_ADDR, this->w0.addr);
-	w[0] |= bits_set(CF_WORD0_JMP_TAB_SEL, this->w0.jump_table_sel);
-
-	w[1] |= bits_set(CF_WORD1_POP_COUNT, this->w1.pop_count);
-	w[1] |= bits_set(CF_WORD1_CONST, this->w1.cf_const);
-	w[1] |= bits_set(CF_WORD1_COND, this->w1.cond);
-	w[1] |= bits_set(CF_WORD1_COUNT, this->w1.count - 1);
-	w[1] |= bits_set(CF_WORD1_VALID_PIXEL_MODE, this->w1.valid_pixel_mode);
-	w[1] |= bits_set(CF_WORD1_END_OF_PROGRAM, this->w1.end_of_program);
-	w[1] |= bits_set(CF_WORD1_INST, this->w1.cf_inst);
-	w[1] |= bits_set(CF_WORD1_WHOLE_QUAD_MODE, this->w1.whole_quad_mode);
-	w[1] |= bits_set(CF_WORD1_BARRIER, this->w1.barrier);
+	w[0] |= isa_pack(CF_WORD0_FIELDS, &this->w0);
+	w[1] |= isa_pack(CF_WORD1_FIELDS, &this->w1);
 	return 0;
 }
 
@@ -82,11 +69,13 @@ int inst_cf_parse(struct inst_cf *this, int code)
 	all = container_of(this, struct inst_all, u.cf);
 	base = &all->base;
 
+	this->w0.label = -1;
 	this->w1.cf_inst = code;
 
+	/* The fields hold count - 1. */
 	switch (code) {
 	case CF_INST_CALL_FS:
-		this->w1.count = 1;	/* Nesting Counter Increment */
+		this->w1.count = 0;	/* Nesting Counter Increment of 1 */
 		break;
 	case CF_INST_VC:
 	case CF_INST_TC:
@@ -94,14 +83,14 @@ int inst_cf_parse(struct inst_cf *this, int code)
 		err = inst_base_parse_count(base, &count);
 		if (err)
 			return err;
-		this->w1.count = count;	/* -1 when encoding. */
+		this->w1.count = count - 1;
 		break;
 	default:
-		this->w1.count = 1;	/* To set count - 1 to 0. */
+		this->w1.count = 0;
 		break;
 	}
 
-	if (inst_base_is_next_token(base, "cc")) {
+	if (inst_base_is_next_kw(base, KW_CC)) {
 		err = inst_cf_parse_cc(this);
 		if (err)
 			return err;
@@ -111,28 +100,26 @@ int inst_cf_parse(struct inst_cf *this, int code)
 	case CF_INST_CALL_FS:
 	case CF_INST_VC:
 	case CF_INST_TC:
-		/* label */
-		this->w0.label = inst_base_get_next_token(base);
+		err = inst_base_parse_label(base, &this->w0.label);
+		if (err)
+			return err;
 		break;
 	}
 
 	/* Flags and ; */
 	for (;;) {
-		if (inst_base_is_next_token(base, ";"))
+		if (inst_base_is_next_punct(base, ';'))
 			break;
 next_flag:
-		if (inst_base_is_next_token(base, "eop"))
-			this->w1.end_of_program = 1;
-		else if (inst_base_is_next_token(base, "vpm"))
-			this->w1.valid_pixel_mode = 1;
-		else if (inst_base_is_next_token(base, "wqm"))
-			this->w1.whole_quad_mode = 1;
-		else if (inst_base_is_next_token(base, "b"))
-			this->w1.barrier = 1;
-		else
-			return EINVAL;
-
-		if (inst_base_is_next_token(base, ","))
+		switch (inst_base_get_next_kw(base)) {
+		case KW_EOP:	this->w1.end_of_program = 1; break;
+		case KW_VPM:	this->w1.valid_pixel_mode = 1; break;
+		case KW_WQM:	this->w1.whole_quad_mode = 1; break;
+		case KW_B:	this->w1.barrier = 1; break;
+		default:	return EINVAL;
+		}
+
+		if (inst_base_is_next_punct(base, ','))
 			goto next_flag;
 	}
 	return 0;
@@ -148,28 +135,28 @@ int inst_cf_aie_parse_array_base(struct inst_base *base, int *out_arr_base,
 	*out_arr_base = *out_ix_gpr = 0;
 	*out_size = 1;
 
-	if (inst_base_is_next_token(base, "[") == false)
+	if (inst_base_is_next_punct(base, '[') == false)
 		return EINVAL;
 
 	err = inst_base_parse_number(base, out_arr_base);
 	if (err)
 		return err;
 
-	if (inst_base_is_next_token(base, "+") == false)
+	if (inst_base_is_next_punct(base, '+') == false)
 		goto done;
 
 	err = inst_base_parse_register(base, out_ix_gpr);
 	if (err)
 		return err;
 
-	if (inst_base_is_next_token(base, "*") == false)
+	if (inst_base_is_next_punct(base, '*') == false)
 		goto done;
 
 	err = inst_base_parse_number(base, out_size);
 	if (err)
 		return err;
 done:
-	if (inst_base_is_next_token(base, "]") == false)
+	if (inst_base_is_next_punct(base, ']') == false)
 		return EINVAL;
 	return 0;
 }
@@ -185,84 +172,62 @@ int inst_cf_aie_swiz_encode(struct inst_cf_aie_swiz *this)
 	base = &all->base;
 	w = base->w;
 
-	w[0] |= bits_set(CF_AIE_WORD0_ARRAY_BASE, this->w0.array_base);
-	w[0] |= bits_set(CF_AIE_WORD0_TYPE, this->w0.type);
-	w[0] |= bits_set(CF_AIE_WORD0_RW_GPR, this->w0.rw_gpr);
-	w[0] |= bits_set(CF_AIE_WORD0_RW_REL, this->w0.rw_rel);
-	w[0] |= bits_set(CF_AIE_WORD0_INDEX_GPR, this->w0.index_gpr);
-	w[0] |= bits_set(CF_AIE_WORD0_ELEM_SIZE, this->w0.elem_size - 1);
-
-	w[1] |= bits_set(CF_AIE_WORD1_SWIZ_SEL_X, this->w1.sel_x);
-	w[1] |= bits_set(CF_AIE_WORD1_SWIZ_SEL_Y, this->w1.sel_y);
-	w[1] |= bits_set(CF_AIE_WORD1_SWIZ_SEL_Z, this->w1.sel_z);
-	w[1] |= bits_set(CF_AIE_WORD1_SWIZ_SEL_W, this->w1.sel_w);
-
-	w[1] |= bits_set(CF_AIE_WORD1_BURST_COUNT, this->w1.burst_count - 1);
-	w[1] |= bits_set(CF_AIE_WORD1_VALID_PIXEL_MODE, this->w1.valid_pixel_mode);
-	w[1] |= bits_set(CF_AIE_WORD1_END_OF_PROGRAM, this->w1.end_of_program);
-	w[1] |= bits_set(CF_AIE_WORD1_INST, this->w1.cf_inst);
-	w[1] |= bits_set(CF_AIE_WORD1_MARK, this->w1.mark);
-	w[1] |= bits_set(CF_AIE_WORD1_BARRIER, this->w1.barrier);
+	w[0] |= isa_pack(CF_AIE_WORD0_BASE_FIELDS, &this->w0);
+	w[0] |= isa_pack(CF_AIE_WORD0_FIELDS, &this->w0);
+
+	w[1] |= isa_pack(CF_AIE_WORD1_SWIZ_FIELDS, &this->w1);
+	w[1] |= isa_pack(CF_AIE_WORD1_FIELDS, &this->w1);
 	return 0;
 }
 
 static
 int inst_cf_aie_swiz_parse(struct inst_cf_aie_swiz *this, int code)
 {
-	int count, swiz[4], err;
+	int count, swiz[4], arr_base, ix_gpr, size, val, err;
 	struct inst_base *base;
 	struct inst_all *all;
-	bool is_pos, is_prm, is_pix;
 
 	all = container_of(this, struct inst_all, u.cf_aie_swiz);
 	base = &all->base;
 
 	this->w1.cf_inst = code;
 
-	if (inst_base_is_next_token(base, ".") == false)
+	if (inst_base_is_next_punct(base, '.') == false)
 		return EINVAL;
 
 	/* swiz has only 3 */
-	is_pos = is_pix = is_prm = false;
-	if (inst_base_is_next_token(base, "pos"))
-		is_pos = true;
-	else if (inst_base_is_next_token(base, "prm"))
-		is_prm = true;
-	else if (inst_base_is_next_token(base, "pix"))
-		is_pix = true;
-	else
-		return EINVAL;
-
-	if (is_pos)
-		this->w0.type = EXPORT_TYPE_POS;
-	else if (is_prm)
-		this->w0.type = EXPORT_TYPE_PARAM;
-	else
-		this->w0.type = EXPORT_TYPE_PIXEL;
+	switch (inst_base_get_next_kw(base)) {
+	case KW_POS:	this->w0.type = EXPORT_TYPE_POS; break;
+	case KW_PRM:	this->w0.type = EXPORT_TYPE_PARAM; break;
+	case KW_PIX:	this->w0.type = EXPORT_TYPE_PIXEL; break;
+	default:	return EINVAL;
+	}
 
 	/* burst count */
 	err = inst_base_parse_count(base, &count);
 	if (err)
 		return err;
-	this->w1.burst_count = count;
+	this->w1.burst_count = count - 1;
 
 	/* No cc in AIE */
 
 	/* array base [base + index * elem_size] */
-	err = inst_cf_aie_parse_array_base(base, &this->w0.array_base,
-					   &this->w0.index_gpr,
-					   &this->w0.elem_size);
+	err = inst_cf_aie_parse_array_base(base, &arr_base, &ix_gpr, &size);
 	if (err)
 		return err;
+	this->w0.array_base = arr_base;
+	this->w0.index_gpr = ix_gpr;
+	this->w0.elem_size = size - 1;
 	
 	/* Must be a comma */
-	if (inst_base_is_next_token(base, ",") == false)
+	if (inst_base_is_next_punct(base, ',') == false)
 		return EINVAL;
 
 	/* Must be a GPR. */
-	err = inst_base_parse_register(base, &this->w0.rw_gpr);
+	err = inst_base_parse_register(base, &val);
 	if (err)
 		return err;
+	this->w0.rw_gpr = val;
 	
 	swiz[SEL_X] = SEL_X;
 	swiz[SEL_Y] = SEL_Y;
@@ -270,7 +235,7 @@ int inst_cf_aie_swiz_parse(struct inst_cf_aie_swiz *this, int code)
 	swiz[SEL_W] = SEL_W;
 
 	/* Is there a .swizzle */
-	if (inst_base_is_next_token(base, ".")) {
+	if (inst_base_is_next_punct(base, '.')) {
 		err = inst_base_parse_swizzle(base, swiz);
 		if (err)
 			return err;
@@ -283,23 +248,19 @@ int inst_cf_aie_swiz_parse(struct inst_cf_aie_swiz *this, int code)
 
 	/* Flags and ; */
 	for (;;) {
-		if (inst_base_is_next_token(base, ";"))
+		if (inst_base_is_next_punct(base, ';'))
 			break;
 next_flag:
-		if (inst_base_is_next_token(base, "eop"))
-			this->w1.end_of_program = 1;
-		else if (inst_base_is_next_token(base, "vpm"))
-			this->w1.valid_pixel_mode = 1;
-		else if (inst_base_is_next_token(base, "rel"))
-			this->w0.rw_rel = 1;
-		else if (inst_base_is_next_token(base, "m"))
-			this->w1.mark = 1;
-		else if (inst_base_is_next_token(base, "b"))
-			this->w1.barrier = 1;
-		else
-			return EINVAL;
-
-		if (inst_base_is_next_token(base, ","))
+		switch (inst_base_get_next_kw(base)) {
+		case KW_EOP:	this->w1.end_of_program = 1; break;
+		case KW_VPM:	this->w1.valid_pixel_mode = 1; break;
+		case KW_REL:	this->w0.rw_rel = 1; break;
+		case KW_M:	this->w1.mark = 1; break;
+		case KW_B:	this->w1.barrier = 1; break;
+		default:	return EINVAL;
+		}
+
+		if (inst_base_is_next_punct(base, ','))
 			goto next_flag;
 	}
 	return 0;
@@ -316,36 +277,33 @@ int inst_cf_alu_parse_kcache(struct inst_cf_alu *this, int ix)
 	all = container_of(this, struct inst_all, u.cf_alu);
 	base = &all->base;
 
-	if (inst_base_is_next_token(base, "(") == false)
+	if (inst_base_is_next_punct(base, '(') == false)
 		return EINVAL;
 
 	err = inst_base_parse_number(base, &buf);
 	if (err)
 		return err;
 
-	if (inst_base_is_next_token(base, "[") == false)
+	if (inst_base_is_next_punct(base, '[') == false)
 		return EINVAL;
 	err = inst_base_parse_number(base, &addr);
 	if (err)
 		return err;
-	if (inst_base_is_next_token(base, "]") == false)
+	if (inst_base_is_next_punct(base, ']') == false)
 		return EINVAL;
 
-	if (inst_base_is_next_token(base, ",") == false)
+	if (inst_base_is_next_punct(base, ',') == false)
 		return EINVAL;
 
-	if (inst_base_is_next_token(base, "nop"))
-		mode = CF_KCACHE_MODE_NOP;
-	else if (inst_base_is_next_token(base, "l1"))
-		mode = CF_KCACHE_MODE_LOCK_1;
-	else if (inst_base_is_next_token(base, "l2"))
-		mode = CF_KCACHE_MODE_LOCK_2;
-	else if (inst_base_is_next_token(base, "lli"))
-		mode = CF_KCACHE_MODE_LOCK_LOOP_INDEX;
-	else
-		return EINVAL;
+	switch (inst_base_get_next_kw(base)) {
+	case KW_NOP:	mode = CF_KCACHE_MODE_NOP; break;
+	case KW_L1:	mode = CF_KCACHE_MODE_LOCK_1; break;
+	case KW_L2:	mode = CF_KCACHE_MODE_LOCK_2; break;
+	case KW_LLI:	mode = CF_KCACHE_MODE_LOCK_LOOP_INDEX; break;
+	default:	return EINVAL;
+	}
 
-	if (inst_base_is_next_token(base, ")") == false)
+	if (inst_base_is_next_punct(base, ')') == false)
 		return EINVAL;
 
 	if (ix == 0) {
@@ -382,19 +340,8 @@ int inst_cf_alu_encode(struct inst_cf_alu *this)
 	w = base->w;
 	assert(base->num_words == 2);	/* TODO CF_ALU_EXT */
 
-	w[0] |= bits_set(CF_ALU_WORD0_ADDR, this->w0.addr);
-	w[0] |= bits_set(CF_ALU_WORD0_KCACHE_BANK0, this->w0.kcache_bank0);
-	w[0] |= bits_set(CF_ALU_WORD0_KCACHE_BANK1, this->w0.kcache_bank1);
-	w[0] |= bits_set(CF_ALU_WORD0_KCACHE_MODE0, this->w0.kcache_mode0);
-
-	w[1] |= bits_set(CF_ALU_WORD1_KCACHE_MODE1, this->w1.kcache_mode1);
-	w[1] |= bits_set(CF_ALU_WORD1_KCACHE_ADDR0, this->w1.kcache_addr0);
-	w[1] |= bits_set(CF_ALU_WORD1_KCACHE_ADDR1, this->w1.kcache_addr1);
-	w[1] |= bits_set(CF_ALU_WORD1_COUNT, this->w1.count - 1);
-	w[1] |= bits_set(CF_ALU_WORD1_ALT_CONST, this->w1.alt_const);
-	w[1] |= bits_set(CF_ALU_WORD1_INST, this->w1.cf_inst);
-	w[1] |= bits_set(CF_ALU_WORD1_WHOLE_QUAD_MODE, this->w1.whole_quad_mode);
-	w[1] |= bits_set(CF_ALU_WORD1_BARRIER, this->w1.barrier);
+	w[0] |= isa_pack(CF_ALU_WORD0_FIELDS, &this->w0);
+	w[1] |= isa_pack(CF_ALU_WORD1_FIELDS, &this->w1);
 	return 0;
 }
 
@@ -414,39 +361,38 @@ int inst_cf_alu_parse(struct inst_cf_alu *this, int code)
 	err = inst_base_parse_count(base, &count);
 	if (err)
 		return err;
-	this->w1.count = count;	/* -1 when encoding. */
+	this->w1.count = count - 1;
 
 	/* KC0 KC1 */
-	if (inst_base_is_next_token(base, "kc0")) {
+	if (inst_base_is_next_kw(base, KW_KC0)) {
 		err = inst_cf_alu_parse_kcache(this, 0);
 		if (err)
 			return err;
 	}
 
-	if (inst_base_is_next_token(base, "kc1")) {
+	if (inst_base_is_next_kw(base, KW_KC1)) {
 		err = inst_cf_alu_parse_kcache(this, 1);
 		if (err)
 			return err;
 	}
 
-	/* Label */
-	this->w0.label = inst_base_get_next_token(base);
+	err = inst_base_parse_label(base, &this->w0.label);
+	if (err)
+		return err;
 
 	/* Flags and ; */
 	for (;;) {
-		if (inst_base_is_next_token(base, ";"))
+		if (inst_base_is_next_punct(base, ';'))
 			break;
 next_flag:
-		if (inst_base_is_next_token(base, "alt"))
-			this->w1.alt_const = 1;
-		else if (inst_base_is_next_token(base, "wqm"))
-			this->w1.whole_quad_mode = 1;
-		else if (inst_base_is_next_token(base, "b"))
-			this->w1.barrier = 1;
-		else
-			return EINVAL;
-
-		if (inst_base_is_next_token(base, ","))
+		switch (inst_base_get_next_kw(base)) {
+		case KW_ALT:	this->w1.alt_const = 1; break;
+		case KW_WQM:	this->w1.whole_quad_mode = 1; break;
+		case KW_B:	this->w1.barrier = 1; break;
+		default:	return EINVAL;
+		}
+
+		if (inst_base_is_next_punct(base, ','))
 			goto next_flag;
 	}
 	return 0;
@@ -460,31 +406,39 @@ int inst_cf_parse_all(struct inst_all *all)
 	base = &all->base;
 	code = -1;
 
-	if (inst_base_is_next_token(base, ".") == false)
+	if (inst_base_is_next_punct(base, '.') == false)
 		return EINVAL;
 
 	/* Scan the code. Divide into cf, gws, alu, rat, buf, swiz */
-	if (inst_base_is_next_token(base, "fs")) {
+	switch (inst_base_get_next_kw(base)) {
+	case KW_FS:
 		base->type = IT_CF;
 		code = CF_INST_CALL_FS;
-	} else if (inst_base_is_next_token(base, "tc")) {
+		break;
+	case KW_TC:
 		base->type = IT_CF;
 		code = CF_INST_TC;
-	} else if (inst_base_is_next_token(base, "vc")) {
+		break;
+	case KW_VC:
 		base->type = IT_CF;
 		code = CF_INST_VC;
-	} else if (inst_base_is_next_token(base, "ret")) {
+		break;
+	case KW_RET:
 		base->type = IT_CF;
 		code = CF_INST_RETURN;
-	} else if (inst_base_is_next_token(base, "nop")) {
+		break;
+	case KW_NOP:
 		base->type = IT_CF;
 		code = CF_INST_NOP;
-	} else if (inst_base_is_next_token(base, "xd")) {
+		break;
+	case KW_XD:
 		base->type = IT_CF_AIE_SWIZ;
 		code = CF_INST_EXPORT_DONE;
-	} else if (inst_base_is_next_token(base, "alu")) {
+		break;
+	case KW_ALU:
 		base->type = IT_CF_ALU;
 		code = CF_INST_ALU;
+		break;
 	}
 
 	/* TODO: CF_ALU_EXT has 4 words */
@@ -508,38 +462,58 @@ int inst_cf_parse_all(struct inst_all *all)
 	return err;
 }
 
-int inst_cf_fix_labels_all(struct inst_all *all)
+/* The sym id of the label the instruction references; -1 if none. */
+int inst_cf_get_label_all(const struct inst_all *all)
 {
-	int err;
-	struct inst_base *base;
-	const char *label;
-	int *addr;
-
 	/* only IT_CF, IT_CF_ALU and IT_CF_ALU_EXT have labels. */
-	base = &all->base;
-	label = NULL;
-	err = 0;
-
-	switch (base->type) {
+	switch (all->base.type) {
 	case IT_CF:
-		label = all->u.cf.w0.label;
-		addr = &all->u.cf.w0.addr;
-		break;
+		return all->u.cf.w0.label;
 	case IT_CF_ALU:
-		label = all->u.cf_alu.w0.label;
-		addr = &all->u.cf_alu.w0.addr;
-		break;
-	case IT_CF_ALU_EXT:
-		err = EINVAL;	/* TODO */
-		break;
+		return all->u.cf_alu.w0.label;
 	default:
-		err = 0;
-		break;
+		return -1;
 	}
+}
 
-	if (label)
-		err = inst_base_fix_label(base, label, addr);
-	return err;
+int inst_cf_fix_labels_all(struct inst_all *all)
+{
+	int err, label, addr;
+	struct inst_base *base;
+
+	base = &all->base;
+	if (base->type == IT_CF_ALU_EXT)
+		return EINVAL;	/* TODO */
+
+	label = inst_cf_get_label_all(all);
+	if (label < 0)
+		return 0;
+
+	err = inst_base_fix_label(base, label, &addr);
+	if (err)
+		return err;
+
+	if (base->type == IT_CF)
+		all->u.cf.w0.addr = addr;
+	else
+		all->u.cf_alu.w0.addr = addr;
+	return 0;
+}
+
+/* Set the address of an instruction already encoded without it. */
+void inst_cf_patch_label_all(struct inst_all *all, int addr)
+{
+	int *w;
+
+	w = all->base.w;
+	if (all->base.type == IT_CF) {
+		all->u.cf.w0.addr = addr;
+		w[0] |= bits_set(CF_WORD0_ADDR, addr);
+	} else {
+		assert(all->base.type == IT_CF_ALU);
+		all->u.cf_alu.w0.addr = addr;
+		w[0] |= bits_set(CF_ALU_WORD0_ADDR, addr);
+	}
 }
 
 /* Mirror cf_parse_all */
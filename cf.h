@@ -4,11 +4,13 @@
 #ifndef CF_H
 #define CF_H
 
+#include "isa.h"
+
 /**** CF_WORD0 ****/
-#define CF_WORD0_ADDR_POS				0
-#define CF_WORD0_JMP_TAB_SEL_POS			24
-#define CF_WORD0_ADDR_BITS				24
-#define CF_WORD0_JMP_TAB_SEL_BITS			3
+#define CF_WORD0_FIELDS(X, a)							\
+	X(a, CF_WORD0, ADDR, addr, 0, 24)					\
+	X(a, CF_WORD0, JMP_TAB_SEL, jump_table_sel, 24, 3)
+enum { CF_WORD0_FIELDS(ISA_CONSTS, ) };
 
 #define CF_JTS_CONST_A					0
 #define CF_JTS_CONST_B					1
@@ -18,38 +20,27 @@
 #define CF_JTS_INDEX_1					5
 
 /**** CF_GWS_WORD0 ****/
-#define CF_GWS_WORD0_VALUE_POS				0
-#define CF_GWS_WORD0_RSRC_POS				16
-#define CF_GWS_WORD0_SIGN_POS				25
-#define CF_GWS_WORD0_VALUE_INDEX_MODE_POS		26
-#define CF_GWS_WORD0_RSRC_INDEX_MODE_POS		28
-#define CF_GWS_WORD0_INST_POS				30
-#define CF_GWS_WORD0_VALUE_BITS				10
-#define CF_GWS_WORD0_RSRC_BITS				5
-#define CF_GWS_WORD0_SIGN_BITS				1
-#define CF_GWS_WORD0_VALUE_INDEX_MODE_BITS		2
-#define CF_GWS_WORD0_RSRC_INDEX_MODE_BITS		2
-#define CF_GWS_WORD0_INST_BITS				2
+#define CF_GWS_WORD0_FIELDS(X, a)						\
+	X(a, CF_GWS_WORD0, VALUE, value, 0, 10)					\
+	X(a, CF_GWS_WORD0, RSRC, rsrc, 16, 5)					\
+	X(a, CF_GWS_WORD0, SIGN, sign, 25, 1)					\
+	X(a, CF_GWS_WORD0, VALUE_INDEX_MODE, value_index_mode, 26, 2)		\
+	X(a, CF_GWS_WORD0, RSRC_INDEX_MODE, rsrc_index_mode, 28, 2)		\
+	X(a, CF_GWS_WORD0, INST, gws_opcode, 30, 2)
+enum { CF_GWS_WORD0_FIELDS(ISA_CONSTS, ) };
 
 /**** CF_WORD1 ****/
-#define CF_WORD1_POP_COUNT_POS				0
-#define CF_WORD1_CONST_POS				3
-#define CF_WORD1_COND_POS				8
-#define CF_WORD1_COUNT_POS				10
-#define CF_WORD1_VALID_PIXEL_MODE_POS			20
-#define CF_WORD1_END_OF_PROGRAM_POS			21
-#define CF_WORD1_INST_POS				22
-#define CF_WORD1_WHOLE_QUAD_MODE_POS			30
-#define CF_WORD1_BARRIER_POS				31
-#define CF_WORD1_POP_COUNT_BITS				3
-#define CF_WORD1_CONST_BITS				5
-#define CF_WORD1_COND_BITS				2
-#define CF_WORD1_COUNT_BITS				6
-#define CF_WORD1_VALID_PIXEL_MODE_BITS			1
-#define CF_WORD1_END_OF_PROGRAM_BITS			1
-#define CF_WORD1_INST_BITS				8
-#define CF_WORD1_WHOLE_QUAD_MODE_BITS			1
-#define CF_WORD1_BARRIER_BITS				1
+#define CF_WORD1_FIELDS(X, a)							\
+	X(a, CF_WORD1, POP_COUNT, pop_count, 0, 3)				\
+	X(a, CF_WORD1, CONST, cf_const, 3, 5)					\
+	X(a, CF_WORD1, COND, cond, 8, 2)					\
+	X(a, CF_WORD1, COUNT, count, 10, 6)					\
+	X(a, CF_WORD1, VALID_PIXEL_MODE, valid_pixel_mode, 20, 1)		\
+	X(a, CF_WORD1, END_OF_PROGRAM, end_of_program, 21, 1)			\
+	X(a, CF_WORD1, INST, cf_inst, 22, 8)					\
+	X(a, CF_WORD1, WHOLE_QUAD_MODE, whole_quad_mode, 30, 1)			\
+	X(a, CF_WORD1, BARRIER, barrier, 31, 1)
+enum { CF_WORD1_FIELDS(ISA_CONSTS, ) };
 
 #define CF_COND_ACTIVE					0
 #define CF_COND_FALSE					1
@@ -65,14 +56,12 @@
 #define CF_INST_HALT					31
 
 /**** CF_ALU_WORD0 ****/
-#define CF_ALU_WORD0_ADDR_POS				0
-#define CF_ALU_WORD0_KCACHE_BANK0_POS			22
-#define CF_ALU_WORD0_KCACHE_BANK1_POS			26
-#define CF_ALU_WORD0_KCACHE_MODE0_POS			30
-#define CF_ALU_WORD0_ADDR_BITS				22
-#define CF_ALU_WORD0_KCACHE_BANK0_BITS			4
-#define CF_ALU_WORD0_KCACHE_BANK1_BITS			4
-#define CF_ALU_WORD0_KCACHE_MODE0_BITS			2
+#define CF_ALU_WORD0_FIELDS(X, a)						\
+	X(a, CF_ALU_WORD0, ADDR, addr, 0, 22)					\
+	X(a, CF_ALU_WORD0, KCACHE_BANK0, kcache_bank0, 22, 4)			\
+	X(a, CF_ALU_WORD0, KCACHE_BANK1, kcache_bank1, 26, 4)			\
+	X(a, CF_ALU_WORD0, KCACHE_MODE0, kcache_mode0, 30, 2)
+enum { CF_ALU_WORD0_FIELDS(ISA_CONSTS, ) };
 
 #define CF_KCACHE_MODE_NOP				0
 #define CF_KCACHE_MODE_LOCK_1				1
@@ -80,22 +69,36 @@
 #define CF_KCACHE_MODE_LOCK_LOOP_INDEX			3
 
 /**** CF_ALU_WORD1 ****/
-#define CF_ALU_WORD1_KCACHE_MODE1_POS			0
-#define CF_ALU_WORD1_KCACHE_ADDR0_POS			2
-#define CF_ALU_WORD1_KCACHE_ADDR1_POS			10
-#define CF_ALU_WORD1_COUNT_POS				18
-#define CF_ALU_WORD1_ALT_CONST_POS			25
-#define CF_ALU_WORD1_INST_POS				26
-#define CF_ALU_WORD1_WHOLE_QUAD_MODE_POS		30
-#define CF_ALU_WORD1_BARRIER_POS			31
-#define CF_ALU_WORD1_KCACHE_MODE1_BITS			2
-#define CF_ALU_WORD1_KCACHE_ADDR0_BITS			8
-#define CF_ALU_WORD1_KCACHE_ADDR1_BITS			8
-#define CF_ALU_WORD1_COUNT_BITS				7
-#define CF_ALU_WORD1_ALT_CONST_BITS			1
-#define CF_ALU_WORD1_INST_BITS				4
-#define CF_ALU_WORD1_WHOLE_QUAD_MODE_BITS		1
-#define CF_ALU_WORD1_BARRIER_BITS			1
+#define CF_ALU_WORD1_FIELDS(X, a)						\
+	X(a, CF_ALU_WORD1, KCACHE_MODE1, kcache_mode1, 0, 2)			\
+	X(a, CF_ALU_WORD1, KCACHE_ADDR0, kcache_addr0, 2, 8)			\
+	X(a, CF_ALU_WORD1, KCACHE_ADDR1, kcache_addr1, 10, 8)			\
+	X(a, CF_ALU_WORD1, COUNT, count, 18, 7)					\
+	X(a, CF_ALU_WORD1, ALT_CONST, alt_const, 25, 1)				\
+	X(a, CF_ALU_WORD1, INST, cf_inst, 26, 4)				\
+	X(a, CF_ALU_WORD1, WHOLE_QUAD_MODE, whole_quad_mode, 30, 1)		\
+	X(a, CF_ALU_WORD1, BARRIER, barrier, 31, 1)
+enum { CF_ALU_WORD1_FIELDS(ISA_CONSTS, ) };
+
+/**** CF_ALU_WORD0_EXT ****/
+#define CF_ALU_WORD0_EXT_FIELDS(X, a)						\
+	X(a, CF_ALU_WORD0_EXT, KCACHE_BANK_INDEX_MODE0, kcache_bank_index_mode0, 4, 2)	\
+	X(a, CF_ALU_WORD0_EXT, KCACHE_BANK_INDEX_MODE1, kcache_bank_index_mode1, 6, 2)	\
+	X(a, CF_ALU_WORD0_EXT, KCACHE_BANK_INDEX_MODE2, kcache_bank_index_mode2, 8, 2)	\
+	X(a, CF_ALU_WORD0_EXT, KCACHE_BANK_INDEX_MODE3, kcache_bank_index_mode3, 10, 2)	\
+	X(a, CF_ALU_WORD0_EXT, KCACHE_BANK2, kcache_bank2, 22, 4)		\
+	X(a, CF_ALU_WORD0_EXT, KCACHE_BANK3, kcache_bank3, 26, 4)		\
+	X(a, CF_ALU_WORD0_EXT, KCACHE_MODE2, kcache_mode2, 30, 2)
+enum { CF_ALU_WORD0_EXT_FIELDS(ISA_CONSTS, ) };
+
+/**** CF_ALU_WORD1_EXT ****/
+#define CF_ALU_WORD1_EXT_FIELDS(X, a)						\
+	X(a, CF_ALU_WORD1_EXT, KCACHE_MODE3, kcache_mode3, 0, 2)		\
+	X(a, CF_ALU_WORD1_EXT, KCACHE_ADDR2, kcache_addr2, 2, 8)		\
+	X(a, CF_ALU_WORD1_EXT, KCACHE_ADDR3, kcache_addr3, 10, 8)		\
+	X(a, CF_ALU_WORD1_EXT, INST, cf_inst, 26, 4)				\
+	X(a, CF_ALU_WORD1_EXT, BARRIER, barrier, 31, 1)
+enum { CF_ALU_WORD1_EXT_FIELDS(ISA_CONSTS, ) };
 
 /* val << 4, when considered relative to CF_WORD1.INST */
 #define CF_INST_ALU					8
@@ -103,166 +106,108 @@
 #define CF_INST_ALU_ELSE_AFTER				15
 
 /**** CF_{ALLOC,IMPORT,EXPORT}_WORD0 ****/
-#define CF_AIE_WORD0_ARRAY_BASE_POS			0
-#define CF_AIE_WORD0_TYPE_POS				13
-#define CF_AIE_WORD0_RW_GPR_POS				15
-#define CF_AIE_WORD0_RW_REL_POS				22
-#define CF_AIE_WORD0_INDEX_GPR_POS			23
-#define CF_AIE_WORD0_ELEM_SIZE_POS			30
-#define CF_AIE_WORD0_ARRAY_BASE_BITS			13
-#define CF_AIE_WORD0_TYPE_BITS				2
-#define CF_AIE_WORD0_RW_GPR_BITS			7
-#define CF_AIE_WORD0_RW_REL_BITS			1
-#define CF_AIE_WORD0_INDEX_GPR_BITS			7
-#define CF_AIE_WORD0_ELEM_SIZE_BITS			2
+/* ARRAY_BASE, or the RAT fields, and then these. */
+#define CF_AIE_WORD0_FIELDS(X, a)						\
+	X(a, CF_AIE_WORD0, TYPE, type, 13, 2)					\
+	X(a, CF_AIE_WORD0, RW_GPR, rw_gpr, 15, 7)				\
+	X(a, CF_AIE_WORD0, RW_REL, rw_rel, 22, 1)				\
+	X(a, CF_AIE_WORD0, INDEX_GPR, index_gpr, 23, 7)				\
+	X(a, CF_AIE_WORD0, ELEM_SIZE, elem_size, 30, 2)
+#define CF_AIE_WORD0_BASE_FIELDS(X, a)						\
+	X(a, CF_AIE_WORD0, ARRAY_BASE, array_base, 0, 13)
+enum { CF_AIE_WORD0_BASE_FIELDS(ISA_CONSTS, ) CF_AIE_WORD0_FIELDS(ISA_CONSTS, ) };
+
+/**** CF_{ALLOC,IMPORT,EXPORT}_WORD0_RAT ****/
+#define CF_AIE_WORD0_RAT_FIELDS(X, a)						\
+	X(a, CF_AIE_WORD0_RAT, ID, rat_id, 0, 4)				\
+	X(a, CF_AIE_WORD0_RAT, INST, rat_inst, 4, 6)				\
+	X(a, CF_AIE_WORD0_RAT, INDEX_MODE, rat_index_mode, 11, 2)
+enum { CF_AIE_WORD0_RAT_FIELDS(ISA_CONSTS, ) };
 
 #define EXPORT_TYPE_PIXEL				0
 #define EXPORT_TYPE_POS					1
 #define EXPORT_TYPE_PARAM				2
 
 /**** CF_{ALLOC,IMPORT,EXPORT}_WORD1_BUF ****/
-#define CF_AIE_WORD1_BUF_ARRAY_SIZE_POS			0
-#define CF_AIE_WORD1_BUF_COMP_MASK_POS			12
-#define CF_AIE_WORD1_BUF_ARRAY_SIZE_BITS		12
-#define CF_AIE_WORD1_BUF_COMP_MASK_BITS			4
+#define CF_AIE_WORD1_BUF_FIELDS(X, a)						\
+	X(a, CF_AIE_WORD1_BUF, ARRAY_SIZE, array_size, 0, 12)			\
+	X(a, CF_AIE_WORD1_BUF, COMP_MASK, comp_mask, 12, 4)
+enum { CF_AIE_WORD1_BUF_FIELDS(ISA_CONSTS, ) };
 
 /**** CF_{ALLOC,IMPORT,EXPORT}_WORD1_SWIZ ****/
-#define CF_AIE_WORD1_SWIZ_SEL_X_POS			0
-#define CF_AIE_WORD1_SWIZ_SEL_Y_POS			3
-#define CF_AIE_WORD1_SWIZ_SEL_Z_POS			6
-#define CF_AIE_WORD1_SWIZ_SEL_W_POS			9
-#define CF_AIE_WORD1_SWIZ_SEL_X_BITS			3
-#define CF_AIE_WORD1_SWIZ_SEL_Y_BITS			3
-#define CF_AIE_WORD1_SWIZ_SEL_Z_BITS			3
-#define CF_AIE_WORD1_SWIZ_SEL_W_BITS			3
+#define CF_AIE_WORD1_SWIZ_FIELDS(X, a)						\
+	X(a, CF_AIE_WORD1_SWIZ, SEL_X, sel_x, 0, 3)				\
+	X(a, CF_AIE_WORD1_SWIZ, SEL_Y, sel_y, 3, 3)				\
+	X(a, CF_AIE_WORD1_SWIZ, SEL_Z, sel_z, 6, 3)				\
+	X(a, CF_AIE_WORD1_SWIZ, SEL_W, sel_w, 9, 3)
+enum { CF_AIE_WORD1_SWIZ_FIELDS(ISA_CONSTS, ) };
 
 /**** CF_{ALLOC,IMPORT,EXPORT}_WORD1 ****/
-#define CF_AIE_WORD1_BURST_COUNT_POS			16
-#define CF_AIE_WORD1_VALID_PIXEL_MODE_POS		20
-#define CF_AIE_WORD1_END_OF_PROGRAM_POS			21
-#define CF_AIE_WORD1_INST_POS				22
-#define CF_AIE_WORD1_MARK_POS				30
-#define CF_AIE_WORD1_BARRIER_POS			31
-#define CF_AIE_WORD1_BURST_COUNT_BITS			4
-#define CF_AIE_WORD1_VALID_PIXEL_MODE_BITS		1
-#define CF_AIE_WORD1_END_OF_PROGRAM_BITS		1
-#define CF_AIE_WORD1_INST_BITS				8
-#define CF_AIE_WORD1_MARK_BITS				1
-#define CF_AIE_WORD1_BARRIER_BITS			1
+/* BUF or SWIZ, and then these. */
+#define CF_AIE_WORD1_FIELDS(X, a)						\
+	X(a, CF_AIE_WORD1, BURST_COUNT, burst_count, 16, 4)			\
+	X(a, CF_AIE_WORD1, VALID_PIXEL_MODE, valid_pixel_mode, 20, 1)		\
+	X(a, CF_AIE_WORD1, END_OF_PROGRAM, end_of_program, 21, 1)		\
+	X(a, CF_AIE_WORD1, INST, cf_inst, 22, 8)				\
+	X(a, CF_AIE_WORD1, MARK, mark, 30, 1)					\
+	X(a, CF_AIE_WORD1, BARRIER, barrier, 31, 1)
+enum { CF_AIE_WORD1_FIELDS(ISA_CONSTS, ) };
 
 #define CF_INST_EXPORT					83
 #define CF_INST_EXPORT_DONE				84
 
 struct inst_cf_w0 {
-	const char			*label;
-	int				addr;
-	int				jump_table_sel;
+	int				label;	/* sym id; -1 if none */
+	CF_WORD0_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_cf_gws_w0 {
-	int				value;
-	int				rsrc;
-	int				sign;
-	int				value_index_mode;
-	int				rsrc_index_mode;
-	int				gws_opcode;
+	CF_GWS_WORD0_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_cf_w1 {
-	int				pop_count;
-	int				cf_const;
-	int				cond;
-	int				count;
-	int				valid_pixel_mode;
-	int				end_of_program;
-	int				cf_inst;
-	int				whole_quad_mode;
-	int				barrier;
+	CF_WORD1_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_cf_alu_w0 {
-	const char			*label;
-	int				addr;
-	int				kcache_bank0;
-	int				kcache_bank1;
-	int				kcache_mode0;
+	int				label;	/* sym id; -1 if none */
+	CF_ALU_WORD0_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_cf_alu_w1 {
-	int				kcache_mode1;
-	int				kcache_addr0;
-	int				kcache_addr1;
-	int				count;
-	int				alt_const;
-	int				cf_inst;
-	int				whole_quad_mode;
-	int				barrier;
+	CF_ALU_WORD1_FIELDS(ISA_MEMBER, )
 };
 
 /* Also known as w0_ext */
 struct inst_cf_alu_w2 {
-	int				kcache_bank_index_mode0;
-	int				kcache_bank_index_mode1;
-	int				kcache_bank_index_mode2;
-	int				kcache_bank_index_mode3;
-	int				kcache_bank2;
-	int				kcache_bank3;
-	int				kcache_mode2;
+	CF_ALU_WORD0_EXT_FIELDS(ISA_MEMBER, )
 };
 
 /* Also known as w1_ext */
 struct inst_cf_alu_w3 {
-	int				kcache_mode3;
-	int				kcache_addr2;
-	int				kcache_addr3;
-	int				cf_inst;
-	int				barrier;
+	CF_ALU_WORD1_EXT_FIELDS(ISA_MEMBER, )
 };
 
 /* Works with both BUF and SWIZ */
 struct inst_cf_aie_w0 {
-	int				array_base;
-	int				type;
-	int				rw_gpr;
-	int				rw_rel;
-	int				index_gpr;
-	int				elem_size;
+	CF_AIE_WORD0_BASE_FIELDS(ISA_MEMBER, )
+	CF_AIE_WORD0_FIELDS(ISA_MEMBER, )
 };
 
 /* RAT works with BUF */
 struct inst_cf_aie_rat_w0 {
-	int				rat_id;
-	int				rat_inst;
-	int				rat_index_mode;
-	int				type;
-	int				rw_gpr;
-	int				rw_rel;
-	int				index_gpr;
-	int				elem_size;
+	CF_AIE_WORD0_RAT_FIELDS(ISA_MEMBER, )
+	CF_AIE_WORD0_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_cf_aie_buf_w1 {
-	int				array_size;
-	int				comp_mask;
-	int				burst_count;
-	int				valid_pixel_mode;
-	int				end_of_program;
-	int				cf_inst;
-	int				mark;
-	int				barrier;
+	CF_AIE_WORD1_BUF_FIELDS(ISA_MEMBER, )
+	CF_AIE_WORD1_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_cf_aie_swiz_w1 {
-	int				sel_x;
-	int				sel_y;
-	int				sel_z;
-	int				sel_w;
-	int				burst_count;
-	int				valid_pixel_mode;
-	int				end_of_program;
-	int				cf_inst;
-	int				mark;
-	int				barrier;
+	CF_AIE_WORD1_SWIZ_FIELDS(ISA_MEMBER, )
+	CF_AIE_WORD1_FIELDS(ISA_MEMBER, )
 };
 
 /* Instructions */
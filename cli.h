@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef CLI_H
+#define CLI_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+enum out_fmt {
+	OUT_HEX,	/* Annotated; the default */
+	OUT_BIN,	/* Little-endian words */
+	OUT_C,		/* A C array */
+};
+
+/* The command line; everything but the inputs. */
+struct cli_opts {
+	bool				single_pass;
+	bool				pipeline;	/* -P */
+	enum out_fmt			fmt;		/* -o */
+	int				num_chunk_threads;	/* -p */
+	const char			*out_dir;	/* Batch mode, if set */
+	const char			*manifest;
+	int				num_threads;	/* 0 for the # of cores */
+	const char			*watch_out;	/* -w, if set */
+	const char			*cache_dir;	/* -c, if set */
+	size_t				cache_size;	/* -C, in bytes */
+	const char			*serve_sock;	/* -S, if set */
+	const char			*remote_sock;	/* -r, if set */
+	bool				disassemble;	/* -D */
+	bool				round_trip;	/* -R */
+};
+
+#define CLI_CACHE_SIZE			(256ul << 20)
+
+/* An input file; regular files are mapped, others are read into memory. */
+struct input {
+	const char			*buf;
+	size_t				size;
+	bool				mapped;
+};
+
+#define OUT_CHUNK_SIZE			(256 * 1024)
+#define OUT_NUM_CHUNKS			16
+
+/*
+ * Output, in chunks that are filled in turn and written out together with one
+ * writev once all are full, or on a flush. Write errors are sticky.
+ */
+struct out_buf {
+	struct iovec			iov[OUT_NUM_CHUNKS];
+	off_t				off;	/* Of iov[0] in the output */
+	int				curr;	/* Being filled */
+	int				fd;
+	int				err;
+};
+
+struct inst_base;
+struct asm_base;
+struct cache;
+struct cache_key;
+
+int	input_open(struct input *this, const char *path);
+void	input_close(struct input *this);
+
+int	out_buf_construct(struct out_buf *this);
+void	out_buf_destruct(struct out_buf *this);
+void	out_buf_reset(struct out_buf *this, int fd);
+int	out_buf_flush(struct out_buf *this);
+off_t	out_buf_tell(const struct out_buf *this);
+void	out_buf_put_label(struct out_buf *this, const char *buf, size_t s,
+			  int len);
+void	out_buf_put_inst(struct out_buf *this, const struct inst_base *base,
+			 const char *buf, size_t ls, size_t le);
+
+int	out_write(struct out_buf *ob, int fd, enum out_fmt fmt,
+		  const struct asm_base *chunks, int num_chunks);
+int	out_fmt_parse(const char *name, enum out_fmt *out);
+const char	*out_fmt_ext(enum out_fmt fmt);
+
+void	out_cache_key(const char *buf, size_t size, enum out_fmt fmt,
+		      struct cache_key *out);
+int	out_write_cache(struct cache *cache, const struct cache_key *key,
+			struct out_buf *ob, int fd, enum out_fmt fmt,
+			const struct asm_base *chunks, int num_chunks);
+
+int	batch_main(const struct cli_opts *opts, char **paths, int num_paths);
+int	pipe_main(const char *path);
+int	watch_main(const struct cli_opts *opts, const char *path,
+		   const char *out);
+int	serve_main(const struct cli_opts *opts, const char *path);
+int	serve_client_main(const struct cli_opts *opts, const char *sock,
+			  const char *path);
+int	dump_main(const struct cli_opts *opts, char **paths, int num_paths);
+#endif
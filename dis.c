@@ -0,0 +1,1235 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "main.h"
+#include "dis.h"
+
+/*
+ * The disassembler of -D. The names, the registers, the sources and the text
+ * of the flags of each format for each value of their fields are rendered
+ * once, by dis_build; an instruction is printed by copies from those.
+ *
+ * On one core, a program decodes at about 185 MB/s of input, or 890 MB/s of
+ * text; the text is near 5 times the size of the words. That is short of
+ * the hundreds of MB/s of input asked for; what is left is the copy of
+ * the 40 or so characters of each instruction. Many inputs are decoded on as
+ * many threads, by dump.c; one input is not split.
+ */
+
+/* The formats the syntax has; an instruction of any other is not printed. */
+enum dis_fmt {
+	DIS_FMT_NONE,
+	DIS_FMT_CF,
+	DIS_FMT_CF_ALU,
+	DIS_FMT_CF_AIE_SWIZ,
+	DIS_FMT_ALU_OP2,
+	DIS_FMT_ALU_OP2_TRANS,
+	DIS_FMT_TEX,
+	DIS_FMT_VTX_GPR,
+	DIS_FMT_VTX_SEM,
+	DIS_NUM_FMTS,
+};
+
+/*
+ * A flag of the syntax; the field of mask in w[word] holds val. Its text, with
+ * the separators, is copied whole, and kept or not, as dis_build renders the
+ * flags of each format.
+ */
+struct dis_flag {
+	uint32_t			mask;
+	uint32_t			val;
+	unsigned char			word;
+	unsigned char			len;
+	char				text[8];
+};
+
+#define DIS_FLAG(word, f, val, name)					\
+	{bits_on(f), bits_set(f, val), word, sizeof(name) + 1, " " name ","}
+
+/*
+ * Of each format: the bits that must be 0, being reserved or without a syntax,
+ * and the flags, in the order the parser takes them.
+ */
+struct dis_fmt_desc {
+	uint32_t			zero[4];
+	const struct dis_flag		*flags;
+	int				num_flags;
+};
+
+/* A name, copied whole; len is 0 if there is none. */
+struct dis_name {
+	char				text[7];
+	unsigned char			len;
+};
+
+#define DIS_NAME(s)			{s, sizeof(s) - 1}
+
+/* An instruction of the CF program. */
+struct dis_op {
+	struct dis_name			name;
+	unsigned char			fmt;	/* enum dis_fmt */
+	unsigned char			clause;	/* enum dis_slot, if any */
+	unsigned char			flags;
+};
+
+#define DIS_OP_COUNT			(1 << 0)	/* (count) */
+#define DIS_OP_LABEL			(1 << 1)	/* Has an address */
+#define DIS_OP_CALL			(1 << 2)	/* To more CF */
+#define DIS_OP_END			(1 << 3)	/* Of a CF run */
+
+static const struct dis_flag dis_cf_flags[] = {
+	DIS_FLAG(1, CF_WORD1_END_OF_PROGRAM, 1, "eop"),
+	DIS_FLAG(1, CF_WORD1_VALID_PIXEL_MODE, 1, "vpm"),
+	DIS_FLAG(1, CF_WORD1_WHOLE_QUAD_MODE, 1, "wqm"),
+	DIS_FLAG(1, CF_WORD1_BARRIER, 1, "b"),
+};
+
+static const struct dis_flag dis_cf_alu_flags[] = {
+	DIS_FLAG(1, CF_ALU_WORD1_ALT_CONST, 1, "alt"),
+	DIS_FLAG(1, CF_ALU_WORD1_WHOLE_QUAD_MODE, 1, "wqm"),
+	DIS_FLAG(1, CF_ALU_WORD1_BARRIER, 1, "b"),
+};
+
+static const struct dis_flag dis_cf_aie_flags[] = {
+	DIS_FLAG(1, CF_AIE_WORD1_END_OF_PROGRAM, 1, "eop"),
+	DIS_FLAG(1, CF_AIE_WORD1_VALID_PIXEL_MODE, 1, "vpm"),
+	DIS_FLAG(0, CF_AIE_WORD0_RW_REL, 1, "rel"),
+	DIS_FLAG(1, CF_AIE_WORD1_MARK, 1, "m"),
+	DIS_FLAG(1, CF_AIE_WORD1_BARRIER, 1, "b"),
+};
+
+/* The bank swizzle is the same bits in the trans slot, with other names. */
+#define DIS_ALU_FLAGS(s021, s120, s102)					\
+	DIS_FLAG(0, ALU_WORD0_PRED_SEL, PRED_SEL_0, "ps0"),		\
+	DIS_FLAG(0, ALU_WORD0_PRED_SEL, PRED_SEL_1, "ps1"),		\
+	DIS_FLAG(0, ALU_WORD0_LAST, 1, "last"),				\
+	DIS_FLAG(0, ALU_WORD0_INDEX_MODE, INDEX_LOOP, "iml"),		\
+	DIS_FLAG(0, ALU_WORD0_INDEX_MODE, INDEX_GLOBAL, "img"),		\
+	DIS_FLAG(0, ALU_WORD0_INDEX_MODE, INDEX_GLOBAL_AR_X, "imga"),	\
+	DIS_FLAG(1, ALU_WORD1_OP2_UPDATE_EXEC_MASK, 1, "uem"),		\
+	DIS_FLAG(1, ALU_WORD1_OP2_UPDATE_PRED, 1, "up"),		\
+	DIS_FLAG(1, ALU_WORD1_BANK_SWIZZLE, 1, s021),			\
+	DIS_FLAG(1, ALU_WORD1_BANK_SWIZZLE, 2, s120),			\
+	DIS_FLAG(1, ALU_WORD1_BANK_SWIZZLE, 3, s102),			\
+	DIS_FLAG(1, ALU_WORD1_BANK_SWIZZLE, 4, "201"),			\
+	DIS_FLAG(1, ALU_WORD1_BANK_SWIZZLE, 5, "210"),
+
+static const struct dis_flag dis_alu_flags[] = {
+	DIS_ALU_FLAGS("021", "120", "102")
+};
+
+/*
+ * Of an ALU in the trans slot: one whose dst chan an ALU before it in the
+ * group has taken. The assembler takes either name of a bank swizzle on any
+ * ALU, as the bits are the same; a group that is not so ordered, or a trans
+ * op the only one of its chan, prints with the other names, and assembles to
+ * the same words.
+ */
+static const struct dis_flag dis_alu_trans_flags[] = {
+	DIS_ALU_FLAGS("122", "212", "221")
+};
+
+static const struct dis_flag dis_tex_flags[] = {
+	DIS_FLAG(0, TEX_WORD0_ALT_CONST, 1, "alt"),
+	DIS_FLAG(0, TEX_WORD0_SRC_REL, 1, "srel"),
+	DIS_FLAG(1, TEX_WORD1_DST_REL, 1, "drel"),
+	DIS_FLAG(0, TEX_WORD0_FETCH_WHOLE_QUAD, 1, "fwq"),
+	DIS_FLAG(0, TEX_WORD0_RSRC_INDEX_MODE, 1, "rim0"),
+	DIS_FLAG(0, TEX_WORD0_RSRC_INDEX_MODE, 2, "rim1"),
+	DIS_FLAG(0, TEX_WORD0_SAMPLER_INDEX_MODE, 1, "sim0"),
+	DIS_FLAG(0, TEX_WORD0_SAMPLER_INDEX_MODE, 2, "sim1"),
+	DIS_FLAG(1, TEX_WORD1_COORD_TYPE_X, 1, "xn"),
+	DIS_FLAG(1, TEX_WORD1_COORD_TYPE_Y, 1, "yn"),
+	DIS_FLAG(1, TEX_WORD1_COORD_TYPE_Z, 1, "zn"),
+	DIS_FLAG(1, TEX_WORD1_COORD_TYPE_W, 1, "wn"),
+};
+
+/* drel is in the GPR flavour only; it is ignored with sem. */
+#define DIS_VTX_FLAGS							\
+	DIS_FLAG(2, VTX_WORD2_ALT_CONST, 1, "alt"),			\
+	DIS_FLAG(2, VTX_WORD2_CONST_BUF_NO_STRIDE, 1, "cbns"),		\
+	DIS_FLAG(2, VTX_WORD2_MEGA_FETCH, 1, "mf"),			\
+	DIS_FLAG(1, VTX_WORD1_USE_CONST_FIELDS, 1, "ucf"),		\
+	DIS_FLAG(1, VTX_WORD1_SRF_MODE_ALL, 1, "sma"),			\
+	DIS_FLAG(0, VTX_WORD0_FETCH_WHOLE_QUAD, 1, "fwq"),		\
+	DIS_FLAG(0, VTX_WORD0_SRC_REL, 1, "srel"),
+
+static const struct dis_flag dis_vtx_gpr_flags[] = {
+	DIS_VTX_FLAGS
+	DIS_FLAG(1, VTX_WORD1_GPR_DST_REL, 1, "drel"),
+};
+
+static const struct dis_flag dis_vtx_sem_flags[] = {
+	DIS_VTX_FLAGS
+};
+
+#define dis_flags(f)			f, sizeof(f) / sizeof(f[0])
+#define dis_zero(list)			((uint32_t)~isa_mask(list))
+
+/* The bits that must be 0 of an op2 ALU, in the trans slot or not. */
+#define DIS_ALU_OP2_ZERO						\
+	{								\
+		dis_zero(ALU_WORD0_FIELDS) |				\
+		bits_on(ALU_WORD0_SRC0_REL) |				\
+		bits_on(ALU_WORD0_SRC1_REL),				\
+		(dis_zero(ALU_WORD1_OP2_FIELDS) &			\
+		 dis_zero(ALU_WORD1_FIELDS)) |				\
+		bits_on(ALU_WORD1_DST_REL) | bits_on(ALU_WORD1_CLAMP),	\
+	}
+
+static const struct dis_fmt_desc dis_fmts[DIS_NUM_FMTS] = {
+	[DIS_FMT_CF] = {
+		{
+			dis_zero(CF_WORD0_FIELDS) |
+			bits_on(CF_WORD0_JMP_TAB_SEL),
+			dis_zero(CF_WORD1_FIELDS) |
+			bits_on(CF_WORD1_POP_COUNT),
+		},
+		dis_flags(dis_cf_flags),
+	},
+	[DIS_FMT_CF_ALU] = {
+		{
+			dis_zero(CF_ALU_WORD0_FIELDS),
+			dis_zero(CF_ALU_WORD1_FIELDS),
+		},
+		dis_flags(dis_cf_alu_flags),
+	},
+	[DIS_FMT_CF_AIE_SWIZ] = {
+		{
+			dis_zero(CF_AIE_WORD0_BASE_FIELDS) &
+			dis_zero(CF_AIE_WORD0_FIELDS),
+			dis_zero(CF_AIE_WORD1_SWIZ_FIELDS) &
+			dis_zero(CF_AIE_WORD1_FIELDS),
+		},
+		dis_flags(dis_cf_aie_flags),
+	},
+	[DIS_FMT_ALU_OP2] = {
+		DIS_ALU_OP2_ZERO,
+		dis_flags(dis_alu_flags),
+	},
+	[DIS_FMT_ALU_OP2_TRANS] = {
+		DIS_ALU_OP2_ZERO,
+		dis_flags(dis_alu_trans_flags),
+	},
+	[DIS_FMT_TEX] = {
+		{
+			dis_zero(TEX_WORD0_FIELDS) |
+			bits_on(TEX_WORD0_INST_MOD),
+			dis_zero(TEX_WORD1_FIELDS),
+			dis_zero(TEX_WORD2_FIELDS),
+			0xffffffff,
+		},
+		dis_flags(dis_tex_flags),
+	},
+	[DIS_FMT_VTX_GPR] = {
+		{
+			dis_zero(VTX_WORD0_FIELDS) |
+			bits_on(VTX_WORD0_FETCH_TYPE) |
+			bits_on(VTX_WORD0_MEGA_FETCH_COUNT),
+			dis_zero(VTX_WORD1_GPR_FIELDS) &
+			dis_zero(VTX_WORD1_FIELDS),
+			dis_zero(VTX_WORD2_FIELDS) |
+			bits_on(VTX_WORD2_ENDIAN_SWAP) |
+			bits_on(VTX_WORD2_BUF_INDEX_MODE),
+			0xffffffff,
+		},
+		dis_flags(dis_vtx_gpr_flags),
+	},
+	[DIS_FMT_VTX_SEM] = {
+		{
+			dis_zero(VTX_WORD0_FIELDS) |
+			bits_on(VTX_WORD0_FETCH_TYPE) |
+			bits_on(VTX_WORD0_MEGA_FETCH_COUNT),
+			dis_zero(VTX_WORD1_SEM_FIELDS) &
+			dis_zero(VTX_WORD1_FIELDS),
+			dis_zero(VTX_WORD2_FIELDS) |
+			bits_on(VTX_WORD2_ENDIAN_SWAP) |
+			bits_on(VTX_WORD2_BUF_INDEX_MODE),
+			0xffffffff,
+		},
+		dis_flags(dis_vtx_sem_flags),
+	},
+};
+
+/*
+ * By CF_WORD1.INST; those of CF_ALU_WORD1.INST, in its top 4 bits, are by
+ * that INST instead.
+ */
+static const struct dis_op dis_cf_ops[CF_INST_ALU << 4] = {
+	[CF_INST_NOP]		= {DIS_NAME("nop"), DIS_FMT_CF, 0, 0},
+	[CF_INST_TC]		= {DIS_NAME("tc"), DIS_FMT_CF, DIS_SLOT_TEX,
+				   DIS_OP_COUNT | DIS_OP_LABEL},
+	[CF_INST_VC]		= {DIS_NAME("vc"), DIS_FMT_CF, DIS_SLOT_VTX,
+				   DIS_OP_COUNT | DIS_OP_LABEL},
+	[CF_INST_CALL_FS]	= {DIS_NAME("fs"), DIS_FMT_CF, 0,
+				   DIS_OP_LABEL | DIS_OP_CALL},
+	[CF_INST_RETURN]	= {DIS_NAME("ret"), DIS_FMT_CF, 0, DIS_OP_END},
+	[CF_INST_EXPORT_DONE]	= {DIS_NAME("xd"), DIS_FMT_CF_AIE_SWIZ, 0, 0},
+};
+
+static const struct dis_op dis_cf_alu_ops[1 << CF_ALU_WORD1_INST_BITS] = {
+	[CF_INST_ALU]		= {DIS_NAME("alu"), DIS_FMT_CF_ALU, DIS_SLOT_ALU,
+				   DIS_OP_COUNT | DIS_OP_LABEL},
+};
+
+static const struct dis_name dis_alu_op2_names[1 << ALU_WORD1_INST_BITS] = {
+	[ALU_INST_INTERP_XY]	= DIS_NAME("ixy"),
+	[ALU_INST_INTERP_Z]	= DIS_NAME("iz"),
+};
+
+static const struct dis_name dis_tex_names[1 << TEX_WORD0_INST_BITS] = {
+	[TC_INST_SAMPLE]	= DIS_NAME("samp"),
+};
+
+static const struct dis_name dis_vtx_formats[1 << VTX_WORD1_DATA_FORMAT_BITS] = {
+	[FMT_32_32_FLOAT]	= DIS_NAME("flt2"),
+	[FMT_32_32_32_FLOAT]	= DIS_NAME("flt3"),
+};
+
+static const struct dis_name dis_num_formats[1 << VTX_WORD1_NUM_FORMAT_ALL_BITS] = {
+	[NUM_FORMAT_NORM]	= DIS_NAME("n"),
+	[NUM_FORMAT_INT]	= DIS_NAME("i"),
+	[NUM_FORMAT_SCALED]	= DIS_NAME("s"),
+};
+
+static const struct dis_name dis_export_types[1 << CF_AIE_WORD0_TYPE_BITS] = {
+	[EXPORT_TYPE_PIXEL]	= DIS_NAME("pix"),
+	[EXPORT_TYPE_POS]	= DIS_NAME("pos"),
+	[EXPORT_TYPE_PARAM]	= DIS_NAME("prm"),
+};
+
+static const struct dis_name dis_omods[1 << ALU_WORD1_OP2_OUT_MOD_BITS] = {
+	[ALU_OMOD_OFF]		= DIS_NAME(""),
+	[ALU_OMOD_M2]		= DIS_NAME("*2"),
+	[ALU_OMOD_M4]		= DIS_NAME("*4"),
+	[ALU_OMOD_D2]		= DIS_NAME("/2"),
+};
+
+/* The first src sel of each of k0 to k3, as inst_alu_parse_src. */
+static const unsigned int dis_kcache_sels[] = {159, 191, 287, 319};
+#define DIS_KCACHE_SIZE			32
+#define DIS_NUM_GPRS			128
+
+/* By SEL_*; 6 has no character, and any other character is SEL_MASK. */
+static const char dis_sel_chars[] = "xyzw01?_";
+#define DIS_SEL_NONE			6
+
+static const char dis_hex[] = "0123456789abcdef";
+
+#define DIS_DEC_ROW(d)							\
+	d "0" d "1" d "2" d "3" d "4" d "5" d "6" d "7" d "8" d "9"
+
+/* The two digits of each of 0 to 99. */
+static const char dis_dec[] =
+	DIS_DEC_ROW("0") DIS_DEC_ROW("1") DIS_DEC_ROW("2") DIS_DEC_ROW("3")
+	DIS_DEC_ROW("4") DIS_DEC_ROW("5") DIS_DEC_ROW("6") DIS_DEC_ROW("7")
+	DIS_DEC_ROW("8") DIS_DEC_ROW("9");
+
+#define DIS_NUM_SRCS			(1 << ALU_WORD0_SRC0_SEL_BITS)
+
+/*
+ * The text of the flags of a format, and the ;, for each value of the fields
+ * they are in; len is 0 if a field holds a value none of its flags has.
+ */
+struct dis_flag_text {
+	char				text[55];
+	unsigned char			len;
+};
+
+/* A field with flags; its value is at bit at of the index of the text. */
+struct dis_flag_field {
+	uint32_t			mask;	/* Of the value */
+	unsigned char			word;
+	unsigned char			pos;
+	unsigned char			at;
+};
+
+#define DIS_MAX_FLAG_BITS		12	/* Those of TEX */
+
+struct dis_flag_ix {
+	struct dis_flag_field		fields[DIS_MAX_FLAG_BITS];
+	int				num_fields;
+};
+
+static struct dis_flag_ix dis_flag_ixs[DIS_NUM_FMTS];
+static struct dis_flag_text dis_flag_texts[DIS_NUM_FMTS][1 << DIS_MAX_FLAG_BITS];
+
+/* r0 to r127; and each src sel, as inst_alu_parse_src takes it. */
+static struct dis_name dis_gprs[DIS_NUM_GPRS];
+static struct dis_name dis_srcs[DIS_NUM_SRCS];
+static pthread_once_t dis_once = PTHREAD_ONCE_INIT;
+
+/* Of the words w, whose fields without flags are 0. */
+static
+void dis_build_flag_text(struct dis_flag_text *t, const uint32_t *w,
+			 const struct dis_fmt_desc *d)
+{
+	int i;
+	bool hit;
+	uint32_t all[4], on[4];
+	char *q, text[sizeof(t->text) + 8];
+	const struct dis_flag *f;
+
+	memset(all, 0, sizeof(all));
+	memset(on, 0, sizeof(on));
+	for (i = 0, q = text; i < d->num_flags; ++i) {
+		f = &d->flags[i];
+		hit = (w[f->word] & f->mask) == f->val;
+		all[f->word] |= f->mask;
+		on[f->word] |= hit ? f->mask : 0;
+		memcpy(q, f->text, sizeof(f->text));
+		q += hit ? f->len : 0;
+	}
+
+	t->len = 0;
+	for (i = 0; i < 4; ++i) {
+		if (w[i] & all[i] & ~on[i])
+			return;
+	}
+
+	/* The last , becomes the ; */
+	if (q == text)
+		*q++ = ';';
+	else
+		q[-1] = ';';
+	*q++ = '\n';
+	assert(q - text <= (int)sizeof(t->text));
+	memcpy(t->text, text, q - text);
+	t->len = q - text;
+}
+
+static
+void dis_build_flags(int fmt)
+{
+	int i, k, at;
+	unsigned int ix;
+	uint32_t w[4];
+	const struct dis_fmt_desc *d;
+	const struct dis_flag *g;
+	struct dis_flag_ix *x;
+	struct dis_flag_field *f;
+
+	d = &dis_fmts[fmt];
+	x = &dis_flag_ixs[fmt];
+	for (i = 0, at = 0; i < d->num_flags; ++i) {
+		g = &d->flags[i];
+		for (k = 0; k < x->num_fields; ++k) {
+			f = &x->fields[k];
+			if (f->word == g->word && f->mask << f->pos == g->mask)
+				break;
+		}
+		if (k < x->num_fields)
+			continue;
+		f = &x->fields[x->num_fields++];
+		f->word = g->word;
+		f->pos = __builtin_ctz(g->mask);
+		f->mask = g->mask >> f->pos;
+		f->at = at;
+		at += __builtin_popcount(g->mask);
+	}
+	assert(at <= DIS_MAX_FLAG_BITS);
+
+	for (ix = 0; ix < 1u << at; ++ix) {
+		memset(w, 0, sizeof(w));
+		for (k = 0; k < x->num_fields; ++k) {
+			f = &x->fields[k];
+			w[f->word] |= ((ix >> f->at) & f->mask) << f->pos;
+		}
+		dis_build_flag_text(&dis_flag_texts[fmt][ix], w, d);
+	}
+}
+
+static
+void dis_build(void)
+{
+	int i, k;
+	struct dis_name *n;
+
+	for (i = 0; i < DIS_NUM_FMTS; ++i)
+		dis_build_flags(i);
+
+	for (i = 0; i < DIS_NUM_GPRS; ++i) {
+		n = &dis_gprs[i];
+		n->len = snprintf(n->text, sizeof(n->text), "r%d", i);
+		dis_srcs[ALU_SRC_GPR_BASE + i] = *n;
+	}
+	for (i = ALU_SRC_PARAM_BASE; i < DIS_NUM_SRCS; ++i) {
+		n = &dis_srcs[i];
+		n->len = snprintf(n->text, sizeof(n->text), "p%d",
+				  i - ALU_SRC_PARAM_BASE);
+	}
+	for (k = 0; k < 4; ++k) {
+		for (i = 0; i < DIS_KCACHE_SIZE; ++i) {
+			n = &dis_srcs[dis_kcache_sels[k] + i];
+			n->len = snprintf(n->text, sizeof(n->text), "k%d[%d]",
+					  k, i);
+		}
+	}
+}
+
+/* The word i of the instruction at slot pc. */
+static inline
+uint32_t dis_word(const struct dis *this, size_t pc, int i)
+{
+	uint32_t w;
+
+	memcpy(&w, &this->buf[pc * DIS_SLOT_SIZE + i * sizeof(w)], sizeof(w));
+	if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		w = __builtin_bswap32(w);
+	return w;
+}
+
+static inline
+const struct dis_op *dis_cf_op(uint32_t w1)
+{
+	unsigned int inst;
+
+	inst = bits_get(w1, CF_WORD1_INST);
+	if (inst >= CF_INST_ALU << 4)
+		return &dis_cf_alu_ops[inst >> 4];
+	return &dis_cf_ops[inst];
+}
+
+/**** Walk ****/
+static
+int dis_push_run(struct dis *this, size_t pc)
+{
+	size_t n, *t;
+
+	if (this->num_runs == this->max_runs) {
+		n = this->max_runs ? 2 * this->max_runs : 64;
+		t = realloc(this->runs, n * sizeof(*t));
+		if (t == NULL)
+			return ENOMEM;
+		this->runs = t;
+		this->max_runs = n;
+	}
+	this->runs[this->num_runs++] = pc;
+	return 0;
+}
+
+/*
+ * The count instructions of a clause, of kind, at addr; the first to claim a
+ * slot keeps it, and the clause ends at a slot already claimed.
+ */
+static
+void dis_mark_clause(struct dis *this, size_t addr, int count, int kind)
+{
+	int i, n;
+	size_t pc;
+	unsigned char *s;
+
+	if (addr >= this->num_slots)
+		return;
+	s = this->slots;
+	s[addr] |= DIS_SLOT_LABEL;
+
+	n = kind == DIS_SLOT_ALU ? 1 : 2;
+	for (pc = addr; count && pc + n <= this->num_slots; pc += n, --count) {
+		for (i = 0; i < n; ++i) {
+			if (s[pc + i] & DIS_SLOT_KIND)
+				return;
+		}
+		s[pc] |= kind;
+		if (n == 2)
+			s[pc + 1] |= DIS_SLOT_HIGH;
+	}
+}
+
+/* Each run goes on until a ret, an eop, or a slot already claimed. */
+static
+int dis_walk(struct dis *this, size_t start)
+{
+	int err, count;
+	size_t pc, addr;
+	uint32_t w0, w1;
+	unsigned char *s;
+	const struct dis_op *op;
+
+	s = this->slots;
+	err = dis_push_run(this, start);
+	while (!err && this->num_runs) {
+		pc = this->runs[--this->num_runs];
+		for (; pc < this->num_slots && !(s[pc] & DIS_SLOT_KIND); ++pc) {
+			s[pc] |= DIS_SLOT_CF;
+			w0 = dis_word(this, pc, 0);
+			w1 = dis_word(this, pc, 1);
+			op = dis_cf_op(w1);
+
+			if (op->fmt == DIS_FMT_CF_ALU) {
+				addr = bits_get(w0, CF_ALU_WORD0_ADDR);
+				count = bits_get(w1, CF_ALU_WORD1_COUNT) + 1;
+				dis_mark_clause(this, addr, count, op->clause);
+				continue;
+			}
+
+			addr = bits_get(w0, CF_WORD0_ADDR);
+			count = bits_get(w1, CF_WORD1_COUNT) + 1;
+			if (op->clause)
+				dis_mark_clause(this, addr, count, op->clause);
+			if ((op->flags & DIS_OP_CALL) && addr < this->num_slots) {
+				s[addr] |= DIS_SLOT_LABEL;
+				err = dis_push_run(this, addr);
+				if (err)
+					break;
+			}
+
+			/* At the same bit in CF_WORD1 and CF_AIE_WORD1. */
+			if ((op->flags & DIS_OP_END) ||
+			    bits_get(w1, CF_WORD1_END_OF_PROGRAM))
+				break;
+		}
+	}
+	return err;
+}
+
+/**** Print ****/
+static inline
+char *dis_put_str(char *p, const char *s)
+{
+	size_t n;
+
+	n = strlen(s);
+	memcpy(p, s, n);
+	return p + n;
+}
+
+static inline
+char *dis_put_name(char *p, const struct dis_name *n)
+{
+	memcpy(p, n->text, sizeof(n->text));
+	return p + n->len;
+}
+
+/* %u, for v below 10^8, as every field is. */
+static inline
+char *dis_put_uint(char *p, unsigned int v)
+{
+	int n;
+	unsigned int hi, lo;
+	char t[16];
+
+	assert(v < 100000000);
+	hi = v / 10000;
+	lo = v % 10000;
+	memcpy(&t[0], &dis_dec[2 * (hi / 100)], 2);
+	memcpy(&t[2], &dis_dec[2 * (hi % 100)], 2);
+	memcpy(&t[4], &dis_dec[2 * (lo / 100)], 2);
+	memcpy(&t[6], &dis_dec[2 * (lo % 100)], 2);
+	memset(&t[8], 0, 8);
+	n = 1 + (v >= 10) + (v >= 100) + (v >= 1000) + (v >= 10000) +
+		(v >= 100000) + (v >= 1000000) + (v >= 10000000);
+	memcpy(p, &t[8 - n], 8);
+	return p + n;
+}
+
+static inline
+char *dis_put_gpr(char *p, unsigned int gpr)
+{
+	assert(gpr < DIS_NUM_GPRS);
+	return dis_put_name(p, &dis_gprs[gpr]);
+}
+
+/* .xyzw; NULL if a sel has no character. */
+static inline
+char *dis_put_swizzle(char *p, unsigned int x, unsigned int y, unsigned int z,
+		      unsigned int w)
+{
+	if (x == DIS_SEL_NONE || y == DIS_SEL_NONE || z == DIS_SEL_NONE ||
+	    w == DIS_SEL_NONE)
+		return NULL;
+	*p++ = '.';
+	*p++ = dis_sel_chars[x];
+	*p++ = dis_sel_chars[y];
+	*p++ = dis_sel_chars[z];
+	*p++ = dis_sel_chars[w];
+	return p;
+}
+
+/*
+ * Of the address of a CF; NULL if no instruction begins there, or if the one
+ * there has no syntax, and so no label.
+ */
+static inline
+char *dis_put_ref(const struct dis *this, char *p, size_t addr)
+{
+	if (addr >= this->num_slots ||
+	    (this->slots[addr] & DIS_SLOT_KIND) == DIS_SLOT_HIGH ||
+	    (this->slots[addr] & DIS_SLOT_BAD))
+		return NULL;
+	*p++ = ' ';
+	*p++ = 'L';
+	return dis_put_uint(p, addr);
+}
+
+/*
+ * The flags and the ;, from the text of the values of the fields with flags.
+ * NULL if one holds a value none of its flags has, or if the words have bits
+ * set that must be 0.
+ */
+static inline
+char *dis_put_flags(char *p, const uint32_t *w, int fmt)
+{
+	int i;
+	unsigned int ix;
+	const struct dis_fmt_desc *d;
+	const struct dis_flag_ix *x;
+	const struct dis_flag_field *f;
+	const struct dis_flag_text *t;
+
+	d = &dis_fmts[fmt];
+	if ((w[0] & d->zero[0]) | (w[1] & d->zero[1]) | (w[2] & d->zero[2]) |
+	    (w[3] & d->zero[3]))
+		return NULL;
+
+	x = &dis_flag_ixs[fmt];
+	for (i = 0, ix = 0; i < x->num_fields; ++i) {
+		f = &x->fields[i];
+		ix |= ((w[f->word] >> f->pos) & f->mask) << f->at;
+	}
+	t = &dis_flag_texts[fmt][ix];
+	if (t->len == 0)
+		return NULL;
+	memcpy(p, t->text, sizeof(t->text));
+	return p + t->len;
+}
+
+static
+char *dis_put_cf(const struct dis *this, char *p, const uint32_t *w,
+		 const struct dis_op *op)
+{
+	struct inst_cf in;
+
+	isa_unpack(CF_WORD0_FIELDS, &in.w0, w[0]);
+	isa_unpack(CF_WORD1_FIELDS, &in.w1, w[1]);
+
+	p = dis_put_str(p, "\tc.");
+	p = dis_put_name(p, &op->name);
+	if (op->flags & DIS_OP_COUNT) {
+		*p++ = '(';
+		p = dis_put_uint(p, in.w1.count + 1);
+		*p++ = ')';
+	} else if (in.w1.count) {
+		return NULL;
+	}
+
+	switch (in.w1.cond) {
+	case CF_COND_ACTIVE:
+	case CF_COND_FALSE:
+		if (in.w1.cf_const)
+			return NULL;
+		if (in.w1.cond == CF_COND_FALSE)
+			p = dis_put_str(p, " cc.f");
+		break;
+	case CF_COND_BOOL:
+	case CF_COND_NOT_BOOL:
+		p = dis_put_str(p, in.w1.cond == CF_COND_BOOL ? " cc.b(" :
+				" cc.nb(");
+		p = dis_put_uint(p, in.w1.cf_const);
+		*p++ = ')';
+		break;
+	}
+
+	if (op->flags & DIS_OP_LABEL)
+		p = dis_put_ref(this, p, in.w0.addr);
+	else if (in.w0.addr)
+		return NULL;
+	if (p == NULL)
+		return NULL;
+	return dis_put_flags(p, w, DIS_FMT_CF);
+}
+
+/* kc#(bank[addr],mode); nothing for the default. */
+static
+char *dis_put_kcache(char *p, int ix, unsigned int bank, unsigned int addr,
+		     unsigned int mode)
+{
+	static const char *const modes[] = {"nop", "l1", "l2", "lli"};
+
+	if (bank == 0 && addr == 0 && mode == CF_KCACHE_MODE_NOP)
+		return p;
+	p = dis_put_str(p, ix ? " kc1(" : " kc0(");
+	p = dis_put_uint(p, bank);
+	*p++ = '[';
+	p = dis_put_uint(p, addr);
+	*p++ = ']';
+	*p++ = ',';
+	p = dis_put_str(p, modes[mode]);
+	*p++ = ')';
+	return p;
+}
+
+static
+char *dis_put_cf_alu(const struct dis *this, char *p, const uint32_t *w,
+		     const struct dis_op *op)
+{
+	struct inst_cf_alu in;
+
+	isa_unpack(CF_ALU_WORD0_FIELDS, &in.w0, w[0]);
+	isa_unpack(CF_ALU_WORD1_FIELDS, &in.w1, w[1]);
+
+	p = dis_put_str(p, "\tc.");
+	p = dis_put_name(p, &op->name);
+	*p++ = '(';
+	p = dis_put_uint(p, in.w1.count + 1);
+	*p++ = ')';
+	p = dis_put_kcache(p, 0, in.w0.kcache_bank0, in.w1.kcache_addr0,
+			   in.w0.kcache_mode0);
+	p = dis_put_kcache(p, 1, in.w0.kcache_bank1, in.w1.kcache_addr1,
+			   in.w1.kcache_mode1);
+	p = dis_put_ref(this, p, in.w0.addr);
+	if (p == NULL)
+		return NULL;
+	return dis_put_flags(p, w, DIS_FMT_CF_ALU);
+}
+
+static
+char *dis_put_cf_aie_swiz(char *p, const uint32_t *w, const struct dis_op *op)
+{
+	const struct dis_name *type;
+	struct inst_cf_aie_swiz in;
+
+	isa_unpack(CF_AIE_WORD0_BASE_FIELDS, &in.w0, w[0]);
+	isa_unpack(CF_AIE_WORD0_FIELDS, &in.w0, w[0]);
+	isa_unpack(CF_AIE_WORD1_SWIZ_FIELDS, &in.w1, w[1]);
+	isa_unpack(CF_AIE_WORD1_FIELDS, &in.w1, w[1]);
+
+	type = &dis_export_types[in.w0.type];
+	if (type->len == 0)
+		return NULL;
+
+	p = dis_put_str(p, "\tc.");
+	p = dis_put_name(p, &op->name);
+	*p++ = '.';
+	p = dis_put_name(p, type);
+	*p++ = '(';
+	p = dis_put_uint(p, in.w1.burst_count + 1);
+	*p++ = ')';
+
+	p = dis_put_str(p, " [");
+	p = dis_put_uint(p, in.w0.array_base);
+	if (in.w0.index_gpr || in.w0.elem_size) {
+		p = dis_put_str(p, " + ");
+		p = dis_put_gpr(p, in.w0.index_gpr);
+		p = dis_put_str(p, " * ");
+		p = dis_put_uint(p, in.w0.elem_size + 1);
+	}
+	p = dis_put_str(p, "], ");
+	p = dis_put_gpr(p, in.w0.rw_gpr);
+	p = dis_put_swizzle(p, in.w1.sel_x, in.w1.sel_y, in.w1.sel_z,
+			    in.w1.sel_w);
+	if (p == NULL)
+		return NULL;
+	return dis_put_flags(p, w, DIS_FMT_CF_AIE_SWIZ);
+}
+
+/* As inst_alu_parse_src; NULL if sel has no syntax. */
+static inline
+char *dis_put_alu_src(char *p, unsigned int sel, unsigned int chan,
+		      unsigned int neg, unsigned int abs)
+{
+	const struct dis_name *n;
+
+	n = &dis_srcs[sel];
+	if (n->len == 0)
+		return NULL;
+	*p = '+';
+	p += abs;
+	*p = '-';
+	p += neg;
+	p = dis_put_name(p, n);
+	*p++ = '.';
+	*p++ = dis_sel_chars[chan];
+	return p;
+}
+
+static
+char *dis_put_alu(char *p, const uint32_t *w, bool trans)
+{
+	const struct dis_name *name;
+	struct inst_alu in;
+
+	isa_unpack(ALU_WORD1_FIELDS, &in.w1, w[1]);
+	name = &dis_alu_op2_names[in.w1.alu_inst];
+	if (name->len == 0)
+		return NULL;
+	isa_unpack(ALU_WORD0_FIELDS, &in.w0, w[0]);
+	isa_unpack(ALU_WORD1_OP2_FIELDS, &in.w1, w[1]);
+
+	p = dis_put_str(p, "\ta.");
+	p = dis_put_name(p, name);
+	*p++ = ' ';
+	if (in.w1.write_enable)
+		p = dis_put_gpr(p, in.w1.dst_gpr);
+	else if (in.w1.dst_gpr)
+		return NULL;
+	else
+		*p++ = '-';
+	*p++ = '.';
+	*p++ = dis_sel_chars[in.w1.dst_chan];
+	p = dis_put_name(p, &dis_omods[in.w1.omod]);
+
+	*p++ = ',';
+	*p++ = ' ';
+	p = dis_put_alu_src(p, in.w0.src0_sel, in.w0.src0_chan, in.w0.src0_neg,
+			    in.w1.src0_abs);
+	if (p == NULL)
+		return NULL;
+	*p++ = ',';
+	*p++ = ' ';
+	p = dis_put_alu_src(p, in.w0.src1_sel, in.w0.src1_chan, in.w0.src1_neg,
+			    in.w1.src1_abs);
+	if (p == NULL)
+		return NULL;
+	return dis_put_flags(p, w, trans ? DIS_FMT_ALU_OP2_TRANS :
+			     DIS_FMT_ALU_OP2);
+}
+
+static
+char *dis_put_tex(char *p, const uint32_t *w)
+{
+	const struct dis_name *name;
+	struct inst_tex in;
+
+	isa_unpack(TEX_WORD0_FIELDS, &in.w0, w[0]);
+	name = &dis_tex_names[in.w0.tex_inst];
+	if (name->len == 0)
+		return NULL;
+	isa_unpack(TEX_WORD1_FIELDS, &in.w1, w[1]);
+	isa_unpack(TEX_WORD2_FIELDS, &in.w2, w[2]);
+
+	p = dis_put_str(p, "\tt.");
+	p = dis_put_name(p, name);
+	*p++ = ' ';
+	p = dis_put_gpr(p, in.w1.dst_gpr);
+	p = dis_put_swizzle(p, in.w1.dst_sel_x, in.w1.dst_sel_y,
+			    in.w1.dst_sel_z, in.w1.dst_sel_w);
+	if (p == NULL)
+		return NULL;
+
+	p = dis_put_str(p, ", ps[");
+	p = dis_put_uint(p, in.w2.sampler_id);
+	p = dis_put_str(p, "][");
+	p = dis_put_uint(p, in.w0.rsrc_id);
+	p = dis_put_str(p, "][");
+	p = dis_put_gpr(p, in.w0.src_gpr);
+	p = dis_put_swizzle(p, in.w2.src_sel_x, in.w2.src_sel_y,
+			    in.w2.src_sel_z, in.w2.src_sel_w);
+	if (p == NULL)
+		return NULL;
+	*p++ = ']';
+
+	if (in.w2.offset_x || in.w2.offset_y || in.w2.offset_z ||
+	    in.w1.lod_bias) {
+		p = dis_put_str(p, " + [");
+		p = dis_put_uint(p, in.w2.offset_x);
+		*p++ = ',';
+		*p++ = ' ';
+		p = dis_put_uint(p, in.w2.offset_y);
+		*p++ = ',';
+		*p++ = ' ';
+		p = dis_put_uint(p, in.w2.offset_z);
+		*p++ = ',';
+		*p++ = ' ';
+		p = dis_put_uint(p, in.w1.lod_bias);
+		*p++ = ']';
+	}
+	return dis_put_flags(p, w, DIS_FMT_TEX);
+}
+
+static
+char *dis_put_vtx(char *p, const uint32_t *w)
+{
+	int fmt;
+	const struct dis_name *data_fmt, *num_fmt;
+	struct inst_vtx in;
+
+	isa_unpack(VTX_WORD0_FIELDS, &in.w0, w[0]);
+	isa_unpack(VTX_WORD1_FIELDS, &in.w1, w[1]);
+	isa_unpack(VTX_WORD2_FIELDS, &in.w2, w[2]);
+	data_fmt = &dis_vtx_formats[in.w1.data_format];
+	num_fmt = &dis_num_formats[in.w1.num_format_all];
+	if (data_fmt->len == 0 || num_fmt->len == 0)
+		return NULL;
+
+	switch (in.w0.vc_inst) {
+	case VC_INST_FETCH:
+		isa_unpack(VTX_WORD1_GPR_FIELDS, &in.w1, w[1]);
+		p = dis_put_str(p, "\tv.reg ");
+		p = dis_put_gpr(p, in.w1.dst_gpr);
+		fmt = DIS_FMT_VTX_GPR;
+		break;
+	case VC_INST_SEMANTIC:
+		isa_unpack(VTX_WORD1_SEM_FIELDS, &in.w1, w[1]);
+		p = dis_put_str(p, "\tv.sem ");
+		p = dis_put_uint(p, in.w1.sem_id);
+		fmt = DIS_FMT_VTX_SEM;
+		break;
+	default:
+		return NULL;
+	}
+
+	*p++ = ',';
+	*p++ = ' ';
+	p = dis_put_name(p, data_fmt);
+	*p++ = ',';
+	*p++ = ' ';
+	if (in.w1.format_comp_all == FORMAT_COMP_SIGNED)
+		*p++ = '-';
+	p = dis_put_name(p, num_fmt);
+
+	p = dis_put_str(p, ", fs[");
+	p = dis_put_uint(p, in.w0.buffer_id);
+	p = dis_put_str(p, "][");
+	p = dis_put_uint(p, in.w2.offset);
+	*p++ = ']';
+	p = dis_put_swizzle(p, in.w1.dst_sel_x, in.w1.dst_sel_y,
+			    in.w1.dst_sel_z, in.w1.dst_sel_w);
+	if (p == NULL)
+		return NULL;
+
+	*p++ = ',';
+	*p++ = ' ';
+	p = dis_put_gpr(p, in.w0.src_gpr);
+	*p++ = '.';
+	*p++ = dis_sel_chars[in.w0.src_sel_x];
+	return dis_put_flags(p, w, fmt);
+}
+
+/* The words, in a comment. */
+static
+char *dis_put_bad(char *p, const uint32_t *w, int num_words)
+{
+	int i, j;
+
+	*p++ = '\t';
+	*p++ = '#';
+	for (i = 0; i < num_words; ++i) {
+		*p++ = ' ';
+		*p++ = '0';
+		*p++ = 'x';
+		for (j = 28; j >= 0; j -= 4)
+			*p++ = dis_hex[(w[i] >> j) & 0xf];
+	}
+	*p++ = '\n';
+	return p;
+}
+
+static
+int dis_reserve(struct dis *this, size_t n)
+{
+	size_t max;
+	char *t;
+
+	if (this->max_len - this->len >= n)
+		return 0;
+	max = this->max_len ? 2 * this->max_len : 64 * 1024;
+	while (max - this->len < n)
+		max *= 2;
+	t = realloc(this->text, max);
+	if (t == NULL)
+		return ENOMEM;
+	this->text = t;
+	this->max_len = max;
+	return 0;
+}
+
+/* The words of the instruction at slot pc; their number is returned. */
+static inline
+int dis_get_words(const struct dis *this, size_t pc, uint32_t *w)
+{
+	int i, kind, num_words;
+
+	kind = this->slots[pc] & DIS_SLOT_KIND;
+	num_words = kind == DIS_SLOT_TEX || kind == DIS_SLOT_VTX ? 4 : 2;
+	for (i = 0; i < num_words; ++i)
+		w[i] = dis_word(this, pc, i);
+	for (; i < 4; ++i)
+		w[i] = 0;
+	return num_words;
+}
+
+/*
+ * If the instruction at slot pc is an ALU in the trans slot; chans are those
+ * the ALUs before it in its group take, and are updated. The validity of an
+ * ALU does not depend on it.
+ */
+static inline
+bool dis_is_trans(const struct dis *this, size_t pc, unsigned int *chans)
+{
+	bool trans;
+	unsigned int chan;
+
+	if ((this->slots[pc] & DIS_SLOT_KIND) != DIS_SLOT_ALU) {
+		*chans = 0;
+		return false;
+	}
+	chan = 1 << bits_get(dis_word(this, pc, 1), ALU_WORD1_DST_CHAN);
+	trans = *chans & chan;
+	*chans |= chan;
+	if (bits_get(dis_word(this, pc, 0), ALU_WORD0_LAST))
+		*chans = 0;
+	return trans;
+}
+
+/*
+ * The instruction of words w at slot pc; NULL if it has no syntax. A TC clause
+ * may hold a VTX, and a VC one a TEX; each fetch is by its own inst.
+ */
+static
+char *dis_put_syntax(const struct dis *this, char *p, size_t pc,
+		     const uint32_t *w, bool trans)
+{
+	const struct dis_op *op;
+
+	switch (this->slots[pc] & DIS_SLOT_KIND) {
+	case DIS_SLOT_ALU:
+		return dis_put_alu(p, w, trans);
+	case DIS_SLOT_TEX:
+	case DIS_SLOT_VTX:
+		if (bits_get(w[0], VTX_WORD0_INST) <= VC_INST_SEMANTIC)
+			return dis_put_vtx(p, w);
+		return dis_put_tex(p, w);
+	default:
+		break;
+	}
+
+	op = dis_cf_op(w[1]);
+	switch (op->fmt) {
+	case DIS_FMT_CF:
+		return dis_put_cf(this, p, w, op);
+	case DIS_FMT_CF_ALU:
+		return dis_put_cf_alu(this, p, w, op);
+	case DIS_FMT_CF_AIE_SWIZ:
+		return dis_put_cf_aie_swiz(p, w, op);
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * The instruction at slot pc, or its words in a comment if it has no syntax;
+ * the slots it takes are returned in *n.
+ */
+static
+char *dis_put_inst(struct dis *this, char *p, size_t pc, bool trans, int *n)
+{
+	int num_words;
+	uint32_t w[4];
+	char *q;
+
+	num_words = dis_get_words(this, pc, w);
+	*n = num_words / 2;
+	q = dis_put_syntax(this, p, pc, w, trans);
+	if (q)
+		return q;
+	++this->num_bad;
+	return dis_put_bad(p, w, num_words);
+}
+
+/*
+ * A label cannot be on a comment; a slot that is referenced, but that has no
+ * syntax, is marked bad, and the CFs that reference it are printed as
+ * comments, too. Those may themselves be referenced; hence the repeat.
+ */
+static
+void dis_mark_bad(struct dis *this)
+{
+	bool again;
+	size_t pc;
+	uint32_t w[4];
+	unsigned char *s;
+	char t[DIS_LINE_SIZE];
+
+	s = this->slots;
+	do {
+		again = false;
+		for (pc = 0; pc < this->num_slots; ++pc) {
+			if ((s[pc] & (DIS_SLOT_LABEL | DIS_SLOT_BAD)) !=
+			    DIS_SLOT_LABEL ||
+			    (s[pc] & DIS_SLOT_KIND) == DIS_SLOT_HIGH)
+				continue;
+			dis_get_words(this, pc, w);
+			if (dis_put_syntax(this, t, pc, w, false))
+				continue;
+			s[pc] |= DIS_SLOT_BAD;
+			again = true;
+		}
+	} while (again);
+}
+
+/*
+ * The text of the program of size bytes at buf, in this->text. The CF program
+ * is walked from slot 0, and from the slots the walk does not reach, in turn;
+ * the clauses are found through the CFs that reference them.
+ */
+int dis_decode(struct dis *this, const char *buf, size_t size)
+{
+	int n, err;
+	bool trans;
+	unsigned int chans;
+	size_t pc;
+	char *p;
+	unsigned char *t;
+
+	if (size % DIS_SLOT_SIZE)
+		return EINVAL;
+	pthread_once(&dis_once, dis_build);
+
+	this->buf = buf;
+	this->num_slots = size / DIS_SLOT_SIZE;
+	this->len = 0;
+	this->num_insts = this->num_bad = 0;
+	if (this->num_slots > this->max_slots) {
+		t = realloc(this->slots, this->num_slots);
+		if (t == NULL)
+			return ENOMEM;
+		this->slots = t;
+		this->max_slots = this->num_slots;
+	}
+	memset(this->slots, 0, this->num_slots);
+
+	for (pc = 0; pc < this->num_slots; ++pc) {
+		if (this->slots[pc] & DIS_SLOT_KIND)
+			continue;
+		err = dis_walk(this, pc);
+		if (err)
+			return err;
+	}
+	dis_mark_bad(this);
+
+	/* About 40 characters an instruction. */
+	err = dis_reserve(this, 5 * size + DIS_LINE_SIZE);
+	if (err)
+		return err;
+
+	chans = 0;
+	for (pc = 0; pc < this->num_slots; pc += n) {
+		err = dis_reserve(this, DIS_LINE_SIZE);
+		if (err)
+			return err;
+
+		p = &this->text[this->len];
+		if ((this->slots[pc] & (DIS_SLOT_LABEL | DIS_SLOT_BAD)) ==
+		    DIS_SLOT_LABEL) {
+			*p++ = 'L';
+			p = dis_put_uint(p, pc);
+			*p++ = ':';
+			*p++ = '\n';
+		}
+
+		trans = dis_is_trans(this, pc, &chans);
+		p = dis_put_inst(this, p, pc, trans, &n);
+		++this->num_insts;
+		this->len = p - this->text;
+	}
+	return 0;
+}
@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef DIS_H
+#define DIS_H
+
+#define DIS_SLOT_SIZE			8	/* Bytes; the unit of a pc */
+#define DIS_LINE_SIZE			256	/* A label and an instruction */
+
+/*
+ * What the walk of the CF program found in each slot. Those it does not reach
+ * are taken as CF. A TEX or a VTX takes two slots.
+ */
+enum dis_slot {
+	DIS_SLOT_NONE,
+	DIS_SLOT_CF,
+	DIS_SLOT_ALU,
+	DIS_SLOT_TEX,
+	DIS_SLOT_VTX,
+	DIS_SLOT_HIGH,		/* The second half of a TEX or a VTX */
+};
+
+#define DIS_SLOT_KIND			0x0f
+#define DIS_SLOT_BAD			0x40	/* Referenced, but no syntax */
+#define DIS_SLOT_LABEL			0x80	/* Referenced by a CF */
+
+/*
+ * The disassembler. The text of a program is in the syntax the assembler
+ * accepts, with a label L<pc> at each address a CF references; a word it
+ * cannot express is printed as a comment, and counted in num_bad, as is a CF
+ * that references such a word. The text is reused by the next program.
+ */
+struct dis {
+	const char			*buf;	/* Little-endian words */
+	unsigned char			*slots;
+	size_t				num_slots;
+	size_t				max_slots;
+
+	/* The starts of the CF runs not yet walked. */
+	size_t				*runs;
+	size_t				num_runs;
+	size_t				max_runs;
+
+	char				*text;
+	size_t				len;
+	size_t				max_len;
+
+	size_t				num_insts;
+	size_t				num_bad;
+};
+
+static inline
+void dis_construct(struct dis *this)
+{
+	memset(this, 0, sizeof(*this));
+}
+
+static inline
+void dis_destruct(struct dis *this)
+{
+	free(this->slots);
+	free(this->runs);
+	free(this->text);
+}
+
+int	dis_decode(struct dis *this, const char *buf, size_t size);
+#endif
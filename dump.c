@@ -0,0 +1,226 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "dis.h"
+#include "cli.h"
+
+/* What is printed of an input. */
+struct dump_res {
+	int				err;
+	bool				decoded;
+	bool				assembled;
+	size_t				at;	/* The first word that differs */
+	struct egasm_diag		diag;
+};
+
+struct dump;
+struct dump_worker {
+	struct dump			*d;
+	struct dis			dis;
+	struct egasm			*as;	/* With -R */
+	pthread_t			thread;
+};
+
+/*
+ * The inputs are taken in turn by the workers, and each is decoded as soon as
+ * it is taken; it is printed once those before it are.
+ */
+struct dump {
+	char				**paths;
+	int				num_paths;
+	int				num_inputs;
+
+	int				next;	/* To be taken */
+
+	/* Of the turn. */
+	pthread_mutex_t			lock;
+	pthread_cond_t			cond;
+	int				turn;	/* To be printed */
+	int				ret;
+};
+
+/* The text of dis assembles back to the words at buf; 0 if it does. */
+static
+int dump_check(struct egasm *as, const struct dis *dis, const char *buf,
+	       size_t size, struct dump_res *res)
+{
+	size_t i, n;
+	uint32_t w;
+	const uint32_t *words;
+
+	res->err = egasm_assemble(as, dis->text, dis->len, &words, &n,
+				  &res->diag);
+	if (res->err)
+		return res->err;
+	res->assembled = true;
+
+	for (i = 0; i < n && i < size / sizeof(w); ++i) {
+		memcpy(&w, &buf[i * sizeof(w)], sizeof(w));
+		if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+			w = __builtin_bswap32(w);
+		if (w != words[i])
+			break;
+	}
+	res->at = i;
+	if (i < n || n != size / sizeof(w))
+		res->err = EINVAL;
+	return res->err;
+}
+
+static
+void dump_print(const struct dump_worker *this, const char *path,
+		struct dump_res *res)
+{
+	const struct dis *dis;
+
+	dis = &this->dis;
+	if (!res->decoded) {
+		printf("%s: err %d\n", path, res->err);
+	} else if (this->as == NULL) {
+		if (this->d->num_paths > 1)
+			printf("# %s\n", path);
+		if (fwrite(dis->text, 1, dis->len, stdout) != dis->len)
+			res->err = EIO;
+	} else if (!res->assembled) {
+		printf("%s: %s err %d, line %d\n", path, res->diag.stage,
+		       res->err, res->diag.line);
+	} else if (res->err) {
+		printf("%s: differs at word %zu; %zu of %zu without syntax\n",
+		       path, res->at, dis->num_bad, dis->num_insts);
+	} else {
+		printf("%s: %zu instructions, ok\n", path, dis->num_insts);
+	}
+}
+
+static
+void dump_do(struct dump_worker *this, int i, struct dump_res *res)
+{
+	const char *path;
+	struct input in;
+
+	path = this->d->num_paths ? this->d->paths[i] : "-";
+	memset(res, 0, sizeof(*res));
+	res->err = input_open(&in, path);
+	if (res->err)
+		return;
+	res->err = dis_decode(&this->dis, in.buf, in.size);
+	res->decoded = res->err == 0;
+	if (res->decoded && this->as)
+		dump_check(this->as, &this->dis, in.buf, in.size, res);
+	input_close(&in);
+}
+
+static
+void *dump_worker_run(void *arg)
+{
+	int i;
+	const char *path;
+	struct dump_res res;
+	struct dump_worker *this;
+	struct dump *d;
+
+	this = arg;
+	d = this->d;
+	for (;;) {
+		i = __atomic_fetch_add(&d->next, 1, __ATOMIC_RELAXED);
+		if (i >= d->num_inputs)
+			break;
+
+		dump_do(this, i, &res);
+
+		path = d->num_paths ? d->paths[i] : "-";
+		pthread_mutex_lock(&d->lock);
+		while (d->turn != i)
+			pthread_cond_wait(&d->cond, &d->lock);
+		dump_print(this, path, &res);
+		if (res.err)
+			d->ret = res.err;
+		++d->turn;
+		pthread_cond_broadcast(&d->cond);
+		pthread_mutex_unlock(&d->lock);
+	}
+	return NULL;
+}
+
+/*
+ * Disassemble each input, written as with -o bin, to stdout; with -R, check
+ * instead that the text assembles back to the input. The text of each input
+ * is preceded by its name, if there are more. The inputs are decoded on as
+ * many threads as -j says, or as there are cores, and printed in order.
+ */
+int dump_main(const struct cli_opts *opts, char **paths, int num_paths)
+{
+	int i, err, num_workers;
+	struct dump d;
+	struct dump_worker *workers, *w;
+
+	memset(&d, 0, sizeof(d));
+	d.paths = paths;
+	d.num_paths = num_paths;
+	d.num_inputs = num_paths ? num_paths : 1;
+
+	num_workers = opts->num_threads;
+	if (num_workers == 0)
+		num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_workers > d.num_inputs)
+		num_workers = d.num_inputs;
+	if (num_workers < 1)
+		num_workers = 1;
+
+	workers = calloc(num_workers, sizeof(*workers));
+	if (workers == NULL)
+		return ENOMEM;
+
+	err = 0;
+	for (i = 0; i < num_workers; ++i) {
+		w = &workers[i];
+		w->d = &d;
+		dis_construct(&w->dis);
+		if (opts->round_trip) {
+			err = egasm_create(0, &w->as);
+			if (err)
+				break;
+		}
+	}
+	if (err) {
+		num_workers = i + 1;
+		goto destroy;
+	}
+
+	pthread_mutex_init(&d.lock, NULL);
+	pthread_cond_init(&d.cond, NULL);
+	for (i = 1; i < num_workers; ++i) {
+		err = pthread_create(&workers[i].thread, NULL, dump_worker_run,
+				     &workers[i]);
+		if (err)
+			break;
+	}
+
+	/* The threads not created leave the inputs to the rest. */
+	dump_worker_run(&workers[0]);
+	while (--i > 0)
+		pthread_join(workers[i].thread, NULL);
+	pthread_cond_destroy(&d.cond);
+	pthread_mutex_destroy(&d.lock);
+	err = d.ret;
+destroy:
+	for (i = 0; i < num_workers; ++i) {
+		dis_destruct(&workers[i].dis);
+		if (workers[i].as)
+			egasm_destroy(workers[i].as);
+	}
+	free(workers);
+	if (fflush(stdout))
+		err = EIO;
+	return err;
+}
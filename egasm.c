@@ -0,0 +1,1169 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "main.h"
+
+#define SWAR_ONES			0x0101010101010101ull
+
+static
+struct token *asm_base_new_span(struct asm_base *this, struct token **spans,
+				int *num, int *max)
+{
+	int n;
+	struct token *t;
+
+	if (*num == *max) {
+		n = *max ? 2 * *max : 1024;
+		t = arena_realloc(&this->arena, *spans, *max * sizeof(*t),
+				  n * sizeof(*t));
+		if (t == NULL)
+			return NULL;
+		*spans = t;
+		*max = n;
+	}
+	return &(*spans)[(*num)++];
+}
+
+/* Room for one more; num_insts is left for the caller to bump. */
+struct inst_all *asm_base_new_inst(struct asm_base *this)
+{
+	int n;
+	struct inst_all *in;
+
+	if (this->num_insts == this->max_insts) {
+		n = this->max_insts ? 2 * this->max_insts : 128;
+		in = arena_realloc(&this->arena, this->insts,
+				   this->max_insts * sizeof(*in),
+				   n * sizeof(*in));
+		if (in == NULL)
+			return NULL;
+		this->insts = in;
+		this->max_insts = n;
+	}
+	return &this->insts[this->num_insts];
+}
+
+static
+int asm_base_new_patch(struct asm_base *this)
+{
+	int n;
+	struct patch *p;
+
+	if (this->num_patches == this->max_patches) {
+		n = this->max_patches ? 2 * this->max_patches : 64;
+		p = arena_realloc(&this->arena, this->patches,
+				  this->max_patches * sizeof(*p),
+				  n * sizeof(*p));
+		if (p == NULL)
+			return -1;
+		this->patches = p;
+		this->max_patches = n;
+	}
+	return this->num_patches++;
+}
+
+/* Forget the previous input, and free everything allocated for it. */
+void asm_base_reset(struct asm_base *this, const char *buf, size_t buf_size)
+{
+	arena_reset(&this->arena);
+	this->buf	= buf;
+	this->buf_size	= buf_size;
+	this->buf_start	= 0;
+	this->insts	= NULL;
+	this->tokens	= NULL;
+	this->labels	= NULL;
+	this->patches	= NULL;
+	this->num_insts = this->max_insts = 0;
+	this->num_tokens = this->max_tokens = 0;
+	this->num_labels = this->max_labels = 0;
+	this->num_patches = this->max_patches = 0;
+	this->num_unresolved = 0;
+	sym_tab_construct(&this->syms, buf, &this->arena);
+	this->scan	= scan_get_ops();
+	this->soa	= soa_get_ops();
+}
+
+static
+int token_parse_digits(const char *s, int len, int base, int *out)
+{
+	int i, d;
+	unsigned int v;
+
+	if (len <= 0)
+		return EINVAL;
+
+	for (i = 0, v = 0; i < len; ++i) {
+		if (s[i] >= '0' && s[i] <= '9')
+			d = s[i] - '0';
+		else if (s[i] >= 'a' && s[i] <= 'f')
+			d = s[i] - 'a' + 10;
+		else if (s[i] >= 'A' && s[i] <= 'F')
+			d = s[i] - 'A' + 10;
+		else
+			return EINVAL;
+		if (d >= base)
+			return EINVAL;
+		v = v * base + d;
+	}
+	*out = v;
+	return 0;
+}
+
+/*
+ * 1 to 8 characters, one per byte, with s[0] in the least significant byte
+ * and s[len - 1] in the most significant one. Padded with '0's in front.
+ */
+static
+uint64_t swar_load(const char *s, int len)
+{
+	uint64_t v;
+
+	v = 0;
+	memcpy(&v, s, len);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	if (len == 8)
+		return v;
+	return v << (8 * (8 - len)) | (SWAR_ONES * '0') >> (8 * len);
+}
+
+/*
+ * Fold the digits, one per byte, into a number. Each step combines the
+ * adjacent lanes of the previous one into a lane of twice the width.
+ */
+static
+int swar_parse_dec(const char *s, int len, int *out)
+{
+	uint64_t v;
+
+	v = swar_load(s, len);
+
+	/* The high nibbles must be 3, and the low ones at most 9. */
+	if ((v & (SWAR_ONES * 0xf0)) != SWAR_ONES * 0x30)
+		return EINVAL;
+	if (((v + SWAR_ONES * 0x06) & (SWAR_ONES * 0xf0)) != SWAR_ONES * 0x30)
+		return EINVAL;
+
+	v -= SWAR_ONES * '0';
+	v = (v * 10 + (v >> 8)) & 0x00ff00ff00ff00ffull;
+	v = (v * 100 + (v >> 16)) & 0x0000ffff0000ffffull;
+	v = (v * 10000 + (v >> 32)) & 0x00000000ffffffffull;
+	*out = v;
+	return 0;
+}
+
+static
+int swar_parse_hex(const char *s, int len, int *out)
+{
+	uint64_t v, lower, digit, alpha;
+
+	v = swar_load(s, len);
+	if (v & (SWAR_ONES * 0x80))
+		return EINVAL;
+
+	/*
+	 * With every byte below 0x80, the top bit of each byte of
+	 * (v + 0x80 - lo) & (0x80 + hi - v) is set iff lo <= byte <= hi.
+	 */
+	lower = v | (SWAR_ONES * 0x20);
+	digit = (v + SWAR_ONES * (0x80 - '0')) & (SWAR_ONES * (0x80 + '9') - v);
+	alpha = (lower + SWAR_ONES * (0x80 - 'a')) &
+		(SWAR_ONES * (0x80 + 'f') - lower);
+	digit &= SWAR_ONES * 0x80;
+	alpha &= SWAR_ONES * 0x80;
+	if ((digit | alpha) != SWAR_ONES * 0x80)
+		return EINVAL;
+
+	v = (v & (SWAR_ONES * 0x0f)) + (alpha >> 7) * 9;
+	v = ((v << 4) | (v >> 8)) & 0x00ff00ff00ff00ffull;
+	v = ((v << 8) | (v >> 16)) & 0x0000ffff0000ffffull;
+	v = ((v << 16) | (v >> 32)) & 0x00000000ffffffffull;
+	*out = (unsigned int)v;
+	return 0;
+}
+
+/* %d or 0x%x */
+static
+int token_parse_number(const char *s, int len, int *out)
+{
+	if (len > 2 && s[0] == '0' && s[1] == 'x') {
+		if (len - 2 <= 8)
+			return swar_parse_hex(&s[2], len - 2, out);
+		return token_parse_digits(&s[2], len - 2, 16, out);
+	}
+
+	if (len > 0 && len <= 8)
+		return swar_parse_dec(s, len, out);
+	return token_parse_digits(s, len, 10, out);
+}
+
+static
+int token_parse_swizzle_char(char sc)
+{
+	if (sc == 'x' || sc == 'X') return SEL_X;
+	if (sc == 'y' || sc == 'Y') return SEL_Y;
+	if (sc == 'z' || sc == 'Z') return SEL_Z;
+	if (sc == 'w' || sc == 'W') return SEL_W;
+	if (sc == '0') return SEL_0;
+	if (sc == '1') return SEL_1;
+	return SEL_MASK;
+}
+
+/* s is the text of the token. */
+static
+void token_classify(struct token *this, const char *s)
+{
+	int i;
+
+	this->kw = kw_lookup(s, this->len);
+
+	/* Any 1 or 4 characters can be a channel or a swizzle. */
+	this->swz = -1;
+	if (this->len == 1 || this->len == 4) {
+		for (i = 0, this->swz = 0; i < this->len; ++i)
+			this->swz |= token_parse_swizzle_char(s[i]) << (3 * i);
+	}
+
+	if (!token_parse_number(s, this->len, &this->val)) {
+		this->type = TOKEN_INT;
+		return;
+	}
+
+	switch (s[0]) {
+	case 'r':
+	case 'R':
+		this->type = TOKEN_GPR;
+		break;
+	case 'p':
+		this->type = TOKEN_PARAM;
+		break;
+	case 'k':
+		this->type = TOKEN_KCACHE;
+		break;
+	default:
+		this->type = TOKEN_ID;
+		return;
+	}
+
+	/* The number follows the r/p/k. */
+	if (token_parse_number(&s[1], this->len - 1, &this->val))
+		this->type = TOKEN_ID;
+}
+
+static
+struct token *inst_base_new_token(struct inst_base *this, size_t ts, size_t te)
+{
+	struct token *t;
+	struct asm_base *as;
+
+	as = this->as;
+	t = asm_base_new_span(as, &as->tokens, &as->num_tokens,
+			      &as->max_tokens);
+	if (t == NULL)
+		return NULL;
+	t->s = ts;
+	t->len = te - ts;
+	++this->num_tokens;
+	return t;
+}
+
+/*
+ * Single pass over buf, starting at *i. Comments are skipped, labels and tokens
+ * of the next instruction are appended, as spans, to asm_base.labels and
+ * asm_base.tokens. On return, *i is past the ; that ends the instruction. If
+ * only whitespace and comments remain, the instruction has no tokens.
+ */
+int inst_base_lex(struct inst_base *this, size_t *i)
+{
+	int class;
+	size_t j, k, e;
+	char c;
+	const char *buf;
+	const struct scan_ops *scan;
+	struct asm_base *as;
+	struct token *t;
+
+	as = this->as;
+	buf = as->buf;
+	e = as->buf_size;
+	scan = as->scan;
+
+	this->tokens = as->num_tokens;
+	this->labels = as->num_labels;
+
+	for (j = *i; j < e;) {
+		c = buf[j];
+		class = scan_class[(unsigned char)c];
+
+		if (class & SCAN_SPACE) {
+			j = scan->space_end(buf, j + 1, e);
+			continue;
+		}
+
+		/* A comment can only begin where an instruction can. */
+		if (c == '#' && this->num_tokens == 0) {
+			/* The \n is skipped as whitespace. */
+			j = scan->line_end(buf, j + 1, e);
+			continue;
+		}
+
+		if ((class & SCAN_STOP) == 0) {
+			k = scan->token_end(buf, j + 1, e);
+			t = inst_base_new_token(this, j, k);
+			if (t == NULL)
+				return ENOMEM;
+			token_classify(t, &buf[j]);
+			j = k;
+			continue;
+		}
+
+		/* A label is the only token before its : */
+		if (c == ':') {
+			if (this->num_tokens != 1)
+				return EINVAL;
+
+			/* TODO: Lables should have only letters, numbers and _ */
+
+			/* Move the token to the labels. */
+			--as->num_tokens;
+			--this->num_tokens;
+			t = asm_base_new_span(as, &as->labels, &as->num_labels,
+					      &as->max_labels);
+			if (t == NULL)
+				return ENOMEM;
+			*t = as->tokens[as->num_tokens];
+			++this->num_labels;
+			++j;
+			continue;
+		}
+
+		/* Create a token for the non-space delims */
+		t = inst_base_new_token(this, j, j + 1);
+		if (t == NULL)
+			return ENOMEM;
+		t->type = TOKEN_PUNCT;
+		t->val = c;
+		t->swz = -1;
+		t->kw = KW_NONE;
+
+		/* ; is the end of the curr instr. */
+		if (c == ';')
+			break;
+		++j;
+	}
+
+	/* Labels or tokens without a ; */
+	if (j == e) {
+		*i = e;
+		if (this->num_tokens || this->num_labels)
+			return EINVAL;
+		return 0;
+	}
+
+	*i = j + 1;	/* Next invocation will begin here */
+	return 0;
+}
+
+/* Add the labels of this instruction to the symbol table. */
+static
+int inst_base_define_labels(struct inst_base *this)
+{
+	int i, id, r, err;
+	struct asm_base *as;
+	const struct token *l;
+
+	as = this->as;
+	for (i = 0; i < this->num_labels; ++i) {
+		l = &as->labels[this->labels + i];
+		err = sym_tab_intern(&as->syms, l->s, l->len, &id);
+		if (!err)
+			err = sym_tab_define(&as->syms, id, this->pc);
+		if (err)
+			return err;
+
+		/* Patch the already encoded forward references. */
+		for (r = sym_tab_get_refs(&as->syms, id); r >= 0;
+		     r = as->patches[r].next) {
+			inst_cf_patch_label_all(&as->insts[as->patches[r].inst],
+						this->pc);
+			--as->num_unresolved;
+		}
+		sym_tab_set_refs(&as->syms, id, -1);
+	}
+	return 0;
+}
+
+int inst_base_fix_label(struct inst_base *this, int label, int *out)
+{
+	int pc;
+
+	pc = sym_tab_get_pc(&this->as->syms, label);
+	if (pc < 0)
+		return EINVAL;	/* Undefined label */
+	*out = pc;
+	return 0;
+}
+
+int inst_all_parse(struct inst_all *this)
+{
+	int err;
+	struct inst_base *base;
+
+	base = &this->base;
+
+	/* Should be one of c,a,l,v,t,m,g */
+	switch (inst_base_get_next_kw(base)) {
+	case KW_C:
+		err = inst_cf_parse_all(this);
+		break;
+	case KW_V:
+		err = inst_vtx_parse_all(this);
+		break;
+	case KW_A:
+		err = inst_alu_parse_all(this);
+		break;
+	case KW_T:
+		err = inst_tex_parse_all(this);
+		break;
+	default:
+		err = EINVAL;
+		break;
+	}
+	return err;
+}
+
+static
+int inst_all_fix_labels(struct inst_all *this)
+{
+	int err;
+	struct inst_base *base;
+
+	base = &this->base;
+
+	err = 0;
+	if (base->type >= IT_CF && base->type <= IT_CF_AIE_SWIZ)
+		err = inst_cf_fix_labels_all(this);
+	return err;
+}
+
+int inst_all_encode(struct inst_all *this)
+{
+	int err;
+	struct inst_base *base;
+
+	base = &this->base;
+	err = EINVAL;
+	if (base->type >= IT_CF && base->type <= IT_CF_AIE_SWIZ)
+		err = inst_cf_encode_all(this);
+	else if (base->type >= IT_ALU_OP2 && base->type <= IT_ALU_OP3)
+		err = inst_alu_encode_all(this);
+	else if (base->type >= IT_VTX_GPR && base->type <= IT_VTX_SEM)
+		err = inst_vtx_encode_all(this);
+	else if (base->type == IT_TEX)
+		err = inst_tex_encode_all(this);
+	return err;
+}
+
+/*
+ * Single pass: encode as soon as parsed. A reference to a label not yet defined
+ * is encoded with address 0, and chained on the label to be patched when
+ * inst_base_define_labels gets to it.
+ */
+static
+int inst_all_encode_now(struct inst_all *this, int ix)
+{
+	int err, label, r;
+	struct asm_base *as;
+
+	as = this->base.as;
+	label = -1;
+	if (this->base.type >= IT_CF && this->base.type <= IT_CF_AIE_SWIZ)
+		label = inst_cf_get_label_all(this);
+
+	if (label >= 0 && sym_tab_get_pc(&as->syms, label) < 0) {
+		r = asm_base_new_patch(as);
+		if (r < 0)
+			return ENOMEM;
+		as->patches[r].inst = ix;
+		as->patches[r].next = sym_tab_get_refs(&as->syms, label);
+		sym_tab_set_refs(&as->syms, label, r);
+		++as->num_unresolved;
+	} else {
+		err = inst_all_fix_labels(this);
+		if (err)
+			return err;
+	}
+	return inst_all_encode(this);
+}
+
+int inst_base_parse_number(struct inst_base *this, int *out)
+{
+	const struct token *t;
+
+	t = inst_base_get_next_token(this);
+	if (t->type != TOKEN_INT)
+		return EINVAL;
+	*out = t->val;
+	return 0;
+}
+
+int inst_base_parse_count(struct inst_base *this, int *out)
+{
+	int err;
+
+	if (inst_base_is_next_punct(this, '(') == false)
+		return EINVAL;
+
+	err = inst_base_parse_number(this, out);
+	if (err)
+		return err;
+
+	if (inst_base_is_next_punct(this, ')') == false)
+		return EINVAL;
+	return 0;
+}
+
+/* A label reference is kept as the id of its sym. */
+int inst_base_parse_label(struct inst_base *this, int *out)
+{
+	const struct token *t;
+
+	t = inst_base_get_next_token(this);
+	if (t->len == 0 || t->type == TOKEN_PUNCT)
+		return EINVAL;
+	return sym_tab_intern(&this->as->syms, t->s, t->len, out);
+}
+
+int inst_base_parse_register(struct inst_base *this, int *out)
+{
+	const struct token *t;
+
+	t = inst_base_get_next_token(this);
+	if (t->type != TOKEN_GPR)
+		return EINVAL;
+	*out = t->val;
+	return 0;
+}
+
+int inst_base_parse_channel(struct inst_base *this, int *out)
+{
+	const struct token *t;
+
+	t = inst_base_get_next_token(this);
+	if (t->len != 1 || t->swz < 0)
+		return EINVAL;
+	*out = t->swz;
+	return 0;
+}
+
+int inst_base_parse_swizzle(struct inst_base *this, int *swiz)
+{
+	int i;
+	const struct token *t;
+
+	t = inst_base_get_next_token(this);
+	if (t->len != 4 || t->swz < 0)
+		return EINVAL;
+	for (i = 0; i < 4; ++i)
+		swiz[i] = (t->swz >> (3 * i)) & SEL_MASK;
+	return 0;
+}
+
+/* Record the failure in diag, if any, and return err. */
+static
+int asm_base_fail(const struct asm_base *this, struct egasm_diag *diag,
+		  int err, const char *stage, int inst, size_t pos)
+{
+	size_t i;
+
+	if (diag == NULL)
+		return err;
+
+	diag->err = err;
+	diag->stage = stage;
+	diag->inst = inst;
+	diag->pos = pos;
+	diag->line = 1;
+	for (i = 0; i < pos && i < this->buf_size; ++i) {
+		if (this->buf[i] == '\n')
+			++diag->line;
+	}
+	return err;
+}
+
+/* The start of the instruction; pos, if it has no tokens yet. */
+size_t inst_base_get_pos(const struct inst_base *this, size_t pos)
+{
+	if (this->num_tokens)
+		pos = this->as->tokens[this->tokens].s;
+	return pos;
+}
+
+/* Encoded the same wherever it appears; there is no label to resolve. */
+static
+bool inst_all_is_pure(const struct inst_all *this)
+{
+	const struct inst_base *base;
+
+	base = &this->base;
+	if (base->type < IT_CF || base->type > IT_CF_AIE_SWIZ)
+		return true;
+	return base->type != IT_CF_ALU_EXT && inst_cf_get_label_all(this) < 0;
+}
+
+/*
+ * Find the instruction at *i in the memo, by its text. The whitespace and the
+ * comments before it are skipped as inst_base_lex skips them; a text with a
+ * label, or without a ; soon enough, is left to the lexer.
+ */
+static
+int asm_base_recall(struct asm_base *this, struct inst_all *in, size_t *i,
+		    bool *out_hit)
+{
+	size_t j, e, n;
+	const char *buf, *semi;
+	const struct inst_all *m;
+	struct inst_base *base;
+	struct token *t;
+
+	*out_hit = false;
+	buf = this->buf;
+	e = this->buf_size;
+	for (j = *i; j < e;) {
+		if (scan_is(buf[j], SCAN_SPACE))
+			j = this->scan->space_end(buf, j + 1, e);
+		else if (buf[j] == '#')
+			j = this->scan->line_end(buf, j + 1, e);
+		else
+			break;
+	}
+
+	n = e - j < MEMO_MAX_LEN ? e - j : MEMO_MAX_LEN;
+	semi = memchr(&buf[j], ';', n);
+	if (semi == NULL || memchr(&buf[j], ':', semi - &buf[j]))
+		return 0;
+	m = memo_find(this->memo, &buf[j], semi - &buf[j] + 1);
+	if (m == NULL)
+		return 0;
+
+	/* Nothing of it is parsed again; the spans are for the listing. */
+	base = &in->base;
+	*in = *m;
+	base->as = this;
+	base->tokens = this->num_tokens;
+	base->labels = this->num_labels;
+	base->num_tokens = base->num_labels = 0;
+	base->next_token = -1;
+	base->encoded = true;
+
+	t = inst_base_new_token(base, j, semi - buf);
+	if (t == NULL)
+		return ENOMEM;
+	t->type = TOKEN_ID;
+	t->val = 0;
+	t->swz = -1;
+	t->kw = KW_NONE;
+
+	t = inst_base_new_token(base, semi - buf, semi - buf + 1);
+	if (t == NULL)
+		return ENOMEM;
+	t->type = TOKEN_PUNCT;
+	t->val = ';';
+	t->swz = -1;
+	t->kw = KW_NONE;
+
+	*i = semi - buf + 1;
+	*out_hit = true;
+	return 0;
+}
+
+/*
+ * Keep a pure instruction, just parsed, for its repeats; it is encoded now, if
+ * it is not yet. One that fails to encode is left for asm_base_encode to
+ * report.
+ */
+static
+int asm_base_memoize(struct asm_base *this, struct inst_all *in)
+{
+	const struct token *t;
+
+	if (!in->base.encoded) {
+		if (inst_all_encode(in)) {
+			memset(in->base.w, 0, sizeof(in->base.w));
+			return 0;
+		}
+		in->base.encoded = true;
+	}
+
+	t = &this->tokens[in->base.tokens];
+	return memo_add(this->memo, &this->buf[t->s],
+			t[in->base.num_tokens - 1].s + 1 - t->s, in);
+}
+
+/*
+ * Lex and parse buf[buf_start, buf_size). Without define_labels, the labels
+ * are left for the caller to define. With a memo, a repeat of an instruction
+ * seen before is copied from it, and not lexed, parsed or encoded again; an
+ * input with too few repeats stops looking.
+ */
+int asm_base_parse(struct asm_base *this, bool define_labels,
+		   struct egasm_diag *diag)
+{
+	int err, pc;
+	bool hit;
+	size_t pos, start;
+	unsigned long lookups, hits;
+	struct inst_all *in;
+	struct memo *memo;
+
+	pc = 0;
+	memo = this->memo;
+	lookups = memo ? memo->lookups : 0;
+	hits = memo ? memo->hits : 0;
+	for (pos = this->buf_start; pos < this->buf_size;) {
+		in = asm_base_new_inst(this);
+		if (in == NULL)
+			return asm_base_fail(this, diag, ENOMEM, "lex",
+					     this->num_insts, pos);
+
+		/* inst_base construction done here for all inst types */
+		inst_all_construct(in, this);
+
+		if (memo) {
+			err = asm_base_recall(this, in, &pos, &hit);
+			if (err)
+				return asm_base_fail(this, diag, err, "lex",
+						     this->num_insts, pos);
+			if (hit) {
+				in->base.pc = pc;
+				pc += in->base.num_words / 2;
+				++this->num_insts;
+				continue;
+			}
+			if (memo->lookups - lookups >= MEMO_TRIAL &&
+			    (memo->hits - hits) * MEMO_MIN_RATE <
+			    memo->lookups - lookups)
+				memo = NULL;
+		}
+
+		/* Labels and tokens, through the ; */
+		err = inst_base_lex(&in->base, &pos);
+		if (err)
+			return asm_base_fail(this, diag, err, "lex",
+					     this->num_insts,
+					     inst_base_get_pos(&in->base, pos));
+
+		/* Only whitespace or comments until the end. */
+		if (in->base.num_tokens == 0)
+			continue;
+#if 0
+		{
+			int j;
+			const struct token *t;
+			for (j = 0; j < in->base.num_tokens; ++j) {
+				t = &this->tokens[in->base.tokens + j];
+				printf("tokens[%d]: %.*s\n", j, t->len,
+				       &this->buf[t->s]);
+			}
+		}
+#endif
+
+		start = inst_base_get_pos(&in->base, pos);
+		err = inst_all_parse(in);
+		if (err)
+			return asm_base_fail(this, diag, err, "parse",
+					     this->num_insts, start);
+
+		in->base.pc = pc;
+		pc += in->base.num_words / 2;	/* For the next instruction */
+
+		err = define_labels ? inst_base_define_labels(&in->base) : 0;
+		if (err)
+			return asm_base_fail(this, diag, err, "labels",
+					     this->num_insts, start);
+
+		if (this->single_pass) {
+			err = inst_all_encode_now(in, this->num_insts);
+			if (err)
+				return asm_base_fail(this, diag, err, "encode",
+						     this->num_insts, start);
+			in->base.encoded = true;
+		}
+
+		err = memo && inst_all_is_pure(in) ?
+			asm_base_memoize(this, in) : 0;
+		if (err)
+			return asm_base_fail(this, diag, err, "parse",
+					     this->num_insts, start);
+
+		++this->num_insts;
+	}
+	return 0;
+}
+
+/* Resolve the labels, and encode, whatever asm_base_parse left to do. */
+int asm_base_encode(struct asm_base *this, struct egasm_diag *diag)
+{
+	int i, err;
+	struct inst_all *in;
+	struct soa soa;
+
+	if (this->single_pass) {
+		/* References to labels that were never defined. */
+		for (i = 0; this->num_unresolved && i < this->syms.num_syms;
+		     ++i) {
+			if (this->syms.syms[i].refs < 0)
+				continue;
+			in = &this->insts[this->patches[this->syms.syms[i].refs].inst];
+			return asm_base_fail(this, diag, EINVAL, "labels",
+					     in - this->insts,
+					     inst_base_get_pos(&in->base, 0));
+		}
+		return 0;
+	}
+
+	for (i = 0; i < this->num_insts; ++i) {
+		in = &this->insts[i];
+		err = inst_all_fix_labels(in);
+		if (err)
+			return asm_base_fail(this, diag, err, "labels", i,
+					     inst_base_get_pos(&in->base, 0));
+	}
+
+	/* Those of the formats soa packs, in steps; they cannot fail. */
+	soa_construct(&soa, this->soa, this->insts);
+	for (i = 0; i < this->num_insts; ++i) {
+		in = &this->insts[i];
+		if (in->base.encoded || soa_add(&soa, i))
+			continue;
+		err = inst_all_encode(in);
+		if (err)
+			return asm_base_fail(this, diag, err, "encode", i,
+					     inst_base_get_pos(&in->base, 0));
+	}
+	soa_flush(&soa);
+	return 0;
+}
+
+/* Lex, parse, resolve labels and encode the whole of asm_base.buf. */
+int asm_base_assemble(struct asm_base *this, struct egasm_diag *diag)
+{
+	int err;
+
+	if (diag)
+		memset(diag, 0, sizeof(*diag));
+
+	err = asm_base_parse(this, true, diag);
+	if (!err)
+		err = asm_base_encode(this, diag);
+	return err;
+}
+
+struct egasm {
+	struct asm_par			par;
+	struct cache			*cache;		/* If set */
+
+	/* Read from the cache, and in host order, if hit; else scratch. */
+	uint32_t			*cached;
+	size_t				max_cached;	/* # of words */
+
+	size_t				num_words;	/* Of the prepared input */
+	int				flags;
+	bool				prepared;
+	bool				hit;
+};
+
+int egasm_create(int flags, struct egasm **out)
+{
+	int err;
+	struct egasm *this;
+
+	this = malloc(sizeof(*this));
+	if (this == NULL)
+		return ENOMEM;
+	err = asm_par_construct(&this->par, 1);
+	if (err) {
+		free(this);
+		return err;
+	}
+	this->cache = NULL;
+	this->cached = NULL;
+	this->max_cached = 0;
+	this->flags = flags;
+	this->prepared = false;
+	*out = this;
+	return 0;
+}
+
+void egasm_destroy(struct egasm *this)
+{
+	if (this == NULL)
+		return;
+	if (this->cache)
+		cache_destruct(this->cache);
+	free(this->cache);
+	free(this->cached);
+	asm_par_destruct(&this->par);
+	free(this);
+}
+
+/* Large inputs are split across up to num_threads threads. */
+int egasm_set_num_threads(struct egasm *this, int num_threads)
+{
+	int err;
+	struct asm_par par;
+
+	err = asm_par_construct(&par, num_threads);
+	if (err)
+		return err;
+	asm_par_destruct(&this->par);
+	this->par = par;
+	return 0;
+}
+
+int egasm_set_cache(struct egasm *this, const char *dir, size_t max_size)
+{
+	int err;
+	struct cache *cache;
+
+	cache = malloc(sizeof(*cache));
+	if (cache == NULL)
+		return ENOMEM;
+	err = cache_construct(cache, dir, max_size);
+	if (err) {
+		free(cache);
+		return err;
+	}
+	if (this->cache)
+		cache_destruct(this->cache);
+	free(this->cache);
+	this->cache = cache;
+	return 0;
+}
+
+void egasm_get_cache_stats(const struct egasm *this,
+			   struct egasm_cache_stats *out)
+{
+	memset(out, 0, sizeof(*out));
+	if (this->cache == NULL)
+		return;
+	pthread_mutex_lock(&this->cache->lock);
+	*out = this->cache->stats;
+	pthread_mutex_unlock(&this->cache->lock);
+}
+
+/*
+ * Store the words of each instruction in one go, in order, and little-endian
+ * if le; or those read from the cache. p is only ever written, never read.
+ */
+static
+void egasm_store(const struct egasm *this, char *p, bool le)
+{
+	int c, i, j;
+	size_t n;
+	uint32_t w[4];
+	const struct asm_base *as;
+	const struct inst_base *base;
+
+	if (this->hit && (!le || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)) {
+		memcpy(p, this->cached, this->num_words * sizeof(*w));
+		return;
+	}
+	if (this->hit) {
+		for (n = 0; n < this->num_words; ++n) {
+			w[0] = __builtin_bswap32(this->cached[n]);
+			memcpy(p, w, sizeof(*w));
+			p += sizeof(*w);
+		}
+		return;
+	}
+
+	for (c = 0; c < this->par.num_chunks; ++c) {
+		as = &this->par.chunks[c];
+		for (i = 0; i < as->num_insts; ++i) {
+			base = &as->insts[i].base;
+			for (j = 0; j < base->num_words; ++j) {
+				w[j] = base->w[j];
+				if (le && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+					w[j] = __builtin_bswap32(w[j]);
+			}
+			memcpy(p, w, base->num_words * sizeof(*w));
+			p += base->num_words * sizeof(*w);
+		}
+	}
+}
+
+static
+int egasm_reserve_cached(struct egasm *this, size_t num_words)
+{
+	uint32_t *t;
+
+	if (num_words <= this->max_cached)
+		return 0;
+	t = realloc(this->cached, num_words * sizeof(*t));
+	if (t == NULL)
+		return ENOMEM;
+	this->cached = t;
+	this->max_cached = num_words;
+	return 0;
+}
+
+/* The entry holds the words, little-endian. */
+static
+int egasm_cache_read(struct egasm *this, const struct cache_key *key)
+{
+	int fd, err;
+	size_t size, i, n;
+	ssize_t ret;
+
+	err = cache_open(this->cache, key, &fd, &size);
+	if (err)
+		return err;
+
+	err = size % sizeof(uint32_t) ? EINVAL : 0;
+	if (!err)
+		err = egasm_reserve_cached(this, size / sizeof(uint32_t));
+	for (i = 0; !err && i < size; i += ret) {
+		ret = pread(fd, (char *)this->cached + i, size - i, i);
+		if (ret < 0 && errno == EINTR)
+			ret = 0;
+		else if (ret < 0)
+			err = errno;
+		else if (ret == 0)
+			err = EIO;
+	}
+	close(fd);
+	if (err)
+		return err;
+
+	n = size / sizeof(uint32_t);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	for (i = 0; i < n; ++i)
+		this->cached[i] = __builtin_bswap32(this->cached[i]);
+#endif
+	this->num_words = n;
+	this->hit = true;
+	return 0;
+}
+
+/* Best effort; a failure only costs a later assembly. */
+static
+void egasm_cache_write(struct egasm *this, const struct cache_key *key)
+{
+	int err;
+	size_t i, size;
+	ssize_t ret;
+	struct cache_tmp tmp;
+
+	if (egasm_reserve_cached(this, this->num_words))
+		return;
+	egasm_store(this, (char *)this->cached, true);
+	if (cache_tmp_open(this->cache, &tmp))
+		return;
+
+	err = 0;
+	size = this->num_words * sizeof(uint32_t);
+	for (i = 0; !err && i < size; i += ret) {
+		ret = write(tmp.fd, (char *)this->cached + i, size - i);
+		if (ret < 0 && errno == EINTR)
+			ret = 0;
+		else if (ret < 0)
+			err = errno;
+	}
+	if (err)
+		cache_tmp_abort(&tmp);
+	else
+		cache_put(this->cache, key, &tmp);
+}
+
+/* Assemble, and keep the result until the next use; see egasm_emit. */
+int egasm_prepare(struct egasm *this, const char *buf, size_t len,
+		  size_t *out_size, struct egasm_diag *diag)
+{
+	int c, i, err;
+	size_t n;
+	const struct asm_base *as;
+	struct cache_key key;
+
+	this->prepared = false;
+	this->hit = false;
+	if (this->cache) {
+		cache_key(buf, len, "words", &key);
+		if (egasm_cache_read(this, &key) == 0) {
+			if (diag)
+				memset(diag, 0, sizeof(*diag));
+			this->prepared = true;
+			*out_size = this->num_words * sizeof(uint32_t);
+			return 0;
+		}
+	}
+
+	this->par.single_pass = this->flags & EGASM_SINGLE_PASS;
+	err = asm_par_assemble(&this->par, buf, len, diag);
+	if (err)
+		return err;
+
+	for (c = 0, n = 0; c < this->par.num_chunks; ++c) {
+		as = &this->par.chunks[c];
+		for (i = 0; i < as->num_insts; ++i)
+			n += as->insts[i].base.num_words;
+	}
+	this->num_words = n;
+	this->prepared = true;
+	if (this->cache)
+		egasm_cache_write(this, &key);
+	*out_size = n * sizeof(uint32_t);
+	return 0;
+}
+
+int egasm_emit(struct egasm *this, void *dst, size_t size)
+{
+	if (!this->prepared)
+		return EINVAL;
+	if ((uintptr_t)dst & (EGASM_EMIT_ALIGN - 1))
+		return EINVAL;
+	if (size < this->num_words * sizeof(uint32_t))
+		return ENOSPC;
+	egasm_store(this, dst, true);
+	return 0;
+}
+
+int egasm_assemble(struct egasm *this, const char *buf, size_t len,
+		   const uint32_t **out_words, size_t *out_num_words,
+		   struct egasm_diag *diag)
+{
+	int err;
+	size_t size;
+	uint32_t *words;
+	struct asm_base *as;
+
+	err = egasm_prepare(this, buf, len, &size, diag);
+	if (err)
+		return err;
+	if (this->hit) {
+		*out_words = this->cached;
+		*out_num_words = this->num_words;
+		return 0;
+	}
+
+	as = &this->par.chunks[0];
+	words = arena_alloc(&as->arena, size);
+	if (words == NULL)
+		return asm_base_fail(as, diag, ENOMEM, "encode", as->num_insts,
+				     len);
+
+	egasm_store(this, (char *)words, false);
+	*out_words = words;
+	*out_num_words = this->num_words;
+	return 0;
+}
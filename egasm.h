@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef EGASM_H
+#define EGASM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * libegasm. A context assembles one input at a time; separate contexts share
+ * nothing, and can be used on separate threads at the same time.
+ */
+
+/* egasm_create flags */
+#define EGASM_SINGLE_PASS		(1 << 0)	/* Encode while parsing */
+
+/* Of the destination of egasm_emit. */
+#define EGASM_EMIT_ALIGN		4
+
+/* Where an assembly failed. */
+struct egasm_diag {
+	int				err;	/* errno value; 0 if none */
+	const char			*stage;	/* lex, parse, labels, encode */
+	int				inst;	/* Index of the instruction */
+	int				line;	/* 1-based */
+	size_t				pos;	/* Offset into the input */
+};
+
+/* Of a context's cache. */
+struct egasm_cache_stats {
+	unsigned long			hits;
+	unsigned long			misses;
+	unsigned long			stores;
+	unsigned long			evictions;
+};
+
+struct egasm;
+
+int	egasm_create(int flags, struct egasm **out);
+void	egasm_destroy(struct egasm *this);
+int	egasm_set_num_threads(struct egasm *this, int num_threads);
+
+/*
+ * Keep the words of each input in dir, which is created if missing; an input
+ * assembled before is then read back, not assembled. The least recently used
+ * entries are evicted beyond max_size bytes, unless it is 0.
+ */
+int	egasm_set_cache(struct egasm *this, const char *dir, size_t max_size);
+void	egasm_get_cache_stats(const struct egasm *this,
+			      struct egasm_cache_stats *out);
+
+/*
+ * Returns 0 or an errno value, with the details in diag, if not NULL. The
+ * words belong to the context, and remain valid until its next use.
+ */
+int	egasm_assemble(struct egasm *this, const char *buf, size_t len,
+		       const uint32_t **out_words, size_t *out_num_words,
+		       struct egasm_diag *diag);
+
+/*
+ * The same, in two steps, for a destination such as a mapping of a GPU buffer
+ * object. egasm_prepare returns the exact size, in bytes, of the program.
+ * egasm_emit then writes it, little-endian, sequentially into dst, without
+ * any copy in between; dst must be aligned to EGASM_EMIT_ALIGN, and hold at
+ * least that size. The prepared program remains until the next use.
+ */
+int	egasm_prepare(struct egasm *this, const char *buf, size_t len,
+		      size_t *out_size, struct egasm_diag *diag);
+int	egasm_emit(struct egasm *this, void *dst, size_t size);
+#endif
@@ -0,0 +1,338 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "main.h"
+
+int asm_inc_construct(struct asm_inc *this)
+{
+	memset(this, 0, sizeof(*this));
+	asm_base_construct(&this->as, "", 0);
+	return 0;
+}
+
+void asm_inc_destruct(struct asm_inc *this)
+{
+	asm_base_destruct(&this->as);
+	free(this->buf);
+	free(this->dirty);
+}
+
+/* Where the lexing of instruction i began; i == num_insts for the end. */
+static
+size_t asm_inc_bound(const struct asm_inc *this, int i)
+{
+	const struct inst_base *base;
+
+	if (i == 0)
+		return 0;
+	base = &this->as.insts[i - 1].base;
+	return this->as.tokens[base->tokens + base->num_tokens - 1].s + 1;
+}
+
+/* The first instruction whose lexing began at or after pos. */
+static
+int asm_inc_find(const struct asm_inc *this, size_t pos)
+{
+	int lo, hi, mid;
+
+	lo = 0;
+	hi = this->as.num_insts + 1;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (asm_inc_bound(this, mid) < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static
+int asm_inc_add_dirty(struct asm_inc *this, int i)
+{
+	int n, *t;
+
+	if (this->num_dirty == this->max_dirty) {
+		n = this->max_dirty ? 2 * this->max_dirty : 64;
+		t = realloc(this->dirty, n * sizeof(*t));
+		if (t == NULL)
+			return ENOMEM;
+		this->dirty = t;
+		this->max_dirty = n;
+	}
+	this->dirty[this->num_dirty++] = i;
+	return 0;
+}
+
+/* Everything, from scratch. The tokens of the previous runs are dropped. */
+static
+int asm_inc_full(struct asm_inc *this, struct egasm_diag *diag)
+{
+	int err;
+
+	asm_base_reset(&this->as, this->buf, this->size);
+	this->as.syms.copy_names = true;
+	err = asm_base_assemble(&this->as, diag);
+	this->valid = !err;
+	this->first = 0;
+	this->num_parsed = this->as.num_insts;
+	this->num_dead = 0;
+	this->moved = true;
+	return err;
+}
+
+/*
+ * Lex and parse, from the start of instruction a, until the lexer is back at
+ * the start of an instruction at or after b, as moved by delta; that one, and
+ * those after it, are as before. The new instructions follow the old ones.
+ */
+static
+int asm_inc_parse(struct asm_inc *this, int a, int b, size_t delta,
+		  int *out_j)
+{
+	int j, n, err;
+	size_t pos;
+	struct asm_base *as;
+	struct inst_all *in;
+
+	as = &this->as;
+	n = as->num_insts;
+	j = b;
+	for (pos = asm_inc_bound(this, a); pos < as->buf_size;) {
+		while (j < n && asm_inc_bound(this, j) + delta < pos)
+			++j;
+		if (j <= n && asm_inc_bound(this, j) + delta == pos)
+			break;
+
+		in = asm_base_new_inst(as);
+		if (in == NULL)
+			return ENOMEM;
+		inst_all_construct(in, as);
+		err = inst_base_lex(&in->base, &pos);
+		if (err)
+			return err;
+		if (in->base.num_tokens == 0)
+			continue;
+		err = inst_all_parse(in);
+		if (err)
+			return err;
+		++as->num_insts;
+	}
+
+	/* At the end, nothing of the old remains. */
+	if (pos >= as->buf_size)
+		j = n;
+	*out_j = j;
+	return 0;
+}
+
+/*
+ * Replace [a, j) with the m instructions parsed after the old ones, and move
+ * the sources of those after, by delta.
+ */
+static
+int asm_inc_splice(struct asm_inc *this, int a, int j, int n, int m,
+		   size_t delta)
+{
+	int i, k;
+	struct asm_base *as;
+	struct inst_all *t;
+	struct inst_base *base;
+
+	as = &this->as;
+	for (i = a; i < j; ++i)
+		this->num_dead += as->insts[i].base.num_tokens +
+			as->insts[i].base.num_labels;
+
+	t = malloc(m * sizeof(*t) + 1);
+	if (t == NULL)
+		return ENOMEM;
+	memcpy(t, &as->insts[n], m * sizeof(*t));
+	memmove(&as->insts[a + m], &as->insts[j], (n - j) * sizeof(*t));
+	memcpy(&as->insts[a], t, m * sizeof(*t));
+	free(t);
+	as->num_insts = a + m + n - j;
+
+	for (i = a + m; delta && i < as->num_insts; ++i) {
+		base = &as->insts[i].base;
+		for (k = 0; k < base->num_tokens; ++k)
+			as->tokens[base->tokens + k].s += delta;
+		for (k = 0; k < base->num_labels; ++k)
+			as->labels[base->labels + k].s += delta;
+	}
+	return 0;
+}
+
+/*
+ * The pcs from a on, and the labels, all of which are defined again. end is
+ * where the instructions ended before.
+ */
+static
+int asm_inc_place(struct asm_inc *this, int a, int m, int end)
+{
+	int i, k, pc, id, err, shift;
+	struct asm_base *as;
+	struct inst_base *base;
+	const struct token *l;
+
+	as = &this->as;
+	pc = 0;
+	if (a) {
+		base = &as->insts[a - 1].base;
+		pc = base->pc + base->num_words / 2;
+	}
+	for (i = a; i < a + m; ++i) {
+		base = &as->insts[i].base;
+		base->pc = pc;
+		pc += base->num_words / 2;
+	}
+
+	shift = pc - end;
+	if (i < as->num_insts)
+		shift = pc - as->insts[i].base.pc;
+	this->moved = shift != 0;
+	for (; shift && i < as->num_insts; ++i)
+		as->insts[i].base.pc += shift;
+
+	for (i = 0; i < as->syms.num_syms; ++i)
+		as->syms.syms[i].pc = -1;
+	for (i = 0; i < as->num_insts; ++i) {
+		base = &as->insts[i].base;
+		for (k = 0; k < base->num_labels; ++k) {
+			l = &as->labels[base->labels + k];
+			err = sym_tab_intern(&as->syms, l->s, l->len, &id);
+			if (!err)
+				err = sym_tab_define(&as->syms, id, base->pc);
+			if (err)
+				return err;
+		}
+	}
+	return 0;
+}
+
+static
+int asm_inc_encode(struct inst_all *in)
+{
+	int err;
+
+	memset(in->base.w, 0, sizeof(in->base.w));
+	err = 0;
+	if (in->base.type >= IT_CF && in->base.type <= IT_CF_AIE_SWIZ)
+		err = inst_cf_fix_labels_all(in);
+	return err ? err : inst_all_encode(in);
+}
+
+/*
+ * Encode the new instructions, and again those that reference labels, should
+ * the addresses have changed; dirty lists all of them whose words changed.
+ */
+static
+int asm_inc_encode_all(struct asm_inc *this, int a, int m)
+{
+	int i, err, w[4];
+	struct inst_all *in;
+
+	for (i = 0; i < this->as.num_insts; ++i) {
+		in = &this->as.insts[i];
+		if (i < a || i >= a + m) {
+			if (in->base.type < IT_CF ||
+			    in->base.type > IT_CF_AIE_SWIZ ||
+			    inst_cf_get_label_all(in) < 0)
+				continue;
+		}
+
+		memcpy(w, in->base.w, sizeof(w));
+		err = asm_inc_encode(in);
+		if (err)
+			return err;
+		if ((i >= a && i < a + m) || memcmp(w, in->base.w, sizeof(w)))
+			err = asm_inc_add_dirty(this, i);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+/*
+ * Assemble buf, the input as edited since the last call. After a success,
+ * the words of the instructions in dirty changed, and, if moved, so did the
+ * pcs of all from first on. Errors are reported, with diag, as a complete
+ * assembly would report them; the next call then starts over.
+ */
+int asm_inc_update(struct asm_inc *this, const char *buf, size_t size,
+		   struct egasm_diag *diag)
+{
+	int a, b, j, n, end, err;
+	size_t p, s, max, delta, old_size;
+	const struct inst_base *base;
+	char *t, *old_buf;
+
+	if (diag)
+		memset(diag, 0, sizeof(*diag));
+	this->num_dirty = 0;
+	this->moved = false;
+	this->num_parsed = 0;
+	if (this->valid && size == this->size && !memcmp(buf, this->buf, size))
+		return 0;
+
+	t = malloc(size + 1);
+	if (t == NULL)
+		return ENOMEM;
+	memcpy(t, buf, size);
+	old_buf = this->buf;
+	old_size = this->size;
+	this->buf = t;
+	this->size = size;
+
+	/* Too much left of the old runs. */
+	if (!this->valid || this->num_dead > this->as.num_tokens / 2) {
+		free(old_buf);
+		return asm_inc_full(this, diag);
+	}
+
+	/* The edit is within [p, old_size - s) of the old source. */
+	max = size < old_size ? size : old_size;
+	for (p = 0; p < max && t[p] == old_buf[p]; ++p)
+		;
+	for (s = 0; s < max - p && t[size - 1 - s] == old_buf[old_size - 1 - s];
+	     ++s)
+		;
+	free(old_buf);
+
+	/* Instructions before a, and from b on, are unchanged. */
+	n = this->as.num_insts;
+	end = 0;
+	if (n) {
+		base = &this->as.insts[n - 1].base;
+		end = base->pc + base->num_words / 2;
+	}
+	a = asm_inc_find(this, p + 1) - 1;
+	b = asm_inc_find(this, old_size - s);
+	delta = size - old_size;
+
+	this->as.buf = t;
+	this->as.buf_size = size;
+	this->as.syms.buf = t;
+	err = asm_inc_parse(this, a, b, delta, &j);
+	if (!err) {
+		this->num_parsed = this->as.num_insts - n;
+		err = asm_inc_splice(this, a, j, n, this->num_parsed, delta);
+	}
+	if (!err)
+		err = asm_inc_place(this, a, this->num_parsed, end);
+	if (!err)
+		err = asm_inc_encode_all(this, a, this->num_parsed);
+	if (err) {
+		this->num_dirty = 0;
+		return asm_inc_full(this, diag);
+	}
+	this->first = a;
+	return 0;
+}
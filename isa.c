@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "main.h"
+
+/* Within 32 bits, and with no two fields of a word over the same bit. */
+#define isa_check(list)							\
+	_Static_assert(isa_mask(list) == isa_sum(list) &&		\
+		       isa_mask(list) <= 0xffffffffull, #list)
+#define isa_check_excl(list0, list1)					\
+	_Static_assert((isa_mask(list0) & isa_mask(list1)) == 0,	\
+		       #list0 " and " #list1)
+
+isa_check(CF_WORD0_FIELDS);
+isa_check(CF_GWS_WORD0_FIELDS);
+isa_check(CF_WORD1_FIELDS);
+isa_check(CF_ALU_WORD0_FIELDS);
+isa_check(CF_ALU_WORD1_FIELDS);
+isa_check(CF_ALU_WORD0_EXT_FIELDS);
+isa_check(CF_ALU_WORD1_EXT_FIELDS);
+isa_check(CF_AIE_WORD0_FIELDS);
+isa_check(CF_AIE_WORD0_BASE_FIELDS);
+isa_check(CF_AIE_WORD0_RAT_FIELDS);
+isa_check(CF_AIE_WORD1_BUF_FIELDS);
+isa_check(CF_AIE_WORD1_SWIZ_FIELDS);
+isa_check(CF_AIE_WORD1_FIELDS);
+isa_check_excl(CF_AIE_WORD0_BASE_FIELDS, CF_AIE_WORD0_FIELDS);
+isa_check_excl(CF_AIE_WORD0_RAT_FIELDS, CF_AIE_WORD0_FIELDS);
+isa_check_excl(CF_AIE_WORD1_BUF_FIELDS, CF_AIE_WORD1_FIELDS);
+isa_check_excl(CF_AIE_WORD1_SWIZ_FIELDS, CF_AIE_WORD1_FIELDS);
+
+isa_check(ALU_WORD0_FIELDS);
+isa_check(ALU_WORD1_OP2_FIELDS);
+isa_check(ALU_WORD1_OP3_FIELDS);
+isa_check(ALU_WORD1_FIELDS);
+isa_check_excl(ALU_WORD1_OP2_FIELDS, ALU_WORD1_FIELDS);
+/* Not OP3: its 5-bit ALU_INST is at 13, the top of the 11-bit ALU_WORD1 INST. */
+
+isa_check(TEX_WORD0_FIELDS);
+isa_check(TEX_WORD1_FIELDS);
+isa_check(TEX_WORD2_FIELDS);
+
+isa_check(VTX_WORD0_FIELDS);
+isa_check(VTX_WORD1_GPR_FIELDS);
+isa_check(VTX_WORD1_SEM_FIELDS);
+isa_check(VTX_WORD1_FIELDS);
+isa_check(VTX_WORD2_FIELDS);
+isa_check_excl(VTX_WORD1_GPR_FIELDS, VTX_WORD1_FIELDS);
+isa_check_excl(VTX_WORD1_SEM_FIELDS, VTX_WORD1_FIELDS);
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+
+#include "bits.h"
+
+/*
+ * Each microcode word is described once, as a list of its fields:
+ *
+ *	#define W_FIELDS(X, a)	X(a, W, F, member, pos, bits) ...
+ *
+ * W_F_POS and W_F_BITS, the struct members, the packing and unpacking of the
+ * words, and the checks of isa.c, are all generated from these lists.
+ * a is passed through to X as is.
+ */
+#define ISA_CONSTS(a, w, f, m, pos, bits)	w##_##f##_POS = (pos), w##_##f##_BITS = (bits),
+#define ISA_MEMBER(a, w, f, m, pos, bits)	unsigned int m : w##_##f##_BITS;
+#define ISA_PACK(a, w, f, m, pos, bits)		| bits_set(w##_##f, (a)->m)
+#define ISA_UNPACK(a, w, f, m, pos, bits)	(a)->m = bits_get(isa_w, w##_##f);
+#define ISA_MASK(a, w, f, m, pos, bits)		| bits_on(w##_##f)
+#define ISA_SUM(a, w, f, m, pos, bits)		+ bits_on(w##_##f)
+
+/* The word holding the fields of list of the struct at v. */
+#define isa_pack(list, v)		(0 list(ISA_PACK, v))
+/* The fields of list of the struct at v, from word. */
+#define isa_unpack(list, v, word)					\
+	do {								\
+		uint32_t isa_w = (word);				\
+		list(ISA_UNPACK, v)					\
+	} while (0)
+
+/* The bits the fields of list take; they overlap if it is not isa_sum. */
+#define isa_mask(list)			(0ull list(ISA_MASK, ))
+#define isa_sum(list)			(0ull list(ISA_SUM, ))
+#endif
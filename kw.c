@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <stdint.h>
+
+#include "kw.h"
+
+#define KW_KEY(c0, c1, c2, c3)		((uint32_t)(c0) |		\
+					 (uint32_t)(c1) << 8 |		\
+					 (uint32_t)(c2) << 16 |		\
+					 (uint32_t)(c3) << 24)
+
+/*
+ * Multiplicative hash into 256 slots. The seed is chosen such that no two
+ * keywords share a slot; a collision shows up as an overridden initializer
+ * (-Woverride-init, enabled by -Wextra). If KW_LIST changes and that happens,
+ * pick another odd seed.
+ */
+#define KW_SLOT_BITS			8
+#define KW_SEED				0xa445492du
+#define KW_SLOT(k)			((uint32_t)((k) * KW_SEED) >>	\
+					 (32 - KW_SLOT_BITS))
+
+struct kw_slot {
+	uint32_t			key;	/* 0 if empty. */
+	unsigned char			id;
+};
+
+static const struct kw_slot kw_slots[1 << KW_SLOT_BITS] = {
+#define X(id, c0, c1, c2, c3)						\
+	[KW_SLOT(KW_KEY(c0, c1, c2, c3))] = {				\
+		KW_KEY(c0, c1, c2, c3), KW_##id				\
+	},
+	KW_LIST(X)
+#undef X
+};
+
+/* One hash and one compare. */
+int kw_lookup(const char *s, int len)
+{
+	int i;
+	uint32_t key;
+	const struct kw_slot *slot;
+
+	if (len <= 0 || len > 4)
+		return KW_NONE;
+
+	for (i = 0, key = 0; i < len; ++i)
+		key |= (uint32_t)(unsigned char)s[i] << (8 * i);
+
+	slot = &kw_slots[KW_SLOT(key)];
+	return slot->key == key ? slot->id : KW_NONE;
+}
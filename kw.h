@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef KW_H
+#define KW_H
+
+/*
+ * Mnemonics and flags. None is longer than 4 characters; the characters are
+ * listed so that each keyword can be packed into a 32-bit key at compile time.
+ */
+#define KW_LIST(X)							\
+	X(021,	'0', '2', '1', 0)					\
+	X(102,	'1', '0', '2', 0)					\
+	X(120,	'1', '2', '0', 0)					\
+	X(122,	'1', '2', '2', 0)					\
+	X(201,	'2', '0', '1', 0)					\
+	X(210,	'2', '1', '0', 0)					\
+	X(212,	'2', '1', '2', 0)					\
+	X(221,	'2', '2', '1', 0)					\
+	X(A,	'a', 0, 0, 0)						\
+	X(ALT,	'a', 'l', 't', 0)					\
+	X(ALU,	'a', 'l', 'u', 0)					\
+	X(B,	'b', 0, 0, 0)						\
+	X(C,	'c', 0, 0, 0)						\
+	X(CBNS,	'c', 'b', 'n', 's')					\
+	X(CC,	'c', 'c', 0, 0)						\
+	X(DREL,	'd', 'r', 'e', 'l')					\
+	X(EOP,	'e', 'o', 'p', 0)					\
+	X(F,	'f', 0, 0, 0)						\
+	X(FLT2,	'f', 'l', 't', '2')					\
+	X(FLT3,	'f', 'l', 't', '3')					\
+	X(FS,	'f', 's', 0, 0)						\
+	X(FWQ,	'f', 'w', 'q', 0)					\
+	X(I,	'i', 0, 0, 0)						\
+	X(IMG,	'i', 'm', 'g', 0)					\
+	X(IMGA,	'i', 'm', 'g', 'a')					\
+	X(IML,	'i', 'm', 'l', 0)					\
+	X(IXY,	'i', 'x', 'y', 0)					\
+	X(IZ,	'i', 'z', 0, 0)						\
+	X(KC0,	'k', 'c', '0', 0)					\
+	X(KC1,	'k', 'c', '1', 0)					\
+	X(L1,	'l', '1', 0, 0)						\
+	X(L2,	'l', '2', 0, 0)						\
+	X(LAST,	'l', 'a', 's', 't')					\
+	X(LLI,	'l', 'l', 'i', 0)					\
+	X(M,	'm', 0, 0, 0)						\
+	X(MF,	'm', 'f', 0, 0)						\
+	X(N,	'n', 0, 0, 0)						\
+	X(NB,	'n', 'b', 0, 0)						\
+	X(NOP,	'n', 'o', 'p', 0)					\
+	X(PIX,	'p', 'i', 'x', 0)					\
+	X(POS,	'p', 'o', 's', 0)					\
+	X(PRM,	'p', 'r', 'm', 0)					\
+	X(PS,	'p', 's', 0, 0)						\
+	X(PS0,	'p', 's', '0', 0)					\
+	X(PS1,	'p', 's', '1', 0)					\
+	X(REG,	'r', 'e', 'g', 0)					\
+	X(REL,	'r', 'e', 'l', 0)					\
+	X(RET,	'r', 'e', 't', 0)					\
+	X(RIM0,	'r', 'i', 'm', '0')					\
+	X(RIM1,	'r', 'i', 'm', '1')					\
+	X(S,	's', 0, 0, 0)						\
+	X(SAMP,	's', 'a', 'm', 'p')					\
+	X(SEM,	's', 'e', 'm', 0)					\
+	X(SIM0,	's', 'i', 'm', '0')					\
+	X(SIM1,	's', 'i', 'm', '1')					\
+	X(SMA,	's', 'm', 'a', 0)					\
+	X(SREL,	's', 'r', 'e', 'l')					\
+	X(T,	't', 0, 0, 0)						\
+	X(TC,	't', 'c', 0, 0)						\
+	X(UCF,	'u', 'c', 'f', 0)					\
+	X(UEM,	'u', 'e', 'm', 0)					\
+	X(UP,	'u', 'p', 0, 0)						\
+	X(V,	'v', 0, 0, 0)						\
+	X(VC,	'v', 'c', 0, 0)						\
+	X(VPM,	'v', 'p', 'm', 0)					\
+	X(VS,	'v', 's', 0, 0)						\
+	X(WN,	'w', 'n', 0, 0)						\
+	X(WQM,	'w', 'q', 'm', 0)					\
+	X(XD,	'x', 'd', 0, 0)						\
+	X(XN,	'x', 'n', 0, 0)						\
+	X(YN,	'y', 'n', 0, 0)						\
+	X(ZN,	'z', 'n', 0, 0)						\
+
+enum kw {
+	KW_NONE,
+#define X(id, c0, c1, c2, c3)	KW_##id,
+	KW_LIST(X)
+#undef X
+	KW_NUM
+};
+
+int	kw_lookup(const char *s, int len);
+#endif
@@ -5,450 +5,333 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "main.h"
+#include "cli.h"
 
-#define MAX_TOKENS			200
+#define INPUT_CHUNK_SIZE		(64 * 1024)
 
+/* For pipes and other inputs that cannot be mapped. */
 static
-int inst_base_tokenize(struct inst_base *this, int ls, int le)
+int input_read(int fd, const char **out_buf, size_t *out_size)
 {
-	int is_delim, i, j, k, is_space, ts, len;
-	const char *buf;
-	static char *tokens[MAX_TOKENS];
-	static const char *delims = ".,;()[]-+/*$";
+	char *buf, *t;
+	size_t size, max;
+	ssize_t ret;
 
-	buf = this->as->buf;
-	ts = -1;
-	for (i = ls, j = 0; i < le; ++i) {
-		is_delim = is_space = isspace(buf[i]);
-
-		/* Not even a delim, because no open token. */
-		if (is_delim && ts < 0)
-			continue;
-
-		/* in-instruction delims */
-		for (k = 0; k < (int)strlen(delims); ++k)
-			is_delim |= buf[i] == delims[k];
-
-		if (is_delim) {
-			/*
-			 * For back to back delims, there may not be a token
-			 * open. for e.g. [0x1f,ix0][0x0]. For ][, there is no
-			 * open token.
-			 */
-			/* Close any open token */
-			if (ts >= 0) {
-				len = i - ts;
-				tokens[j] = calloc(len + 1, sizeof(char));
-				memcpy(tokens[j], &buf[ts], len);
-				++j;
-				ts = -1;
-			}
-
-			if (is_space)
-				continue;
-
-			/* Create a token for the non-space delims */
-			assert(j < MAX_TOKENS);
-			tokens[j] = calloc(2, sizeof(char));
-			tokens[j][0] = buf[i];
-			++j;
-
-			/* ; is the end of the curr instr. return */
-			if (buf[i] == ';')
-				break;
-		} else if (ts < 0) {
-			ts = i;
-		}
-	}
-
-	if (i == le)
-		return EINVAL;
-
-	this->num_tokens = j;
-	this->tokens = calloc(j, sizeof(char *));
-	if (this->tokens == NULL)
-		return ENOMEM;
-	memcpy(this->tokens, tokens, j * sizeof(char *));
-	return 0;
-}
-
-/* le contains the buf_size, i.e. the end of the file */
-static
-int inst_base_parse_labels(struct inst_base *this, int *ls, int *le)
-{
-	int i, e, s, len, j;
-	const char *buf;
-
-	buf = this->as->buf;
-	i = *ls;
-	e = *le;
+	buf = NULL;
+	size = max = 0;
 	for (;;) {
-		/* Skip whitespace. */
-		for (i = i; i < e; ++i) {
-			if (!isspace(buf[i]))
-				break;
-		}
-
-		/* Line starts here */
-		*ls = s = i;
-
-		/* Done with the file */
-		if (s == e)
-			return 0;
-
-		/* Is it a comment? Ignore until the end of the line. */
-		if (buf[s] == '#') {
-			for (i = s; i < e; ++i) {
-				/* The \n will be skipped in the loop abv */
-				if (buf[i] == '\n')
-					break;
+		if (max - size < INPUT_CHUNK_SIZE) {
+			max = max ? 2 * max : INPUT_CHUNK_SIZE;
+			t = realloc(buf, max);
+			if (t == NULL) {
+				free(buf);
+				return ENOMEM;
 			}
-			continue;
-		}
-
-		/* Scan for delimiters */
-		for (i = s; i < e; ++i) {
-			if (buf[i] == ';')	/* InstrEnd */
-				break;
-			if (buf[i] == ':')	/* LabelEnd */
-				break;
-		}
-
-		/* No delims found. Invalid */
-		if (i == e)
-			return EINVAL;
-
-		/* Delim found is InstrEnd. Return. */
-		if (buf[i] == ';') {
-			*le = i + 1;	/* Next invocation will begin here */
-			return 0;
+			buf = t;
 		}
 
-		/* Else a : was found. */
-		len = i - s;
-		++i;	/* Skip the :, and continue scan for more labels. */
-
-		/* Is the label correct? */
-		if (len <= 0)	/* : alone */
-			return EINVAL;
-
-		/* TODO: Lables should have only letters, numbers and _ */
-
-		/* Add the label to the current instruction. */
-		j = this->num_labels++;
-		this->labels = realloc(this->labels, (j + 1) * sizeof(char *));
-		this->labels[j] = calloc(len + 1, sizeof(char));
-		memcpy((void *)this->labels[j], &buf[s], len);
-	}
-}
-
-int inst_base_fix_label(struct inst_base *this, const char *label, int *out)
-{
-	int i, j;
-	struct asm_base *as;
-	const struct inst_all *in;
-
-	as = this->as;
-	for (i = 0; i < as->num_insts; ++i) {
-		in = &as->insts[i];
-		for (j = 0; j < in->base.num_labels; ++j) {
-			if (strcmp(in->base.labels[j], label))
-				continue;
-			*out = in->base.pc;
-			return 0;
+		ret = read(fd, &buf[size], max - size);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0) {
+			free(buf);
+			return errno;
 		}
+		if (ret == 0)
+			break;
+		size += ret;
 	}
-	return EINVAL;
-}
-
-static
-int inst_all_parse(struct inst_all *this)
-{
-	int err;
-	struct inst_base *base;
-
-	base = &this->base;
-
-	/* Should be one of c,a,l,v,t,m,g */
-	err = EINVAL;
-	if (inst_base_is_next_token(base, "c"))
-		err = inst_cf_parse_all(this);
-	else if (inst_base_is_next_token(base, "v"))
-		err = inst_vtx_parse_all(this);
-	else if (inst_base_is_next_token(base, "a"))
-		err = inst_alu_parse_all(this);
-	else if (inst_base_is_next_token(base, "t"))
-		err = inst_tex_parse_all(this);
-	return err;
-}
-
-static
-int inst_all_fix_labels(struct inst_all *this)
-{
-	int err;
-	struct inst_base *base;
-
-	base = &this->base;
-
-	err = 0;
-	if (base->type >= IT_CF && base->type <= IT_CF_AIE_SWIZ)
-		err = inst_cf_fix_labels_all(this);
-	return err;
-}
-
-static
-int inst_all_encode(struct inst_all *this)
-{
-	int err;
-	struct inst_base *base;
-
-	base = &this->base;
-	err = EINVAL;
-	if (base->type >= IT_CF && base->type <= IT_CF_AIE_SWIZ)
-		err = inst_cf_encode_all(this);
-	else if (base->type >= IT_ALU_OP2 && base->type <= IT_ALU_OP3)
-		err = inst_alu_encode_all(this);
-	else if (base->type >= IT_VTX_GPR && base->type <= IT_VTX_SEM)
-		err = inst_vtx_encode_all(this);
-	else if (base->type == IT_TEX)
-		err = inst_tex_encode_all(this);
-	return err;
+	*out_buf = buf;
+	*out_size = size;
+	return 0;
 }
 
 static
-void inst_all_print(const struct inst_all *this)
+int input_map(int fd, size_t size, const char **out_buf)
 {
-	int i, j;
-	const char *buf;
-	const struct inst_base *base;
+	void *buf;
 
-	base = &this->base;
-	buf = this->base.as->buf;
-
-	/* print any labels first. */
-	for (i = 0; i < base->num_labels; ++i)
-		printf("/*%s:*/\n", base->labels[i]);
-	for (i = 0; i < base->num_words; ++i)
-		printf("0x%08x, ", base->w[i]);
-	printf ("/*%d: ", base->pc);
-	for (i = base->ls; i < base->le; ++i) {
-		/* Replace multiple spaces with a single space */
-		if (isspace(buf[i])) {
-			for (j = i + 1; j < base->le; ++j) {
-				if (!isspace(buf[j]))
-					break;
-			}
-			i = j - 1;
-			/* Nothing but space until the end */
-			if (j == base->le)
-				continue;
-			printf(" ");
-		} else {
-			printf("%c", buf[i]);
-		}
+	/* mmap does not accept 0 length. */
+	if (size == 0) {
+		*out_buf = "";
+		return 0;
 	}
-	printf("*/\n");
-}
 
-static
-int inst_base_parse_number_token(struct inst_base *this, const char *t,
-				 int *out)
-{
-	if (strlen(t) >= 2 && t[0] == '0' && t[1] == 'x')
-		sscanf(&t[2], "%x", (unsigned int *)out);
-	else
-		sscanf(t, "%d", out);
+	buf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buf == MAP_FAILED)
+		return errno;
+	madvise(buf, size, MADV_SEQUENTIAL);
+	*out_buf = buf;
 	return 0;
-	(void)this;
 }
 
-int inst_base_parse_number(struct inst_base *this, int *out)
+/* Regular files are mapped; everything else, including stdin, is read. */
+int input_open(struct input *this, const char *path)
 {
-	int err;
-	const char *t;
+	int fd, err;
+	struct stat st;
 
-	t = inst_base_get_next_token(this);
-	err = inst_base_parse_number_token(this, t, out);
-	return err;
-}
+	this->mapped = false;
+	if (path == NULL || !strcmp(path, "-"))
+		return input_read(STDIN_FILENO, &this->buf, &this->size);
 
-int inst_base_parse_count(struct inst_base *this, int *out)
-{
-	int err;
-
-	if (inst_base_is_next_token(this, "(") == false)
-		return EINVAL;
-
-	err = inst_base_parse_number(this, out);
-	if (err)
-		return err;
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return errno;
 
-	if (inst_base_is_next_token(this, ")") == false)
-		return EINVAL;
-	return 0;
+	err = fstat(fd, &st) ? errno : 0;
+	if (!err && S_ISREG(st.st_mode)) {
+		this->size = st.st_size;
+		this->mapped = true;
+		err = input_map(fd, this->size, &this->buf);
+	} else if (!err) {
+		err = input_read(fd, &this->buf, &this->size);
+	}
+	close(fd);
+	return err;
 }
 
-int inst_base_parse_register(struct inst_base *this, int *out)
+void input_close(struct input *this)
 {
-	const char *t;
-
-	t = inst_base_get_next_token(this);
-	if (t[0] != 'r' && t[0] != 'R')
-		return EINVAL;
-	return inst_base_parse_number_token(this, &t[1], out);
+	if (this->mapped && this->size)
+		munmap((void *)this->buf, this->size);
+	else if (!this->mapped)
+		free((void *)this->buf);
+	this->buf = NULL;
+	this->size = 0;
 }
 
 static
-int inst_base_parse_swizzle_char(struct inst_base *this, char sc)
-{
-	if (sc == 'x' || sc == 'X') return SEL_X;
-	if (sc == 'y' || sc == 'Y') return SEL_Y;
-	if (sc == 'z' || sc == 'Z') return SEL_Z;
-	if (sc == 'w' || sc == 'W') return SEL_W;
-	if (sc == '0') return SEL_0;
-	if (sc == '1') return SEL_1;
-	return SEL_MASK;
-	(void)this;
-}
-
-int inst_base_parse_channel(struct inst_base *this, int *out)
-{
-	const char *t;
-
-	t = inst_base_get_next_token(this);
-	if (strlen(t) != 1)
-		return EINVAL;
-	*out = inst_base_parse_swizzle_char(this, t[0]);
-	return 0;
-}
-
-int inst_base_parse_swizzle(struct inst_base *this, int *swiz)
+void usage(const char *name)
 {
-	int i;
-	const char *t;
-
-	t = inst_base_get_next_token(this);
-	if (strlen(t) != 4)
-		return EINVAL;
-	for (i = 0; i < 4; ++i)
-		swiz[i] = inst_base_parse_swizzle_char(this, t[i]);
-	return 0;
+	printf("Usage: %s [-s] [-p threads] [-o fmt] [-c dir [-C size]] "
+	       "[input.s]\n", name);
+	printf("       %s -P [input.s]\n", name);
+	printf("       %s [-o fmt] -w out input.s\n", name);
+	printf("       %s [-s] [-o fmt] [-c dir [-C size]] -d outdir "
+	       "[-j threads] [-m manifest] [input.s...]\n", name);
+	printf("       %s -S socket [-p threads] [-j threads] "
+	       "[-c dir [-C size]]\n", name);
+	printf("       %s -r socket [-s] [input.s]\n", name);
+	printf("       %s -D [-R] [-j threads] [input.bin...]\n", name);
+	printf("\t-s: parse and encode in a single pass\n");
+	printf("\t-p: split a large input across threads\n");
+	printf("\t-P: stream; parse, encode and print on separate threads, "
+	       "as the input is read, in bounded memory; to a pipe, at most "
+	       "%d instructions may wait on a label defined after them\n",
+	       PIPE_MAX_HELD);
+	printf("\t-w: watch; write out, and update it each time the input "
+	       "is saved, reassembling only what changed\n");
+	printf("\t-d: batch mode; write input.s to outdir/input.out\n");
+	printf("\t-j: batch, server or -D threads; the number of cores by "
+	       "default\n");
+	printf("\t-m: batch inputs listed in a file, one per line\n");
+	printf("\t-S: serve assembly requests on a unix socket, keeping the "
+	       "assembler warm between them\n");
+	printf("\t-r: assemble through the server at socket; the words are "
+	       "written as with -o bin\n");
+	printf("\t-D: disassemble inputs written with -o bin\n");
+	printf("\t-R: check that the text assembles back to the input, "
+	       "instead of printing it\n");
+	printf("\t-o: hex (annotated, the default), bin (little-endian words) "
+	       "or c (an array)\n");
+	printf("\t-c: reuse the outputs of inputs seen before, kept in a "
+	       "directory\n");
+	printf("\t-C: the size of that directory, in MB; %lu by default\n",
+	       CLI_CACHE_SIZE >> 20);
 }
 
 int main(int argc, char **argv)
 {
-	int i, size, err, ls, le, pc;
-	FILE *f;
-	char *buf;
-	struct asm_base as;
-	struct inst_all *in;
-
-	if (argc != 2) {
-		printf("Usage: %s input.s\n", argv[0]);
-		return EINVAL;
-	}
-
-	f = fopen(argv[1], "rb");
-	if (f == NULL)
-		return errno;
-	fseek(f, 0, SEEK_END);
-	size = ftell(f);
-	fseek(f, 0, SEEK_SET);
-
-	buf = malloc(size);
-	if (buf == NULL)
-		return ENOMEM;
-	fread(buf, 1, size, f);
-	fclose(f);
-
-	pc = 0;
-	asm_base_construct(&as, buf, size);
-	for (i = 0; i < as.buf_size; i = le) {
-		in = &as.insts[as.num_insts];
-
-		/* inst_base construction done here for all inst types */
-		inst_all_construct(in, &as);
-
-		/* [ls, le) */
-		ls = i;
-		le = as.buf_size;
-		err = inst_base_parse_labels(&in->base, &ls, &le);
-		if (err) {
-			printf("labels err\n");
+	int c, fd, err;
+	long mb;
+	size_t size;
+	struct input in;
+	struct asm_par par;
+	struct out_buf ob;
+	struct egasm_diag diag;
+	struct cli_opts opts;
+	struct cache cache;
+	struct cache_key key;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.num_chunk_threads = 1;
+	opts.cache_size = CLI_CACHE_SIZE;
+	while ((c = getopt(argc, argv, "sPp:d:j:m:o:c:C:w:S:r:DR")) != -1) {
+		switch (c) {
+		case 's':
+			opts.single_pass = true;
+			break;
+		case 'P':
+			opts.pipeline = true;
+			break;
+		case 'p':
+			opts.num_chunk_threads = atoi(optarg);
+			if (opts.num_chunk_threads <= 0)
+				argc = 0;
+			break;
+		case 'd':
+			opts.out_dir = optarg;
+			break;
+		case 'j':
+			opts.num_threads = atoi(optarg);
+			if (opts.num_threads <= 0)
+				argc = 0;
+			break;
+		case 'm':
+			opts.manifest = optarg;
+			break;
+		case 'o':
+			if (out_fmt_parse(optarg, &opts.fmt))
+				argc = 0;
+			break;
+		case 'w':
+			opts.watch_out = optarg;
+			break;
+		case 'c':
+			opts.cache_dir = optarg;
+			break;
+		case 'C':
+			mb = atol(optarg);
+			if (mb <= 0)
+				argc = 0;
+			opts.cache_size = (size_t)mb << 20;
+			break;
+		case 'S':
+			opts.serve_sock = optarg;
+			break;
+		case 'r':
+			opts.remote_sock = optarg;
+			break;
+		case 'D':
+			opts.disassemble = true;
+			break;
+		case 'R':
+			opts.round_trip = true;
+			break;
+		default:
+			argc = 0;	/* Print usage. */
 			break;
 		}
+	}
 
-		/* Let it end with i == buf_size. */
-		if (ls == as.buf_size)
-			continue;
-
-		err = inst_base_tokenize(&in->base, ls, le);
-		if (err) {
-			printf("tokenize err\n");
-			break;
+	if (argc && opts.disassemble) {
+		if (opts.single_pass || opts.pipeline ||
+		    opts.num_chunk_threads != 1 || opts.fmt != OUT_HEX ||
+		    opts.out_dir || opts.manifest || opts.watch_out ||
+		    opts.cache_dir || opts.serve_sock || opts.remote_sock) {
+			usage(argv[0]);
+			return EINVAL;
 		}
-#if 0
-		{
-			int j;
-			for (j = 0; j < in->num_tokens; ++j)
-				printf("tokens[%d]: %s\n", j, in->tokens[j]);
+		return dump_main(&opts, &argv[optind], argc - optind);
+	}
+
+	if (argc && opts.serve_sock) {
+		if (optind < argc || opts.single_pass || opts.pipeline ||
+		    opts.fmt != OUT_HEX || opts.out_dir || opts.manifest ||
+		    opts.watch_out || opts.remote_sock) {
+			usage(argv[0]);
+			return EINVAL;
 		}
-#endif
+		return serve_main(&opts, opts.serve_sock);
+	}
 
-		err = inst_all_parse(in);
-		if (err) {
-			printf("parse err\n");
-			break;
+	if (argc && opts.remote_sock) {
+		if (argc - optind > 1 || opts.pipeline ||
+		    opts.num_chunk_threads != 1 || opts.fmt == OUT_C ||
+		    opts.out_dir || opts.manifest || opts.num_threads ||
+		    opts.watch_out || opts.cache_dir) {
+			usage(argv[0]);
+			return EINVAL;
 		}
+		return serve_client_main(&opts, opts.remote_sock,
+					 optind < argc ? argv[optind] : NULL);
+	}
 
-		in->base.pc = pc;
-		in->base.ls = ls;
-		in->base.le = le;
-		pc += in->base.num_words / 2;	/* For the next instruction */
+	if (argc && opts.out_dir)
+		return batch_main(&opts, &argv[optind], argc - optind);
 
-		++as.num_insts;
-		if (as.num_insts % 100)
-			continue;
-		size = (as.num_insts + 100) * sizeof(*in);
-		as.insts = realloc(as.insts, size);
+	if (argc == 0 || argc - optind > 1 || opts.num_threads ||
+	    opts.manifest || opts.round_trip) {
+		usage(argv[0]);
+		return EINVAL;
 	}
 
-	if (err) {
-		printf("err %d, i = %x, done = %d\n", err, i, as.num_insts);
-		return err;
+	if (opts.pipeline) {
+		if (opts.single_pass || opts.num_chunk_threads != 1 ||
+		    opts.fmt != OUT_HEX || opts.cache_dir) {
+			usage(argv[0]);
+			return EINVAL;
+		}
+		return pipe_main(optind < argc ? argv[optind] : NULL);
 	}
-	for (i = 0; i < as.num_insts; ++i) {
-		in = &as.insts[i];
-		err = inst_all_fix_labels(in);
-		if (err)
-			break;
+
+	if (opts.watch_out) {
+		if (opts.single_pass || opts.num_chunk_threads != 1 ||
+		    opts.cache_dir || optind == argc) {
+			usage(argv[0]);
+			return EINVAL;
+		}
+		return watch_main(&opts, argv[optind], opts.watch_out);
 	}
 
-	if (err) {
-		printf("fix_labels err %d, i = %x\n", err, i);
+	/* Without an input, or with -, read from stdin. */
+	err = input_open(&in, optind < argc ? argv[optind] : NULL);
+	if (err)
 		return err;
-	}
 
-	for (i = 0; i < as.num_insts; ++i) {
-		in = &as.insts[i];
-		err = inst_all_encode(in);
-		if (err)
-			break;
+	if (opts.cache_dir) {
+		err = cache_construct(&cache, opts.cache_dir, opts.cache_size);
+		if (err) {
+			input_close(&in);
+			return err;
+		}
+
+		/* An input seen before is copied, not assembled. */
+		out_cache_key(in.buf, in.size, opts.fmt, &key);
+		if (cache_open(&cache, &key, &fd, &size) == 0) {
+			err = cache_copy(fd, STDOUT_FILENO, size);
+			close(fd);
+			goto close;
+		}
 	}
 
+	err = asm_par_construct(&par, opts.num_chunk_threads);
+	if (err)
+		goto close;
+	par.single_pass = opts.single_pass;
+
+	err = asm_par_assemble(&par, in.buf, in.size, &diag);
 	if (err) {
-		printf("encode err %d, i = %x\n", err, i);
-		return err;
+		printf("%s err %d, line %d, i = %zx, inst = %d\n", diag.stage,
+		       err, diag.line, diag.pos, diag.inst);
 	}
 
-	for (i = 0; i < as.num_insts; ++i) {
-		in = &as.insts[i];
-		inst_all_print(in);
+	if (!err && opts.fmt == OUT_HEX)
+		err = out_buf_construct(&ob);
+	if (!err) {
+		if (opts.cache_dir)
+			err = out_write_cache(&cache, &key, &ob, STDOUT_FILENO,
+					      opts.fmt, par.chunks,
+					      par.num_chunks);
+		else
+			err = out_write(&ob, STDOUT_FILENO, opts.fmt,
+					par.chunks, par.num_chunks);
+		if (opts.fmt == OUT_HEX)
+			out_buf_destruct(&ob);
 	}
+	asm_par_destruct(&par);
+close:
+	if (opts.cache_dir)
+		cache_destruct(&cache);
+	input_close(&in);
 	return err;
 }
@@ -5,13 +5,23 @@
 #define MAIN_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <pthread.h>
 
+#include "egasm.h"
 #include "bits.h"
 #include "cf.h"
 #include "vtx.h"
 #include "alu.h"
 #include "tex.h"
+#include "arena.h"
+#include "sym.h"
+#include "kw.h"
+#include "scan.h"
+#include "soa.h"
+#include "cache.h"
+#include "memo.h"
 
 #ifndef container_of
 #define container_of(p, t, m)		(t *)((char *)p - offsetof(t, m))
@@ -52,24 +62,95 @@ enum inst_type {
 	IT_GDS,
 };
 
-struct asm_base;
+enum token_type {
+	TOKEN_ID,		/* None of the below; labels. */
+	TOKEN_PUNCT,		/* val is the character. */
+	TOKEN_INT,		/* %d or 0x%x in val. */
+	TOKEN_GPR,		/* r# or R#; # in val. */
+	TOKEN_PARAM,		/* p#; # in val. */
+	TOKEN_KCACHE,		/* k#; # in val. */
+};
+
+/* [s, s + len) within asm_base.buf, classified by the lexer. */
+struct token {
+	size_t				s;
+	int				len;
+	int				val;
+	short				swz;	/* -1, or 3 bits per SEL_* */
+	unsigned char			type;	/* enum token_type */
+	unsigned char			kw;	/* enum kw */
+};
+
+/*
+ * A reference to a label not yet defined, by the instruction at index inst.
+ * References to the same label are chained through next; -1 ends the chain.
+ */
+struct patch {
+	int				inst;
+	int				next;
+};
+
+struct inst_all;
+struct asm_base {
+	const char			*buf;
+
+	/* Backs everything below, and the symbol table. */
+	struct arena			arena;
+
+	struct inst_all			*insts;
+
+	/* Token and label spans of all instructions, in source order. */
+	struct token			*tokens;
+	struct token			*labels;
+
+	struct sym_tab			syms;
+
+	/* Single pass: forward references awaiting their labels. */
+	struct patch			*patches;
+
+	const struct scan_ops		*scan;
+	const struct soa_ops		*soa;
+
+	/* Of the instructions seen before, if set; not reset with the rest. */
+	struct memo			*memo;
+
+	size_t				buf_size;
+	size_t				buf_start;	/* Where lexing starts */
+	int				num_insts;
+	int				max_insts;
+	int				num_tokens;
+	int				num_labels;
+	int				max_tokens;
+	int				max_labels;
+	int				num_patches;
+	int				max_patches;
+	int				num_unresolved;
+
+	/* Encode each instruction as soon as it is parsed. */
+	bool				single_pass;
+};
+
 struct inst_base {
 	struct asm_base			*as;
-	const char			**tokens;
-	const char			**labels;
 
 	int				w[4];
 	int				pc;	/* 64-bit units */
-	int				num_words;
-
-	enum inst_type			type;
 
+	/*
+	 * Indices into asm_base.tokens and asm_base.labels. The tokens also
+	 * locate the source text, from the first one through the ;. Those of
+	 * an instruction recalled from asm_base.memo are just two: all of its
+	 * text, and the ;.
+	 */
+	int				tokens;
+	int				labels;
 	int				num_labels;
 	int				num_tokens;
 	int				next_token;
 
-	int				ls;	/* For printing. */
-	int				le;
+	unsigned char			num_words;
+	unsigned char			type;	/* enum inst_type */
+	bool				encoded;	/* While parsed */
 };
 
 static inline
@@ -79,26 +160,53 @@ void inst_base_construct(struct inst_base *this, struct asm_base *as)
 	this->next_token = -1;
 }
 
+/*
+ * Past the ; of a truncated instruction, the token returned is one that no
+ * parser takes, so that the parse fails with EINVAL. The index still moves,
+ * for the undo of the is_next helpers.
+ */
 static inline
-const char *inst_base_get_next_token(struct inst_base *this)
+const struct token *inst_base_get_next_token(struct inst_base *this)
 {
-	assert(this->next_token < this->num_tokens - 1);
+	static const struct token none = {0, 0, 0, -1, TOKEN_ID, KW_NONE};
+
 	++this->next_token;
-	return this->tokens[this->next_token];
+	if (this->next_token >= this->num_tokens)
+		return &none;
+	return &this->as->tokens[this->tokens + this->next_token];
 }
 
 static inline
-bool inst_base_is_next_token(struct inst_base *this, const char *s)
+int inst_base_get_next_kw(struct inst_base *this)
 {
-	const char *t;
+	return inst_base_get_next_token(this)->kw;
+}
+
+static inline
+bool inst_base_is_next_kw(struct inst_base *this, int kw)
+{
+	if (inst_base_get_next_kw(this) == kw)
+		return true;
+	--this->next_token;	/* Undo if not found. */
+	return false;
+}
+
+static inline
+bool inst_base_is_next_punct(struct inst_base *this, char c)
+{
+	const struct token *t;
 
 	t = inst_base_get_next_token(this);
-	if (!strcmp(t, s))
+	if (t->type == TOKEN_PUNCT && t->val == c)
 		return true;
 	--this->next_token;	/* Undo if not found. */
 	return false;
 }
 
+/*
+ * The format fields are bit-fields of their hardware widths, and hold the
+ * values as encoded; e.g. count - 1 for the counts.
+ */
 struct inst_all {
 	struct inst_base		base;
 	union {
@@ -123,30 +231,197 @@ void inst_all_construct(struct inst_all *this, struct asm_base *as)
 }
 
 
-struct asm_base {
-	const char			*buf;
-
-	struct inst_all			*insts;
+void	asm_base_reset(struct asm_base *this, const char *buf,
+		       size_t buf_size);
 
-	int				buf_size;
-	int				num_insts;
-};
+static inline
+void asm_base_construct(struct asm_base *this, const char *buf,
+			size_t buf_size)
+{
+	arena_construct(&this->arena);
+	asm_base_reset(this, buf, buf_size);
+	this->memo = NULL;
+	this->single_pass = false;
+}
 
 static inline
-void asm_base_construct(struct asm_base *this, const char *buf, int buf_size)
+void asm_base_destruct(struct asm_base *this)
 {
-	this->buf	= buf;
-	this->buf_size	= buf_size;
-	this->insts	= malloc(100 * sizeof(struct inst_all));
-	this->num_insts	= 0;
+	arena_destruct(&this->arena);
 }
 
+struct inst_all	*asm_base_new_inst(struct asm_base *this);
+int	asm_base_parse(struct asm_base *this, bool define_labels,
+		       struct egasm_diag *diag);
+int	asm_base_encode(struct asm_base *this, struct egasm_diag *diag);
+int	asm_base_assemble(struct asm_base *this, struct egasm_diag *diag);
+
+int	inst_base_lex(struct inst_base *this, size_t *i);
+size_t	inst_base_get_pos(const struct inst_base *this, size_t pos);
+int	inst_all_parse(struct inst_all *this);
+int	inst_all_encode(struct inst_all *this);
+
+/*
+ * Intra-file parallel assembly. buf is split at the ends of instructions into
+ * chunks, which are lexed, parsed and encoded in parallel. Only the pcs and
+ * the labels are resolved across the chunks, in between.
+ */
+struct asm_par {
+	const char			*buf;
+	size_t				size;
+
+	struct asm_base			*chunks;	/* In source order */
+	struct memo			*memos;		/* Of each chunk */
+	int				*pcs;		/* Of each chunk */
+	pthread_t			*threads;
+
+	/* The labels of all the chunks. */
+	struct arena			arena;
+	struct sym_tab			syms;
+
+	int				num_chunks;
+	int				max_chunks;
+	int				num_threads;
+	int				next;		/* Next chunk; atomic */
+	int				phase;
+	int				err;
+	bool				single_pass;
+};
+
+int	asm_par_construct(struct asm_par *this, int num_threads);
+void	asm_par_destruct(struct asm_par *this);
+int	asm_par_assemble(struct asm_par *this, const char *buf, size_t size,
+			 struct egasm_diag *diag);
+
+/*
+ * Pipelined assembly of a stream, as it is read. The caller's thread lexes and
+ * parses, one thread encodes, and one emits; bounded single-producer single-
+ * consumer rings of records join them. An instruction that references a label
+ * not yet defined waits, with everything after it, at a fence in the encoder
+ * until the label's record arrives; or, with emit_unresolved, goes on to emit
+ * with the label's id still in pipe_rec.label, for emit to patch later.
+ *
+ * Memory stays bounded by the window of source text not yet emitted, by the
+ * records at the fence, and by the labels; nothing else outlives its record.
+ * At most PIPE_MAX_HELD records wait at the fence; the one more fails with
+ * ENOBUFS, at the line of the reference they wait for.
+ */
+enum pipe_rec_type {
+	PIPE_REC_LABEL,
+	PIPE_REC_INST,
+	PIPE_REC_END,
+};
+
+struct pipe_rec {
+	struct inst_all			in;	/* The pc of a label, too */
+	size_t				s;	/* Source span; the name of */
+	size_t				e;	/* a label, or through the ; */
+	int				label;	/* Sym id defined or referenced */
+	int				inst;	/* Index of the instruction */
+	int				line;
+	unsigned char			type;	/* enum pipe_rec_type */
+};
+
+#define PIPE_RING_SIZE			1024	/* Power of 2 */
+#define PIPE_MAX_HELD			(256 * 1024)	/* 28MB of records */
+
+struct pipe_ring {
+	struct pipe_rec			*recs;
+
+	/* For a side that has run out of records or of space. */
+	pthread_mutex_t			lock;
+	pthread_cond_t			cond;
+	int				sleeping;	/* atomic */
+
+	_Alignas(64) unsigned int	head;	/* Next to pop; atomic */
+	_Alignas(64) unsigned int	tail;	/* Next to push; atomic */
+};
+
+/* Returns 0 or an errno value, which stops the pipeline. */
+typedef int (*asm_pipe_emit_fn)(void *arg, const char *buf,
+				const struct pipe_rec *rec);
+
+struct asm_pipe {
+	/* The parser's. The tokens are dropped after each instruction. */
+	struct asm_base			as;
+
+	/*
+	 * Address space reserved up front, so that buf never moves. The pages
+	 * before released are given back, once emitted.
+	 */
+	char				*buf;
+	size_t				size;	/* Read so far */
+	size_t				max_size;
+	size_t				released;
+	size_t				done;	/* Emitted through; atomic */
+	size_t				line_pos;	/* Of line, for the parser */
+	int				line;
+	int				fd;
+	bool				eof;
+
+	struct pipe_ring		rings[2];	/* To encode, to emit */
+
+	/*
+	 * The encoder's. Records behind the fence, or, with emit_unresolved,
+	 * those already sent on without their labels; and the pcs of labels.
+	 */
+	struct pipe_rec			*held;
+	int				*pcs;		/* By sym id; -1 */
+	int				head_held;
+	int				num_held;
+	int				max_held;
+	int				max_pcs;
+
+	asm_pipe_emit_fn		emit;
+	void				*arg;
+	bool				emit_unresolved;
+
+	pthread_t			threads[2];
+	struct egasm_diag		diags[3];	/* Of each stage */
+	int				stop;		/* atomic */
+};
+
+int	asm_pipe_construct(struct asm_pipe *this);
+void	asm_pipe_destruct(struct asm_pipe *this);
+int	asm_pipe_assemble(struct asm_pipe *this, int fd, asm_pipe_emit_fn emit,
+			  void *arg, struct egasm_diag *diag);
+
+/*
+ * Reassembly of an input edited since the last run. Only the instructions
+ * within the edit are lexed and parsed again; those around it are kept, with
+ * their sources moved. The pcs and the labels are then placed again, and only
+ * the instructions whose words may have changed are encoded again.
+ */
+struct asm_inc {
+	struct asm_base			as;
+	char				*buf;	/* A copy of the source, as run */
+	size_t				size;
+
+	/* Of the last run. */
+	int				*dirty;		/* Ascending */
+	int				num_dirty;
+	int				max_dirty;
+	int				first;		/* Of the edit */
+	int				num_parsed;
+	bool				moved;		/* The pcs from first */
+
+	int				num_dead;	/* Tokens and labels */
+	bool				valid;
+};
+
+int	asm_inc_construct(struct asm_inc *this);
+void	asm_inc_destruct(struct asm_inc *this);
+int	asm_inc_update(struct asm_inc *this, const char *buf, size_t size,
+		       struct egasm_diag *diag);
+
 int	inst_cf_parse_all(struct inst_all *all);
 int	inst_vtx_parse_all(struct inst_all *all);
 int	inst_alu_parse_all(struct inst_all *all);
 int	inst_tex_parse_all(struct inst_all *all);
 
+int	inst_cf_get_label_all(const struct inst_all *all);
 int	inst_cf_fix_labels_all(struct inst_all *all);
+void	inst_cf_patch_label_all(struct inst_all *all, int addr);
 
 int	inst_cf_encode_all(struct inst_all *all);
 int	inst_vtx_encode_all(struct inst_all *all);
@@ -158,7 +433,7 @@ int	inst_base_parse_channel(struct inst_base *this, int *out);
 int	inst_base_parse_register(struct inst_base *this, int *out);
 int	inst_base_parse_number(struct inst_base *this, int *out);
 int	inst_base_parse_count(struct inst_base *this, int *out);
+int	inst_base_parse_label(struct inst_base *this, int *out);
 
-int	inst_base_fix_label(struct inst_base *this, const char *label,
-			    int *out);
+int	inst_base_fix_label(struct inst_base *this, int label, int *out);
 #endif
@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "main.h"
+
+struct memo_ent {
+	struct inst_all			in;	/* As parsed and encoded */
+	const char			*text;
+	int				len;
+	unsigned int			hash;
+};
+
+/* Eight bytes at a time; the texts run to tens of bytes. */
+static
+unsigned int memo_hash(const char *s, int len)
+{
+	int i;
+	uint64_t h, v;
+
+	h = len * 0x9e3779b97f4a7c15ull;
+	for (i = 0; i + 8 <= len; i += 8) {
+		memcpy(&v, &s[i], sizeof(v));
+		h = (h ^ v) * 0xff51afd7ed558ccdull;
+		h ^= h >> 32;
+	}
+	if (i < len) {
+		v = 0;
+		memcpy(&v, &s[i], len - i);
+		h = (h ^ v) * 0xff51afd7ed558ccdull;
+		h ^= h >> 32;
+	}
+	return h;
+}
+
+/* The index of the slot of the text, or of the empty slot that ends its run. */
+static
+int memo_find_slot(const struct memo *this, const char *s, int len,
+		   unsigned int hash)
+{
+	int i, slot;
+	const struct memo_ent *ent;
+
+	for (i = hash & (this->num_slots - 1);;
+	     i = (i + 1) & (this->num_slots - 1)) {
+		slot = this->slots[i];
+		if (slot == 0)
+			return i;
+		ent = &this->ents[slot - 1];
+		if (ent->hash != hash || ent->len != len)
+			continue;
+		if (!memcmp(ent->text, s, len))
+			return i;
+	}
+}
+
+/* Keep the load factor at or below 1/2. */
+static
+int memo_grow(struct memo *this)
+{
+	int i, j, num_slots, max_ents, *slots;
+	struct memo_ent *ents;
+
+	if (this->num_ents == this->max_ents) {
+		max_ents = this->max_ents ? 2 * this->max_ents : 256;
+		ents = arena_realloc(&this->arena, this->ents,
+				     this->max_ents * sizeof(*ents),
+				     max_ents * sizeof(*ents));
+		if (ents == NULL)
+			return ENOMEM;
+		this->ents = ents;
+		this->max_ents = max_ents;
+	}
+
+	if (2 * (this->num_ents + 1) <= this->num_slots)
+		return 0;
+
+	num_slots = this->num_slots ? 2 * this->num_slots : 512;
+	slots = arena_alloc(&this->arena, num_slots * sizeof(*slots));
+	if (slots == NULL)
+		return ENOMEM;
+	memset(slots, 0, num_slots * sizeof(*slots));
+
+	/* Rehash. The texts are unique; no need to compare them. */
+	for (i = 0; i < this->num_ents; ++i) {
+		for (j = this->ents[i].hash & (num_slots - 1); slots[j];
+		     j = (j + 1) & (num_slots - 1))
+			;
+		slots[j] = i + 1;
+	}
+	this->slots = slots;
+	this->num_slots = num_slots;
+	return 0;
+}
+
+/* The instruction s[0, len) was, when seen before; NULL if unseen. */
+const struct inst_all *memo_find(struct memo *this, const char *s, int len)
+{
+	int slot;
+
+	++this->lookups;
+	if (this->num_ents == 0)
+		return NULL;
+	slot = this->slots[memo_find_slot(this, s, len, memo_hash(s, len))];
+	if (slot == 0)
+		return NULL;
+	++this->hits;
+	return &this->ents[slot - 1].in;
+}
+
+/* Keep in, parsed and encoded from s[0, len); a full table keeps nothing. */
+int memo_add(struct memo *this, const char *s, int len,
+	     const struct inst_all *in)
+{
+	int err, *slot;
+	unsigned int hash;
+	char *text;
+	struct memo_ent *ent;
+
+	if (this->num_ents == MEMO_MAX_ENTS || len > MEMO_MAX_LEN)
+		return 0;
+
+	err = memo_grow(this);
+	if (err)
+		return err;
+
+	hash = memo_hash(s, len);
+	slot = &this->slots[memo_find_slot(this, s, len, hash)];
+	if (*slot)
+		return 0;
+
+	text = arena_alloc(&this->arena, len);
+	if (text == NULL)
+		return ENOMEM;
+	memcpy(text, s, len);
+
+	ent = &this->ents[this->num_ents];
+	ent->in = *in;
+	ent->text = text;
+	ent->len = len;
+	ent->hash = hash;
+	*slot = ++this->num_ents;
+	return 0;
+}
@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef MEMO_H
+#define MEMO_H
+
+#define MEMO_MAX_ENTS			(16 * 1024)	/* Then full */
+#define MEMO_MAX_LEN			256	/* Of a text kept */
+
+/* Give up on an input that hits less than 1 in MEMO_MIN_RATE, once tried. */
+#define MEMO_TRIAL			1024	/* Lookups */
+#define MEMO_MIN_RATE			16
+
+struct inst_all;
+
+/*
+ * The instructions seen before, parsed and encoded, by their text from the
+ * first token through the ;. Only those encoded the same wherever they appear,
+ * i.e. those without a label to resolve, are kept. It outlives the inputs, and
+ * belongs to one thread at a time.
+ */
+struct memo_ent;
+struct memo {
+	struct arena			arena;	/* Backs everything below */
+	struct memo_ent			*ents;
+	int				*slots;	/* Index + 1; 0 if empty */
+
+	int				num_ents;
+	int				max_ents;
+	int				num_slots;	/* Power of 2 */
+
+	unsigned long			lookups;
+	unsigned long			hits;
+};
+
+static inline
+void memo_construct(struct memo *this)
+{
+	memset(this, 0, sizeof(*this));
+	arena_construct(&this->arena);
+}
+
+static inline
+void memo_destruct(struct memo *this)
+{
+	arena_destruct(&this->arena);
+}
+
+const struct inst_all	*memo_find(struct memo *this, const char *s, int len);
+int	memo_add(struct memo *this, const char *s, int len,
+		 const struct inst_all *in);
+#endif
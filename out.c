@@ -0,0 +1,493 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "main.h"
+#include "cli.h"
+
+/* Enough for the words, the pc and the punctuation of a line. */
+#define OUT_LINE_SIZE			80
+
+#define OUT_HEX_ROW(h)							\
+	h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7"			\
+	h "8" h "9" h "a" h "b" h "c" h "d" h "e" h "f"
+
+/* The two hex digits of each byte. */
+static const char out_hex[] =
+	OUT_HEX_ROW("0") OUT_HEX_ROW("1") OUT_HEX_ROW("2") OUT_HEX_ROW("3")
+	OUT_HEX_ROW("4") OUT_HEX_ROW("5") OUT_HEX_ROW("6") OUT_HEX_ROW("7")
+	OUT_HEX_ROW("8") OUT_HEX_ROW("9") OUT_HEX_ROW("a") OUT_HEX_ROW("b")
+	OUT_HEX_ROW("c") OUT_HEX_ROW("d") OUT_HEX_ROW("e") OUT_HEX_ROW("f");
+
+/* 0x%08x, */
+static
+char *out_fmt_word(char *p, uint32_t w)
+{
+	int i;
+
+	*p++ = '0';
+	*p++ = 'x';
+	for (i = 24; i >= 0; i -= 8) {
+		memcpy(p, &out_hex[2 * ((w >> i) & 0xff)], 2);
+		p += 2;
+	}
+	*p++ = ',';
+	return p;
+}
+
+/* %u */
+static
+char *out_fmt_uint(char *p, unsigned int v)
+{
+	int n;
+	char t[10];
+
+	n = 0;
+	do {
+		t[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	while (n)
+		*p++ = t[--n];
+	return p;
+}
+
+static
+int out_write_all(int fd, const char *p, size_t n)
+{
+	ssize_t ret;
+
+	while (n) {
+		ret = write(fd, p, n);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return errno;
+		p += ret;
+		n -= ret;
+	}
+	return 0;
+}
+
+int out_buf_construct(struct out_buf *this)
+{
+	int i;
+
+	memset(this, 0, sizeof(*this));
+	for (i = 0; i < OUT_NUM_CHUNKS; ++i) {
+		this->iov[i].iov_base = malloc(OUT_CHUNK_SIZE);
+		if (this->iov[i].iov_base == NULL) {
+			out_buf_destruct(this);
+			return ENOMEM;
+		}
+	}
+	this->fd = -1;
+	return 0;
+}
+
+void out_buf_destruct(struct out_buf *this)
+{
+	int i;
+
+	for (i = 0; i < OUT_NUM_CHUNKS; ++i)
+		free(this->iov[i].iov_base);
+}
+
+/*
+ * Start over on another output; anything not flushed is dropped. The offsets
+ * are of fd, which may already hold what was written before; on one that
+ * cannot seek, they start at 0.
+ */
+void out_buf_reset(struct out_buf *this, int fd)
+{
+	int i;
+
+	for (i = 0; i < OUT_NUM_CHUNKS; ++i)
+		this->iov[i].iov_len = 0;
+	this->curr = 0;
+	this->fd = fd;
+	this->off = lseek(fd, 0, SEEK_CUR);
+	if (this->off < 0)
+		this->off = 0;
+	this->err = 0;
+}
+
+/* Write out all the chunks with one writev, in the common case. */
+int out_buf_flush(struct out_buf *this)
+{
+	int i, n;
+	size_t len;
+	ssize_t ret;
+	struct iovec iov[OUT_NUM_CHUNKS], *v;
+
+	n = this->curr + 1;
+	memcpy(iov, this->iov, n * sizeof(*iov));
+	for (i = 0; i < n; ++i) {
+		this->off += iov[i].iov_len;
+		this->iov[i].iov_len = 0;
+	}
+	this->curr = 0;
+
+	/* On a partial write, go on from where it stopped. */
+	for (v = iov; n && !this->err;) {
+		ret = writev(this->fd, v, n);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0) {
+			this->err = errno;
+			break;
+		}
+		for (; n && (size_t)ret >= v->iov_len; ++v, --n)
+			ret -= v->iov_len;
+		if (n) {
+			len = ret;
+			v->iov_base = (char *)v->iov_base + len;
+			v->iov_len -= len;
+		}
+	}
+	return this->err;
+}
+
+/* Room for n <= OUT_CHUNK_SIZE bytes, in one piece; see out_buf_commit. */
+static
+char *out_buf_reserve(struct out_buf *this, size_t n)
+{
+	struct iovec *v;
+
+	assert(n <= OUT_CHUNK_SIZE);
+	v = &this->iov[this->curr];
+	if (v->iov_len + n <= OUT_CHUNK_SIZE)
+		return (char *)v->iov_base + v->iov_len;
+
+	if (++this->curr == OUT_NUM_CHUNKS) {
+		--this->curr;
+		out_buf_flush(this);
+	}
+	return this->iov[this->curr].iov_base;
+}
+
+static
+void out_buf_commit(struct out_buf *this, const char *e)
+{
+	struct iovec *v;
+
+	v = &this->iov[this->curr];
+	v->iov_len = e - (const char *)v->iov_base;
+}
+
+static
+void out_buf_put(struct out_buf *this, const char *s, size_t n)
+{
+	size_t len;
+	char *p;
+
+	for (; n; s += len, n -= len) {
+		len = n < OUT_CHUNK_SIZE ? n : OUT_CHUNK_SIZE;
+		p = out_buf_reserve(this, len);
+		memcpy(p, s, len);
+		out_buf_commit(this, p + len);
+	}
+}
+
+/* Runs of space become a single space; none is kept at the end. */
+static
+void out_buf_put_text(struct out_buf *this, const char *buf, size_t ls,
+		      size_t le)
+{
+	bool space;
+	size_t j, e;
+	char *q;
+
+	space = false;
+	for (j = ls; j < le;) {
+		e = le - j < OUT_CHUNK_SIZE / 2 ? le : j + OUT_CHUNK_SIZE / 2;
+
+		/* A pending space adds at most one byte to the piece. */
+		q = out_buf_reserve(this, e - j + 1);
+		for (; j < e; ++j) {
+			if (isspace((unsigned char)buf[j])) {
+				space = true;
+				continue;
+			}
+			if (space)
+				*q++ = ' ';
+			space = false;
+			*q++ = buf[j];
+		}
+		out_buf_commit(this, q);
+	}
+}
+
+/* off_t of what is put next. */
+off_t out_buf_tell(const struct out_buf *this)
+{
+	int i;
+	off_t off;
+
+	off = this->off;
+	for (i = 0; i <= this->curr; ++i)
+		off += this->iov[i].iov_len;
+	return off;
+}
+
+void out_buf_put_label(struct out_buf *this, const char *buf, size_t s,
+		       int len)
+{
+	out_buf_put(this, "/*", 2);
+	out_buf_put(this, &buf[s], len);
+	out_buf_put(this, ":*/\n", 4);
+}
+
+/* The words, the pc, and the source text in [ls, le), on one line. */
+void out_buf_put_inst(struct out_buf *this, const struct inst_base *base,
+		      const char *buf, size_t ls, size_t le)
+{
+	int i;
+	char *q;
+
+	q = out_buf_reserve(this, OUT_LINE_SIZE);
+	for (i = 0; i < base->num_words; ++i) {
+		q = out_fmt_word(q, base->w[i]);
+		*q++ = ' ';
+	}
+	*q++ = '/';
+	*q++ = '*';
+	q = out_fmt_uint(q, (unsigned int)base->pc);
+	*q++ = ':';
+	*q++ = ' ';
+	out_buf_commit(this, q);
+
+	out_buf_put_text(this, buf, ls, le);
+	out_buf_put(this, "*/\n", 3);
+}
+
+/* The annotated hex; the labels, and each instruction with its source. */
+static
+int out_write_hex(struct out_buf *this, int fd, const struct asm_base *chunks,
+		  int num_chunks)
+{
+	int c, i, j;
+	size_t ls, le;
+	const struct asm_base *as;
+	const struct inst_base *base;
+	const struct token *l, *t;
+
+	out_buf_reset(this, fd);
+	for (c = 0; c < num_chunks; ++c) {
+		as = &chunks[c];
+		for (i = 0; i < as->num_insts; ++i) {
+			base = &as->insts[i].base;
+			for (j = 0; j < base->num_labels; ++j) {
+				l = &as->labels[base->labels + j];
+				out_buf_put_label(this, as->buf, l->s, l->len);
+			}
+
+			/* From the first token through the ; */
+			t = &as->tokens[base->tokens];
+			ls = t[0].s;
+			le = t[base->num_tokens - 1].s + 1;
+			out_buf_put_inst(this, base, as->buf, ls, le);
+		}
+	}
+	return out_buf_flush(this);
+}
+
+/* All the words, little-endian, in one write. */
+static
+int out_write_bin(int fd, const struct asm_base *chunks, int num_chunks)
+{
+	int c, i, j, err;
+	size_t n;
+	uint32_t *words, w;
+	const struct asm_base *as;
+	const struct inst_base *base;
+
+	for (c = 0, n = 0; c < num_chunks; ++c) {
+		as = &chunks[c];
+		for (i = 0; i < as->num_insts; ++i)
+			n += as->insts[i].base.num_words;
+	}
+
+	words = malloc(n * sizeof(*words) + 1);
+	if (words == NULL)
+		return ENOMEM;
+
+	for (c = 0, n = 0; c < num_chunks; ++c) {
+		as = &chunks[c];
+		for (i = 0; i < as->num_insts; ++i) {
+			base = &as->insts[i].base;
+			for (j = 0; j < base->num_words; ++j) {
+				w = base->w[j];
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+				w = __builtin_bswap32(w);
+#endif
+				words[n++] = w;
+			}
+		}
+	}
+
+	err = out_write_all(fd, (const char *)words, n * sizeof(*words));
+	free(words);
+	return err;
+}
+
+static const char out_c_head[] =
+	"#include <stdint.h>\n\nstatic const uint32_t egasm_words[] = {\n";
+static const char out_c_tail[] = "};\n";
+
+/*
+ * A C array, with the labels and the pcs in comments; built in one buffer
+ * sized up front, and written at once.
+ */
+static
+int out_write_c(int fd, const struct asm_base *chunks, int num_chunks)
+{
+	int c, i, j, err;
+	size_t size;
+	char *buf, *p;
+	const struct asm_base *as;
+	const struct inst_base *base;
+	const struct token *l;
+
+	size = sizeof(out_c_head) + sizeof(out_c_tail);
+	for (c = 0; c < num_chunks; ++c) {
+		as = &chunks[c];
+		for (i = 0; i < as->num_insts; ++i) {
+			base = &as->insts[i].base;
+			size += OUT_LINE_SIZE;
+			for (j = 0; j < base->num_labels; ++j)
+				size += as->labels[base->labels + j].len + 9;
+		}
+	}
+
+	buf = malloc(size);
+	if (buf == NULL)
+		return ENOMEM;
+
+	p = buf;
+	memcpy(p, out_c_head, sizeof(out_c_head) - 1);
+	p += sizeof(out_c_head) - 1;
+	for (c = 0; c < num_chunks; ++c) {
+		as = &chunks[c];
+		for (i = 0; i < as->num_insts; ++i) {
+			base = &as->insts[i].base;
+			for (j = 0; j < base->num_labels; ++j) {
+				l = &as->labels[base->labels + j];
+				memcpy(p, "\t/* ", 4);
+				memcpy(p + 4, &as->buf[l->s], l->len);
+				p += 4 + l->len;
+				memcpy(p, ": */\n", 5);
+				p += 5;
+			}
+
+			*p++ = '\t';
+			for (j = 0; j < base->num_words; ++j) {
+				p = out_fmt_word(p, base->w[j]);
+				*p++ = ' ';
+			}
+			memcpy(p, "/* ", 3);
+			p = out_fmt_uint(p + 3, (unsigned int)base->pc);
+			memcpy(p, " */\n", 4);
+			p += 4;
+		}
+	}
+	memcpy(p, out_c_tail, sizeof(out_c_tail) - 1);
+	p += sizeof(out_c_tail) - 1;
+	assert((size_t)(p - buf) <= size);
+
+	err = out_write_all(fd, buf, p - buf);
+	free(buf);
+	return err;
+}
+
+/* ob is only used for OUT_HEX. */
+int out_write(struct out_buf *ob, int fd, enum out_fmt fmt,
+	      const struct asm_base *chunks, int num_chunks)
+{
+	switch (fmt) {
+	case OUT_BIN:
+		return out_write_bin(fd, chunks, num_chunks);
+	case OUT_C:
+		return out_write_c(fd, chunks, num_chunks);
+	default:
+		return out_write_hex(ob, fd, chunks, num_chunks);
+	}
+}
+
+/* The -o names; NULL ends. */
+static const char *const out_fmt_names[] = {
+	[OUT_HEX]	= "hex",
+	[OUT_BIN]	= "bin",
+	[OUT_C]		= "c",
+	NULL,
+};
+
+static const char *const out_fmt_exts[] = {
+	[OUT_HEX]	= ".out",
+	[OUT_BIN]	= ".bin",
+	[OUT_C]		= ".h",
+};
+
+int out_fmt_parse(const char *name, enum out_fmt *out)
+{
+	int i;
+
+	for (i = 0; out_fmt_names[i]; ++i) {
+		if (!strcmp(name, out_fmt_names[i])) {
+			*out = i;
+			return 0;
+		}
+	}
+	return EINVAL;
+}
+
+const char *out_fmt_ext(enum out_fmt fmt)
+{
+	return out_fmt_exts[fmt];
+}
+
+/* The output of the input in a format; each is cached apart. */
+void out_cache_key(const char *buf, size_t size, enum out_fmt fmt,
+		   struct cache_key *out)
+{
+	cache_key(buf, size, out_fmt_names[fmt], out);
+}
+
+/*
+ * out_write, through a new cache entry; it is then copied to fd, and put into
+ * place. Should the cache fail, the output goes to fd directly.
+ */
+int out_write_cache(struct cache *cache, const struct cache_key *key,
+		    struct out_buf *ob, int fd, enum out_fmt fmt,
+		    const struct asm_base *chunks, int num_chunks)
+{
+	int err;
+	off_t size;
+	struct cache_tmp tmp;
+
+	if (cache_tmp_open(cache, &tmp))
+		return out_write(ob, fd, fmt, chunks, num_chunks);
+
+	err = out_write(ob, tmp.fd, fmt, chunks, num_chunks);
+	size = err ? -1 : lseek(tmp.fd, 0, SEEK_CUR);
+	if (size < 0) {
+		cache_tmp_abort(&tmp);
+		return out_write(ob, fd, fmt, chunks, num_chunks);
+	}
+
+	err = cache_copy(tmp.fd, fd, size);
+	if (err)
+		cache_tmp_abort(&tmp);
+	else
+		cache_put(cache, key, &tmp);
+	return err;
+}
@@ -0,0 +1,285 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "main.h"
+
+#define PAR_CHUNKS_PER_THREAD		4
+#define PAR_MIN_CHUNK_SIZE		(256 * 1024)
+
+int asm_par_construct(struct asm_par *this, int num_threads)
+{
+	int i;
+
+	memset(this, 0, sizeof(*this));
+	if (num_threads < 1)
+		num_threads = 1;
+	this->num_threads = num_threads;
+	this->max_chunks = num_threads * PAR_CHUNKS_PER_THREAD;
+	if (num_threads == 1)
+		this->max_chunks = 1;
+
+	this->chunks = calloc(this->max_chunks, sizeof(*this->chunks));
+	this->memos = calloc(this->max_chunks, sizeof(*this->memos));
+	this->pcs = calloc(this->max_chunks, sizeof(*this->pcs));
+	this->threads = calloc(num_threads, sizeof(*this->threads));
+	if (this->chunks == NULL || this->memos == NULL || this->pcs == NULL ||
+	    this->threads == NULL) {
+		free(this->chunks);
+		free(this->memos);
+		free(this->pcs);
+		free(this->threads);
+		return ENOMEM;
+	}
+
+	/* A chunk is parsed by one thread at a time; so is its memo. */
+	for (i = 0; i < this->max_chunks; ++i) {
+		asm_base_construct(&this->chunks[i], "", 0);
+		memo_construct(&this->memos[i]);
+		this->chunks[i].memo = &this->memos[i];
+	}
+	arena_construct(&this->arena);
+	return 0;
+}
+
+void asm_par_destruct(struct asm_par *this)
+{
+	int i;
+
+	for (i = 0; i < this->max_chunks; ++i) {
+		asm_base_destruct(&this->chunks[i]);
+		memo_destruct(&this->memos[i]);
+	}
+	arena_destruct(&this->arena);
+	free(this->chunks);
+	free(this->memos);
+	free(this->pcs);
+	free(this->threads);
+}
+
+static
+void asm_par_add_chunk(struct asm_par *this, size_t start, size_t end)
+{
+	struct asm_base *as;
+
+	as = &this->chunks[this->num_chunks++];
+	asm_base_reset(as, this->buf, end);
+	as->buf_start = start;
+	as->single_pass = false;
+}
+
+/*
+ * Split buf, at the ends of instructions, into chunks of about equal size.
+ * This follows inst_base_lex only as far as needed to not take a ; within a
+ * comment for an end; the chunks find any errors.
+ */
+static
+void asm_par_split(struct asm_par *this)
+{
+	int n;
+	size_t pos, start, target, size;
+	const char *buf, *p, *q;
+	const struct scan_ops *scan;
+
+	buf = this->buf;
+	size = this->size;
+	scan = this->chunks[0].scan;
+
+	n = size / PAR_MIN_CHUNK_SIZE;
+	if (n > this->max_chunks)
+		n = this->max_chunks;
+	if (n < 1)
+		n = 1;
+
+	this->num_chunks = 0;
+	start = 0;
+	target = size / n;
+	for (pos = 0; pos < size && this->num_chunks < n - 1;) {
+		pos = scan->space_end(buf, pos, size);
+		if (pos == size)
+			break;
+
+		/* A comment can only begin where an instruction can. */
+		if (buf[pos] == '#') {
+			pos = scan->line_end(buf, pos + 1, size);
+			continue;
+		}
+
+		q = memchr(&buf[pos], ';', size - pos);
+		if (q == NULL)
+			break;
+
+		/* After a label, an instruction or a comment can begin. */
+		p = memchr(&buf[pos], ':', q - &buf[pos]);
+		if (p) {
+			pos = p - buf + 1;
+			continue;
+		}
+
+		pos = q - buf + 1;
+		if (pos < target)
+			continue;
+		asm_par_add_chunk(this, start, pos);
+		start = pos;
+		target = start + (size - start) / (n - this->num_chunks);
+	}
+	asm_par_add_chunk(this, start, size);
+}
+
+/* The chunk's own pcs start at 0. */
+static
+int asm_par_parse_chunk(struct asm_par *this, int c)
+{
+	return asm_base_parse(&this->chunks[c], false, NULL);
+}
+
+static
+int asm_par_get_num_pcs(const struct asm_base *as)
+{
+	const struct inst_base *base;
+
+	if (as->num_insts == 0)
+		return 0;
+	base = &as->insts[as->num_insts - 1].base;
+	return base->pc + base->num_words / 2;
+}
+
+/* Define the labels of all the chunks, in order, at their final pcs. */
+static
+int asm_par_define_labels(struct asm_par *this)
+{
+	int c, i, j, id, err;
+	const struct asm_base *as;
+	const struct inst_base *base;
+	const struct token *l;
+
+	arena_reset(&this->arena);
+	sym_tab_construct(&this->syms, this->buf, &this->arena);
+
+	for (c = 0; c < this->num_chunks; ++c) {
+		as = &this->chunks[c];
+		this->pcs[c] = 0;
+		if (c)
+			this->pcs[c] = this->pcs[c - 1] +
+				       asm_par_get_num_pcs(&as[-1]);
+
+		for (i = 0; i < as->num_insts; ++i) {
+			base = &as->insts[i].base;
+			for (j = 0; j < base->num_labels; ++j) {
+				l = &as->labels[base->labels + j];
+				err = sym_tab_intern(&this->syms, l->s, l->len,
+						     &id);
+				if (!err)
+					err = sym_tab_define(&this->syms, id,
+							     this->pcs[c] +
+							     base->pc);
+				if (err)
+					return err;
+			}
+		}
+	}
+	return 0;
+}
+
+/* Move to the final pcs, take the pcs of the labels, and encode. */
+static
+int asm_par_encode_chunk(struct asm_par *this, int c)
+{
+	int i, id, pc;
+	struct asm_base *as;
+	const struct sym *sym;
+
+	as = &this->chunks[c];
+	for (i = 0; i < as->num_insts; ++i)
+		as->insts[i].base.pc += this->pcs[c];
+
+	for (i = 0; i < as->syms.num_syms; ++i) {
+		sym = &as->syms.syms[i];
+		id = sym_tab_find(&this->syms, sym->name, sym->len);
+		if (id < 0)
+			continue;
+		pc = sym_tab_get_pc(&this->syms, id);
+		if (pc >= 0)
+			sym_tab_define(&as->syms, i, pc);
+	}
+	return asm_base_encode(as, NULL);
+}
+
+static
+void *asm_par_run(void *arg)
+{
+	int c, err;
+	struct asm_par *this;
+
+	this = arg;
+	for (;;) {
+		c = __atomic_fetch_add(&this->next, 1, __ATOMIC_RELAXED);
+		if (c >= this->num_chunks)
+			break;
+		if (this->phase == 0)
+			err = asm_par_parse_chunk(this, c);
+		else
+			err = asm_par_encode_chunk(this, c);
+		if (err)
+			__atomic_store_n(&this->err, err, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+/* Run the phase over all the chunks; the caller is one of the threads. */
+static
+int asm_par_run_phase(struct asm_par *this, int phase)
+{
+	int i;
+
+	this->phase = phase;
+	this->next = 0;
+	this->err = 0;
+
+	for (i = 1; i < this->num_threads && i < this->num_chunks; ++i) {
+		if (pthread_create(&this->threads[i], NULL, asm_par_run, this))
+			break;
+	}
+	asm_par_run(this);
+	while (--i > 0)
+		pthread_join(this->threads[i], NULL);
+	return this->err;
+}
+
+/*
+ * The result is in chunks[0, num_chunks), in source order. Any error sends the
+ * whole of buf through the sequential path, to report it as that path does.
+ */
+int asm_par_assemble(struct asm_par *this, const char *buf, size_t size,
+		     struct egasm_diag *diag)
+{
+	int err;
+
+	this->buf = buf;
+	this->size = size;
+	asm_par_split(this);
+
+	if (this->num_chunks > 1) {
+		err = asm_par_run_phase(this, 0);
+		if (!err)
+			err = asm_par_define_labels(this);
+		if (!err)
+			err = asm_par_run_phase(this, 1);
+		if (!err) {
+			if (diag)
+				memset(diag, 0, sizeof(*diag));
+			return 0;
+		}
+		this->num_chunks = 0;
+		asm_par_add_chunk(this, 0, size);
+	}
+
+	this->chunks[0].single_pass = this->single_pass;
+	return asm_base_assemble(&this->chunks[0], diag);
+}
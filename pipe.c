@@ -0,0 +1,692 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "main.h"
+
+#define PIPE_READ_SIZE			(64 * 1024)
+#define PIPE_SPINS			64
+#define PIPE_SLIDE_SIZE			(1024 * 1024)
+
+/* Address space, not memory; 1TB, or 1GB on 32-bit. */
+#define PIPE_MAX_INPUT			((size_t)1 << \
+					 (sizeof(size_t) > 4 ? 40 : 30))
+
+enum pipe_stage {
+	PIPE_PARSE,
+	PIPE_ENCODE,
+	PIPE_EMIT,
+};
+
+static
+int pipe_ring_construct(struct pipe_ring *this)
+{
+	memset(this, 0, sizeof(*this));
+	this->recs = malloc(PIPE_RING_SIZE * sizeof(*this->recs));
+	if (this->recs == NULL)
+		return ENOMEM;
+	pthread_mutex_init(&this->lock, NULL);
+	pthread_cond_init(&this->cond, NULL);
+	return 0;
+}
+
+static
+void pipe_ring_destruct(struct pipe_ring *this)
+{
+	if (this->recs == NULL)
+		return;
+	pthread_cond_destroy(&this->cond);
+	pthread_mutex_destroy(&this->lock);
+	free(this->recs);
+}
+
+/* Wake up the other side, if it sleeps. */
+static
+void pipe_ring_wake(struct pipe_ring *this, bool always)
+{
+	if (!always && !__atomic_load_n(&this->sleeping, __ATOMIC_SEQ_CST))
+		return;
+	pthread_mutex_lock(&this->lock);
+	pthread_cond_broadcast(&this->cond);
+	pthread_mutex_unlock(&this->lock);
+}
+
+/*
+ * Wait until *idx, the other side's index, moves from seen, or until the
+ * pipeline stops. Spin for a while before sleeping; the sleeping flag and the
+ * indices are seq-cst, so that either this side sees the move or the other
+ * side sees the flag.
+ */
+static
+void pipe_ring_wait(struct asm_pipe *this, struct pipe_ring *r,
+		    const unsigned int *idx, unsigned int seen)
+{
+	int i;
+
+	for (i = 0; i < PIPE_SPINS; ++i) {
+		if (__atomic_load_n(idx, __ATOMIC_ACQUIRE) != seen ||
+		    __atomic_load_n(&this->stop, __ATOMIC_ACQUIRE))
+			return;
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&r->lock);
+	__atomic_store_n(&r->sleeping, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(idx, __ATOMIC_SEQ_CST) == seen &&
+	       !__atomic_load_n(&this->stop, __ATOMIC_SEQ_CST))
+		pthread_cond_wait(&r->cond, &r->lock);
+	__atomic_store_n(&r->sleeping, 0, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&r->lock);
+}
+
+static
+int pipe_ring_push(struct asm_pipe *this, struct pipe_ring *r,
+		   const struct pipe_rec *rec)
+{
+	unsigned int head, tail;
+
+	tail = r->tail;
+	for (;;) {
+		head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		if (tail - head < PIPE_RING_SIZE)
+			break;
+		if (__atomic_load_n(&this->stop, __ATOMIC_ACQUIRE))
+			return ECANCELED;
+		pipe_ring_wait(this, r, &r->head, head);
+	}
+
+	r->recs[tail & (PIPE_RING_SIZE - 1)] = *rec;
+	__atomic_store_n(&r->tail, tail + 1, __ATOMIC_SEQ_CST);
+	pipe_ring_wake(r, false);
+	return 0;
+}
+
+/* A stage pushes its END before it stops the pipeline; that is still popped. */
+static
+int pipe_ring_pop(struct asm_pipe *this, struct pipe_ring *r,
+		  struct pipe_rec *rec)
+{
+	unsigned int head;
+
+	head = r->head;
+	while (__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == head) {
+		if (__atomic_load_n(&this->stop, __ATOMIC_ACQUIRE) &&
+		    __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == head)
+			return ECANCELED;
+		pipe_ring_wait(this, r, &r->tail, head);
+	}
+
+	*rec = r->recs[head & (PIPE_RING_SIZE - 1)];
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_SEQ_CST);
+	pipe_ring_wake(r, false);
+	return 0;
+}
+
+static
+void asm_pipe_stop(struct asm_pipe *this)
+{
+	__atomic_store_n(&this->stop, 1, __ATOMIC_SEQ_CST);
+	pipe_ring_wake(&this->rings[0], true);
+	pipe_ring_wake(&this->rings[1], true);
+}
+
+/* Record the failure of a stage. */
+static
+int asm_pipe_fail(struct asm_pipe *this, enum pipe_stage stage, int err,
+		  const char *name, int inst, size_t pos, int line)
+{
+	struct egasm_diag *diag;
+
+	if (err == ECANCELED)
+		return err;
+	diag = &this->diags[stage];
+	diag->err = err;
+	diag->stage = name;
+	diag->inst = inst;
+	diag->pos = pos;
+	diag->line = line;
+	return err;
+}
+
+int asm_pipe_construct(struct asm_pipe *this)
+{
+	int err;
+	void *buf;
+
+	memset(this, 0, sizeof(*this));
+
+	/* Only the pages read into are ever backed. */
+	buf = mmap(NULL, PIPE_MAX_INPUT, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (buf == MAP_FAILED)
+		return errno;
+	this->buf = buf;
+	this->max_size = PIPE_MAX_INPUT;
+
+	err = pipe_ring_construct(&this->rings[0]);
+	if (!err)
+		err = pipe_ring_construct(&this->rings[1]);
+	if (err) {
+		asm_pipe_destruct(this);
+		return err;
+	}
+	asm_base_construct(&this->as, this->buf, 0);
+	return 0;
+}
+
+void asm_pipe_destruct(struct asm_pipe *this)
+{
+	asm_base_destruct(&this->as);
+	pipe_ring_destruct(&this->rings[0]);
+	pipe_ring_destruct(&this->rings[1]);
+	free(this->held);
+	free(this->pcs);
+	munmap(this->buf, this->max_size);
+}
+
+/* Give back the pages of the text before pos that has been emitted. */
+static
+void asm_pipe_slide(struct asm_pipe *this, size_t pos)
+{
+	size_t lo;
+
+	lo = __atomic_load_n(&this->done, __ATOMIC_ACQUIRE);
+	if (lo > pos)
+		lo = pos;
+	lo &= ~(size_t)(PIPE_SLIDE_SIZE - 1);
+	if (lo <= this->released)
+		return;
+	madvise(&this->buf[this->released], lo - this->released,
+		MADV_DONTNEED);
+	this->released = lo;
+}
+
+/*
+ * Read the next piece of the input; pos and after are still needed. The lexer
+ * sees only through the last \n, until the end; a comment then cannot be cut
+ * short.
+ */
+static
+int asm_pipe_read(struct asm_pipe *this, size_t pos)
+{
+	size_t n, e;
+	ssize_t ret;
+
+	asm_pipe_slide(this, pos);
+
+	n = this->max_size - this->size;
+	if (n == 0)
+		return EFBIG;
+	if (n > PIPE_READ_SIZE)
+		n = PIPE_READ_SIZE;
+
+	do {
+		ret = read(this->fd, &this->buf[this->size], n);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0)
+		return errno;
+
+	if (ret == 0) {
+		this->eof = true;
+		this->as.buf_size = this->size;
+		return 0;
+	}
+
+	this->size += ret;
+	for (e = this->size; e > this->as.buf_size; --e) {
+		if (this->buf[e - 1] == '\n')
+			break;
+	}
+	this->as.buf_size = e;
+	return 0;
+}
+
+/*
+ * The 1-based line of pos, counted on from the previous call; the parser's
+ * positions only increase, and the text before them may be released.
+ */
+static
+int asm_pipe_get_line(struct asm_pipe *this, size_t pos)
+{
+	const char *p, *e;
+
+	e = &this->buf[pos];
+	for (p = &this->buf[this->line_pos]; (p = memchr(p, '\n', e - p)); ++p)
+		++this->line;
+	this->line_pos = pos;
+	return this->line;
+}
+
+/* Send the labels of the instruction, and then the instruction itself. */
+static
+int asm_pipe_send(struct asm_pipe *this, struct pipe_rec *rec)
+{
+	int i, id, err;
+	struct pipe_rec lrec;
+	struct asm_base *as;
+	const struct token *l;
+
+	as = &this->as;
+	memset(&lrec, 0, sizeof(lrec));
+	lrec.type = PIPE_REC_LABEL;
+	lrec.inst = rec->inst;
+	lrec.line = rec->line;
+	lrec.in.base.pc = rec->in.base.pc;
+
+	for (i = 0; i < rec->in.base.num_labels; ++i) {
+		l = &as->labels[rec->in.base.labels + i];
+		err = sym_tab_intern(&as->syms, l->s, l->len, &id);
+		if (!err)
+			err = sym_tab_define(&as->syms, id, rec->in.base.pc);
+		if (err)
+			return asm_pipe_fail(this, PIPE_PARSE, err, "labels",
+					     rec->inst, rec->s, rec->line);
+
+		lrec.label = id;
+		lrec.s = l->s;
+		lrec.e = l->s + l->len;
+		err = pipe_ring_push(this, &this->rings[0], &lrec);
+		if (err)
+			return err;
+	}
+	return pipe_ring_push(this, &this->rings[0], rec);
+}
+
+/*
+ * The first stage. An instruction cut short by the end of what has been read
+ * so far fails to lex, with pos at that end; it is lexed again, from its
+ * start, with more input. Any other failure is final at once.
+ */
+static
+int asm_pipe_parse(struct asm_pipe *this)
+{
+	int n, pc, err;
+	size_t pos, start;
+	struct pipe_rec rec;
+	struct inst_base *base;
+	struct asm_base *as;
+
+	as = &this->as;
+	base = &rec.in.base;
+	memset(&rec, 0, sizeof(rec));
+	rec.type = PIPE_REC_INST;
+
+	pc = n = 0;
+	for (pos = 0;;) {
+		if (__atomic_load_n(&this->stop, __ATOMIC_RELAXED))
+			return ECANCELED;
+
+		as->num_tokens = as->num_labels = 0;
+		inst_all_construct(&rec.in, as);
+
+		start = pos;
+		err = inst_base_lex(base, &pos);
+		if (!this->eof && pos == as->buf_size &&
+		    (err == EINVAL || (!err && base->num_tokens == 0))) {
+			if (err)
+				pos = start;
+			err = asm_pipe_read(this, pos);
+			if (err)
+				return asm_pipe_fail(this, PIPE_PARSE, err,
+						     "lex", n, pos,
+						     asm_pipe_get_line(this, pos));
+			continue;
+		}
+		if (err) {
+			pos = inst_base_get_pos(base, pos);
+			return asm_pipe_fail(this, PIPE_PARSE, err, "lex", n,
+					     pos, asm_pipe_get_line(this, pos));
+		}
+
+		/* Only whitespace or comments until the end. */
+		if (base->num_tokens == 0)
+			break;
+
+		rec.s = inst_base_get_pos(base, pos);
+		rec.e = as->tokens[base->tokens + base->num_tokens - 1].s + 1;
+		rec.inst = n;
+		rec.line = asm_pipe_get_line(this, rec.s);
+		err = inst_all_parse(&rec.in);
+		if (err)
+			return asm_pipe_fail(this, PIPE_PARSE, err, "parse", n,
+					     rec.s, rec.line);
+
+		base->pc = pc;
+		pc += base->num_words / 2;
+		err = asm_pipe_send(this, &rec);
+		if (err)
+			return err;
+		++n;
+	}
+	return 0;
+}
+
+static
+int asm_pipe_set_pc(struct asm_pipe *this, int id, int pc)
+{
+	int i, n, *t;
+
+	if (id >= this->max_pcs) {
+		n = this->max_pcs ? 2 * this->max_pcs : 256;
+		if (n <= id)
+			n = id + 1;
+		t = realloc(this->pcs, n * sizeof(*t));
+		if (t == NULL)
+			return ENOMEM;
+		for (i = this->max_pcs; i < n; ++i)
+			t[i] = -1;
+		this->pcs = t;
+		this->max_pcs = n;
+	}
+	this->pcs[id] = pc;
+	return 0;
+}
+
+/* Whether the record can pass the fence. */
+static
+bool asm_pipe_is_resolved(const struct asm_pipe *this,
+			  const struct pipe_rec *rec)
+{
+	if (rec->type != PIPE_REC_INST || rec->label < 0)
+		return true;
+	return rec->label < this->max_pcs && this->pcs[rec->label] >= 0;
+}
+
+/* With emit_unresolved, forget the held records whose labels are defined. */
+static
+void asm_pipe_forget(struct asm_pipe *this)
+{
+	int i, j;
+
+	for (i = j = 0; i < this->num_held; ++i) {
+		if (!asm_pipe_is_resolved(this, &this->held[i]))
+			this->held[j++] = this->held[i];
+	}
+	this->num_held = j;
+}
+
+static
+int asm_pipe_hold(struct asm_pipe *this, const struct pipe_rec *rec)
+{
+	int n;
+	bool grow;
+	struct pipe_rec *t;
+
+	/*
+	 * Move the held records to the front, or forget the resolved ones,
+	 * before growing. Grow anyway if at least half remain.
+	 */
+	grow = this->num_held == this->max_held;
+	if (grow && this->emit_unresolved) {
+		asm_pipe_forget(this);
+		grow = 2 * this->num_held >= this->max_held;
+	} else if (grow && this->head_held) {
+		this->num_held -= this->head_held;
+		memmove(this->held, &this->held[this->head_held],
+			this->num_held * sizeof(*t));
+		this->head_held = 0;
+		grow = false;
+	}
+
+	/* The fence; with emit_unresolved, the labels bound it. */
+	if (grow && !this->emit_unresolved &&
+	    this->num_held >= PIPE_MAX_HELD)
+		return ENOBUFS;
+
+	if (grow) {
+		n = this->max_held ? 2 * this->max_held : 64;
+		t = realloc(this->held, n * sizeof(*t));
+		if (t == NULL)
+			return ENOMEM;
+		this->held = t;
+		this->max_held = n;
+	}
+	this->held[this->num_held++] = *rec;
+	return 0;
+}
+
+/*
+ * Fill in the address of the label, if defined, and pass the record on to
+ * emit. The label of a record sent on without its address stays set.
+ */
+static
+int asm_pipe_release(struct asm_pipe *this, struct pipe_rec *rec)
+{
+	if (rec->type == PIPE_REC_INST && asm_pipe_is_resolved(this, rec) &&
+	    rec->label >= 0) {
+		inst_cf_patch_label_all(&rec->in, this->pcs[rec->label]);
+		rec->label = -1;
+	}
+	return pipe_ring_push(this, &this->rings[1], rec);
+}
+
+/* Release the held records, in order, up to the first still unresolved. */
+static
+int asm_pipe_drain(struct asm_pipe *this)
+{
+	int err;
+	struct pipe_rec *rec;
+
+	for (; this->head_held < this->num_held; ++this->head_held) {
+		rec = &this->held[this->head_held];
+		if (!asm_pipe_is_resolved(this, rec))
+			break;
+		err = asm_pipe_release(this, rec);
+		if (err)
+			return err;
+	}
+	if (this->head_held == this->num_held)
+		this->head_held = this->num_held = 0;
+	return 0;
+}
+
+/*
+ * Encode with the address 0; the address is filled in on release. Mirror
+ * inst_all_fix_labels for what is rejected.
+ */
+static
+int asm_pipe_encode_inst(struct asm_pipe *this, struct pipe_rec *rec)
+{
+	int err;
+	struct inst_base *base;
+
+	base = &rec->in.base;
+	rec->label = -1;
+	if (base->type >= IT_CF && base->type <= IT_CF_AIE_SWIZ) {
+		if (base->type == IT_CF_ALU_EXT)
+			return asm_pipe_fail(this, PIPE_ENCODE, EINVAL,
+					     "labels", rec->inst, rec->s,
+					     rec->line);
+		rec->label = inst_cf_get_label_all(&rec->in);
+	}
+
+	err = inst_all_encode(&rec->in);
+	if (err)
+		return asm_pipe_fail(this, PIPE_ENCODE, err, "encode",
+				     rec->inst, rec->s, rec->line);
+	return 0;
+}
+
+/* The second stage. */
+static
+int asm_pipe_encode(struct asm_pipe *this)
+{
+	int err;
+	struct pipe_rec rec;
+
+	for (;;) {
+		err = pipe_ring_pop(this, &this->rings[0], &rec);
+		if (err)
+			return err;
+		if (rec.type == PIPE_REC_END)
+			break;
+
+		if (rec.type == PIPE_REC_LABEL)
+			err = asm_pipe_set_pc(this, rec.label, rec.in.base.pc);
+		else
+			err = asm_pipe_encode_inst(this, &rec);
+		if (err)
+			return err;
+
+		/* Nothing passes a held record. */
+		if (this->emit_unresolved) {
+			err = asm_pipe_release(this, &rec);
+			if (!err && !asm_pipe_is_resolved(this, &rec))
+				err = asm_pipe_hold(this, &rec);
+		} else if (this->head_held < this->num_held ||
+			   !asm_pipe_is_resolved(this, &rec)) {
+			err = asm_pipe_hold(this, &rec);
+		} else {
+			err = asm_pipe_release(this, &rec);
+		}
+		if (!err && rec.type == PIPE_REC_LABEL &&
+		    !this->emit_unresolved)
+			err = asm_pipe_drain(this);
+		if (err == ENOBUFS)
+			return asm_pipe_fail(this, PIPE_ENCODE, err,
+					     "fence full",
+					     this->held[this->head_held].inst,
+					     this->held[this->head_held].s,
+					     this->held[this->head_held].line);
+		if (err)
+			return asm_pipe_fail(this, PIPE_ENCODE, err, "encode",
+					     rec.inst, rec.s, rec.line);
+	}
+
+	/* An undefined label. */
+	if (this->emit_unresolved)
+		asm_pipe_forget(this);
+	if (this->head_held < this->num_held)
+		return asm_pipe_fail(this, PIPE_ENCODE, EINVAL, "labels",
+				     this->held[this->head_held].inst,
+				     this->held[this->head_held].s,
+				     this->held[this->head_held].line);
+	return 0;
+}
+
+static
+void *asm_pipe_encode_run(void *arg)
+{
+	int err;
+	struct asm_pipe *this;
+	struct pipe_rec rec;
+
+	this = arg;
+	err = asm_pipe_encode(this);
+
+	memset(&rec, 0, sizeof(rec));
+	rec.type = PIPE_REC_END;
+	pipe_ring_push(this, &this->rings[1], &rec);
+	if (err)
+		asm_pipe_stop(this);
+	return NULL;
+}
+
+/* The third stage. */
+static
+void *asm_pipe_emit_run(void *arg)
+{
+	int err;
+	struct asm_pipe *this;
+	struct pipe_rec rec;
+
+	this = arg;
+	for (;;) {
+		err = pipe_ring_pop(this, &this->rings[1], &rec);
+		if (err || rec.type == PIPE_REC_END)
+			break;
+
+		err = this->emit(this->arg, this->buf, &rec);
+		if (err) {
+			asm_pipe_fail(this, PIPE_EMIT, err, "emit", rec.inst,
+				      rec.s, rec.line);
+			asm_pipe_stop(this);
+			break;
+		}
+		__atomic_store_n(&this->done, rec.e, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+static
+void asm_pipe_reset(struct asm_pipe *this, int fd, asm_pipe_emit_fn emit,
+		    void *arg)
+{
+	int i;
+
+	asm_base_reset(&this->as, this->buf, 0);
+	this->as.syms.copy_names = true;
+	madvise(this->buf, this->size, MADV_DONTNEED);
+	this->size = this->released = this->done = 0;
+	this->line = 1;
+	this->line_pos = 0;
+	this->fd = fd;
+	this->eof = false;
+	for (i = 0; i < 2; ++i)
+		this->rings[i].head = this->rings[i].tail = 0;
+	this->head_held = this->num_held = 0;
+	for (i = 0; i < this->max_pcs; ++i)
+		this->pcs[i] = -1;
+	this->emit = emit;
+	this->arg = arg;
+	memset(this->diags, 0, sizeof(this->diags));
+	this->stop = 0;
+}
+
+/*
+ * Read fd until its end, and emit the records in source order. Whatever was
+ * emitted before a failure stays emitted; the failure of the earliest stage
+ * is reported.
+ */
+int asm_pipe_assemble(struct asm_pipe *this, int fd, asm_pipe_emit_fn emit,
+		      void *arg, struct egasm_diag *diag)
+{
+	int i, err;
+	struct pipe_rec rec;
+	const struct egasm_diag *d;
+
+	asm_pipe_reset(this, fd, emit, arg);
+	if (diag)
+		memset(diag, 0, sizeof(*diag));
+
+	err = pthread_create(&this->threads[0], NULL, asm_pipe_encode_run,
+			     this);
+	if (err)
+		return err;
+	err = pthread_create(&this->threads[1], NULL, asm_pipe_emit_run, this);
+	if (err) {
+		asm_pipe_stop(this);
+		pthread_join(this->threads[0], NULL);
+		return err;
+	}
+
+	/* Once stopped, the encoder must not take the input to have ended. */
+	err = asm_pipe_parse(this);
+	if (err != ECANCELED) {
+		memset(&rec, 0, sizeof(rec));
+		rec.type = PIPE_REC_END;
+		pipe_ring_push(this, &this->rings[0], &rec);
+	}
+
+	pthread_join(this->threads[0], NULL);
+	pthread_join(this->threads[1], NULL);
+
+	for (i = PIPE_PARSE; i <= PIPE_EMIT; ++i) {
+		d = &this->diags[i];
+		if (d->err == 0)
+			continue;
+		if (diag)
+			*diag = *d;
+		return d->err;
+	}
+	return 0;
+}
@@ -0,0 +1,430 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef SASM_H
+#define SASM_H
+
+#include <stdint.h>
+
+#include "bits.h"
+#include "cf.h"
+#include "vtx.h"
+#include "alu.h"
+#include "tex.h"
+
+/*
+ * Assembly at compile time. Each instruction of the syntax has a builder
+ * macro, with the operands in the same order, that expands to its words,
+ * host-order as egasm_assemble returns them:
+ *
+ *	static const uint32_t fetch[] = {
+ *		sasm_c_vc(1, 2, 0),
+ *		sasm_c_ret(0),
+ *		sasm_v_reg(1, FMT_32_32_32_FLOAT, NUM_FORMAT_SCALED, 0, 0,
+ *			   sasm_swz('x', 'y', 'z', '1'), 0, 'x', 0),
+ *	};
+ *
+ * The words are constant expressions; the compiler stops at a value that does
+ * not fit its field, and at a flag the instruction does not take. Addresses
+ * are in units of 64 bits, as those of labels; a TEX or a VTX takes two.
+ */
+
+/*
+ * 0, if the constant expression c holds; else, the compiler stops with msg.
+ * It is itself a constant expression.
+ */
+#define sasm_check(c, msg)						\
+	(0 * sizeof(struct { _Static_assert(c, msg); char sasm_c; }))
+
+/* Whether v fits in the field f; as sasm_check. */
+#define sasm_fits(f, v)							\
+	sasm_check((unsigned long long)(v) <= bits_mask(f),		\
+		   #f " out of range")
+
+#define sasm_field(f, v)		(bits_set(f, v) | sasm_fits(f, v))
+#define sasm_word(v)			((uint32_t)(v))
+
+/**** Operands ****/
+/* The SEL_* of a swizzle character, as the syntax has it; 8 if none. */
+#define sasm_sel(c)							\
+	((c) == 'x' ? 0 : (c) == 'y' ? 1 : (c) == 'z' ? 2 :		\
+	 (c) == 'w' ? 3 : (c) == '0' ? 4 : (c) == '1' ? 5 :		\
+	 (c) == '_' ? 7 : 8)
+
+#define SASM_SWZ_FIELDS(X, a)						\
+	X(a, SASM_SWZ, SEL_X, sel_x, 0, 3)				\
+	X(a, SASM_SWZ, SEL_Y, sel_y, 3, 3)				\
+	X(a, SASM_SWZ, SEL_Z, sel_z, 6, 3)				\
+	X(a, SASM_SWZ, SEL_W, sel_w, 9, 3)
+enum { SASM_SWZ_FIELDS(ISA_CONSTS, ) };
+
+/* .xyzw, as four characters. */
+#define sasm_swz(x, y, z, w)						\
+	(sasm_field(SASM_SWZ_SEL_X, sasm_sel(x)) |			\
+	 sasm_field(SASM_SWZ_SEL_Y, sasm_sel(y)) |			\
+	 sasm_field(SASM_SWZ_SEL_Z, sasm_sel(z)) |			\
+	 sasm_field(SASM_SWZ_SEL_W, sasm_sel(w)))
+
+/* The sels of a swizzle, into the fields fx, fy, fz and fw of a word. */
+#define sasm_put_swz(swz, fx, fy, fz, fw)				\
+	(bits_set(fx, bits_get(swz, SASM_SWZ_SEL_X)) |			\
+	 bits_set(fy, bits_get(swz, SASM_SWZ_SEL_Y)) |			\
+	 bits_set(fz, bits_get(swz, SASM_SWZ_SEL_Z)) |			\
+	 bits_set(fw, bits_get(swz, SASM_SWZ_SEL_W)))
+
+#define SASM_SRC_FIELDS(X, a)						\
+	X(a, SASM_SRC, SEL, sel, 0, 9)					\
+	X(a, SASM_SRC, CHAN, chan, 9, 2)				\
+	X(a, SASM_SRC, NEG, neg, 11, 1)					\
+	X(a, SASM_SRC, ABS, abs, 12, 1)
+enum { SASM_SRC_FIELDS(ISA_CONSTS, ) };
+
+/* An ALU src, as inst_alu_parse_src takes it. */
+#define sasm_src(sel, c, ok, msg)					\
+	(sasm_field(SASM_SRC_SEL, sel) |				\
+	 sasm_field(SASM_SRC_CHAN, sasm_sel(c)) | sasm_check(ok, msg))
+#define sasm_src_r(n, c)						\
+	sasm_src(ALU_SRC_GPR_BASE + (n), c, (unsigned int)(n) < 128,	\
+		 "r0 to r127")
+#define sasm_src_p(n, c)						\
+	sasm_src(ALU_SRC_PARAM_BASE + (n), c, (unsigned int)(n) < 64,	\
+		 "p0 to p63")
+#define sasm_src_k(k, n, c)						\
+	sasm_src(((k) == 0 ? 159 : (k) == 1 ? 191 : (k) == 2 ? 287 : 319) + \
+		 (n), c, (unsigned int)(k) < 4 && (unsigned int)(n) < 32, \
+		 "k0[0] to k3[31]")
+#define sasm_neg(src)			((src) | bits_on(SASM_SRC_NEG))
+#define sasm_abs(src)			((src) | bits_on(SASM_SRC_ABS))
+
+#define SASM_DST_FIELDS(X, a)						\
+	X(a, SASM_DST, GPR, gpr, 0, 7)					\
+	X(a, SASM_DST, CHAN, chan, 7, 2)				\
+	X(a, SASM_DST, WRITE, write_enable, 9, 1)			\
+	X(a, SASM_DST, OMOD, omod, 10, 2)
+enum { SASM_DST_FIELDS(ISA_CONSTS, ) };
+
+/* rN.c, or -.c; with an ALU_OMOD_*, if any. */
+#define sasm_dst(n, c)							\
+	(sasm_field(SASM_DST_GPR, n) |					\
+	 sasm_field(SASM_DST_CHAN, sasm_sel(c)) | bits_on(SASM_DST_WRITE))
+#define sasm_dst_none(c)		sasm_field(SASM_DST_CHAN, sasm_sel(c))
+#define sasm_omod(dst, omod)						\
+	((dst) | sasm_field(SASM_DST_OMOD, omod))
+
+#define SASM_KC_FIELDS(X, a)						\
+	X(a, SASM_KC, BANK, bank, 0, 4)					\
+	X(a, SASM_KC, ADDR, addr, 4, 8)					\
+	X(a, SASM_KC, MODE, mode, 12, 2)
+enum { SASM_KC_FIELDS(ISA_CONSTS, ) };
+
+/* kc#(bank[addr],mode), with a CF_KCACHE_MODE_*; 0 if none. */
+#define sasm_kc(bank, addr, mode)					\
+	(sasm_field(SASM_KC_BANK, bank) | sasm_field(SASM_KC_ADDR, addr) | \
+	 sasm_field(SASM_KC_MODE, mode))
+
+#define SASM_NUM_FIELDS(X, a)						\
+	X(a, SASM_NUM, FORMAT, format, 0, 2)				\
+	X(a, SASM_NUM, COMP, comp, 2, 1)
+enum { SASM_NUM_FIELDS(ISA_CONSTS, ) };
+
+/* -n, -i or -s, of a NUM_FORMAT_*. */
+#define sasm_signed(num)		((num) | bits_on(SASM_NUM_COMP))
+
+/**** Flags ****/
+/* As the keywords; an instruction takes those the syntax gives it. */
+#define SASM_EOP			(1ull << 0)
+#define SASM_VPM			(1ull << 1)
+#define SASM_WQM			(1ull << 2)
+#define SASM_B				(1ull << 3)
+#define SASM_ALT			(1ull << 4)
+#define SASM_REL			(1ull << 5)
+#define SASM_M				(1ull << 6)
+#define SASM_LAST			(1ull << 7)
+#define SASM_PS0			(1ull << 8)
+#define SASM_PS1			(1ull << 9)
+#define SASM_IML			(1ull << 10)
+#define SASM_IMG			(1ull << 11)
+#define SASM_IMGA			(1ull << 12)
+#define SASM_UEM			(1ull << 13)
+#define SASM_UP				(1ull << 14)
+#define SASM_021			(1ull << 15)
+#define SASM_120			(1ull << 16)
+#define SASM_102			(1ull << 17)
+#define SASM_201			(1ull << 18)
+#define SASM_210			(1ull << 19)
+#define SASM_SREL			(1ull << 20)
+#define SASM_DREL			(1ull << 21)
+#define SASM_FWQ			(1ull << 22)
+#define SASM_RIM0			(1ull << 23)
+#define SASM_RIM1			(1ull << 24)
+#define SASM_SIM0			(1ull << 25)
+#define SASM_SIM1			(1ull << 26)
+#define SASM_XN				(1ull << 27)
+#define SASM_YN				(1ull << 28)
+#define SASM_ZN				(1ull << 29)
+#define SASM_WN				(1ull << 30)
+#define SASM_CBNS			(1ull << 31)
+#define SASM_MF				(1ull << 32)
+#define SASM_UCF			(1ull << 33)
+#define SASM_SMA			(1ull << 34)
+#define SASM_CC_F			(1ull << 35)
+#define SASM_CC_B			(1ull << 36)
+#define SASM_CC_NB			(1ull << 37)
+#define SASM_122			(1ull << 38)	/* Trans slot */
+#define SASM_212			(1ull << 39)
+#define SASM_221			(1ull << 40)
+
+/* The const of cc.b(n) and cc.nb(n). */
+#define SASM_FLAGS_FIELDS(X, a)						\
+	X(a, SASM_FLAGS, CONST, cf_const, 48, 5)
+enum { SASM_FLAGS_FIELDS(ISA_CONSTS, ) };
+
+#define sasm_cc_b(n)							\
+	(SASM_CC_B | sasm_field(SASM_FLAGS_CONST, n))
+#define sasm_cc_nb(n)							\
+	(SASM_CC_NB | sasm_field(SASM_FLAGS_CONST, n))
+
+#define SASM_CF_FLAGS							\
+	(SASM_EOP | SASM_VPM | SASM_WQM | SASM_B | SASM_CC_F | SASM_CC_B | \
+	 SASM_CC_NB | bits_on(SASM_FLAGS_CONST))
+#define SASM_CF_ALU_FLAGS		(SASM_ALT | SASM_WQM | SASM_B)
+#define SASM_CF_AIE_FLAGS						\
+	(SASM_EOP | SASM_VPM | SASM_REL | SASM_M | SASM_B)
+#define SASM_ALU_FLAGS							\
+	(SASM_LAST | SASM_PS0 | SASM_PS1 | SASM_IML | SASM_IMG |	\
+	 SASM_IMGA | SASM_UEM | SASM_UP | SASM_021 | SASM_120 |	\
+	 SASM_102 | SASM_201 | SASM_210 | SASM_122 | SASM_212 |	\
+	 SASM_221)
+#define SASM_TEX_FLAGS							\
+	(SASM_ALT | SASM_SREL | SASM_DREL | SASM_FWQ | SASM_RIM0 |	\
+	 SASM_RIM1 | SASM_SIM0 | SASM_SIM1 | SASM_XN | SASM_YN |	\
+	 SASM_ZN | SASM_WN)
+#define SASM_VTX_SEM_FLAGS						\
+	(SASM_ALT | SASM_CBNS | SASM_MF | SASM_UCF | SASM_SMA |	\
+	 SASM_FWQ | SASM_SREL)
+#define SASM_VTX_GPR_FLAGS		(SASM_VTX_SEM_FLAGS | SASM_DREL)
+
+/* flags takes none but those of mask. */
+#define sasm_only(flags, mask)						\
+	sasm_check(((flags) & ~(mask)) == 0,				\
+		   "a flag the instruction does not take")
+
+/* flag, as 1 or 0 in the field f. */
+#define sasm_flag(flags, flag, f)					\
+	bits_set(f, ((flags) & (flag)) != 0)
+
+/* Of the flags of mask, at most one is in flags. */
+#define sasm_one_of(flags, mask)					\
+	sasm_check((((flags) & (mask)) & (((flags) & (mask)) - 1)) == 0, \
+		   "flags that exclude each other")
+
+/* The value that the one of the flags a, b, ... has; 0 if none. */
+#define sasm_pick2(flags, a, va, b, vb)					\
+	((((flags) & (a)) ? (va) : ((flags) & (b)) ? (vb) : 0) |	\
+	 sasm_one_of(flags, (a) | (b)))
+#define sasm_pick3(flags, a, va, b, vb, c, vc)				\
+	((((flags) & (a)) ? (va) : ((flags) & (b)) ? (vb) :		\
+	  ((flags) & (c)) ? (vc) : 0) | sasm_one_of(flags, (a) | (b) | (c)))
+
+/**** CF ****/
+#define sasm_cf(inst, count, addr, flags)				\
+	sasm_word(sasm_field(CF_WORD0_ADDR, addr)),			\
+	sasm_word(sasm_field(CF_WORD1_COUNT, (count) - 1) |		\
+		  bits_set(CF_WORD1_COND,				\
+			   sasm_pick3(flags, SASM_CC_F, CF_COND_FALSE,	\
+				      SASM_CC_B, CF_COND_BOOL,		\
+				      SASM_CC_NB, CF_COND_NOT_BOOL)) |	\
+		  bits_set(CF_WORD1_CONST,				\
+			   bits_get((unsigned long long)(flags),	\
+				    SASM_FLAGS_CONST)) |		\
+		  bits_set(CF_WORD1_INST, inst) |			\
+		  sasm_flag(flags, SASM_EOP, CF_WORD1_END_OF_PROGRAM) |	\
+		  sasm_flag(flags, SASM_VPM, CF_WORD1_VALID_PIXEL_MODE) | \
+		  sasm_flag(flags, SASM_WQM, CF_WORD1_WHOLE_QUAD_MODE) | \
+		  sasm_flag(flags, SASM_B, CF_WORD1_BARRIER) |		\
+		  sasm_only(flags, SASM_CF_FLAGS))
+
+#define sasm_c_nop(flags)		sasm_cf(CF_INST_NOP, 1, 0, flags)
+#define sasm_c_ret(flags)		sasm_cf(CF_INST_RETURN, 1, 0, flags)
+#define sasm_c_fs(addr, flags)		sasm_cf(CF_INST_CALL_FS, 1, addr, flags)
+#define sasm_c_tc(n, addr, flags)	sasm_cf(CF_INST_TC, n, addr, flags)
+#define sasm_c_vc(n, addr, flags)	sasm_cf(CF_INST_VC, n, addr, flags)
+
+/* c.alu(n) kc0(...) kc1(...) L; kc0 and kc1 of sasm_kc. */
+#define sasm_c_alu(n, kc0, kc1, addr, flags)				\
+	sasm_word(sasm_field(CF_ALU_WORD0_ADDR, addr) |			\
+		  bits_set(CF_ALU_WORD0_KCACHE_BANK0,			\
+			   bits_get(kc0, SASM_KC_BANK)) |		\
+		  bits_set(CF_ALU_WORD0_KCACHE_BANK1,			\
+			   bits_get(kc1, SASM_KC_BANK)) |		\
+		  bits_set(CF_ALU_WORD0_KCACHE_MODE0,			\
+			   bits_get(kc0, SASM_KC_MODE))),		\
+	sasm_word(bits_set(CF_ALU_WORD1_KCACHE_MODE1,			\
+			   bits_get(kc1, SASM_KC_MODE)) |		\
+		  bits_set(CF_ALU_WORD1_KCACHE_ADDR0,			\
+			   bits_get(kc0, SASM_KC_ADDR)) |		\
+		  bits_set(CF_ALU_WORD1_KCACHE_ADDR1,			\
+			   bits_get(kc1, SASM_KC_ADDR)) |		\
+		  sasm_field(CF_ALU_WORD1_COUNT, (n) - 1) |		\
+		  sasm_flag(flags, SASM_ALT, CF_ALU_WORD1_ALT_CONST) |	\
+		  bits_set(CF_ALU_WORD1_INST, CF_INST_ALU) |		\
+		  sasm_flag(flags, SASM_WQM, CF_ALU_WORD1_WHOLE_QUAD_MODE) | \
+		  sasm_flag(flags, SASM_B, CF_ALU_WORD1_BARRIER) |	\
+		  sasm_only(flags, SASM_CF_ALU_FLAGS))
+
+/*
+ * c.xd.type(n) [base + rI * size], rG.swz; with an EXPORT_TYPE_*. Without an
+ * index, ix is 0 and size is 1.
+ */
+#define sasm_c_xd(type, n, base, ix, size, gpr, swz, flags)		\
+	sasm_word(sasm_field(CF_AIE_WORD0_ARRAY_BASE, base) |		\
+		  sasm_field(CF_AIE_WORD0_TYPE, type) |			\
+		  sasm_field(CF_AIE_WORD0_RW_GPR, gpr) |		\
+		  sasm_flag(flags, SASM_REL, CF_AIE_WORD0_RW_REL) |	\
+		  sasm_field(CF_AIE_WORD0_INDEX_GPR, ix) |		\
+		  sasm_field(CF_AIE_WORD0_ELEM_SIZE, (size) - 1)),	\
+	sasm_word(sasm_put_swz(swz, CF_AIE_WORD1_SWIZ_SEL_X,		\
+			       CF_AIE_WORD1_SWIZ_SEL_Y,			\
+			       CF_AIE_WORD1_SWIZ_SEL_Z,			\
+			       CF_AIE_WORD1_SWIZ_SEL_W) |		\
+		  sasm_field(CF_AIE_WORD1_BURST_COUNT, (n) - 1) |	\
+		  sasm_flag(flags, SASM_VPM, CF_AIE_WORD1_VALID_PIXEL_MODE) | \
+		  sasm_flag(flags, SASM_EOP, CF_AIE_WORD1_END_OF_PROGRAM) | \
+		  bits_set(CF_AIE_WORD1_INST, CF_INST_EXPORT_DONE) |	\
+		  sasm_flag(flags, SASM_M, CF_AIE_WORD1_MARK) |		\
+		  sasm_flag(flags, SASM_B, CF_AIE_WORD1_BARRIER) |	\
+		  sasm_only(flags, SASM_CF_AIE_FLAGS))
+
+/**** ALU ****/
+/* a.op dst, src0, src1; of sasm_dst and sasm_src_*. */
+#define sasm_a_op2(inst, dst, src0, src1, flags)			\
+	sasm_word(bits_set(ALU_WORD0_SRC0_SEL,				\
+			   bits_get(src0, SASM_SRC_SEL)) |		\
+		  bits_set(ALU_WORD0_SRC0_CHAN,				\
+			   bits_get(src0, SASM_SRC_CHAN)) |		\
+		  bits_set(ALU_WORD0_SRC0_NEG,				\
+			   bits_get(src0, SASM_SRC_NEG)) |		\
+		  bits_set(ALU_WORD0_SRC1_SEL,				\
+			   bits_get(src1, SASM_SRC_SEL)) |		\
+		  bits_set(ALU_WORD0_SRC1_CHAN,				\
+			   bits_get(src1, SASM_SRC_CHAN)) |		\
+		  bits_set(ALU_WORD0_SRC1_NEG,				\
+			   bits_get(src1, SASM_SRC_NEG)) |		\
+		  bits_set(ALU_WORD0_INDEX_MODE,			\
+			   sasm_pick3(flags, SASM_IML, INDEX_LOOP,	\
+				      SASM_IMG, INDEX_GLOBAL,		\
+				      SASM_IMGA, INDEX_GLOBAL_AR_X)) |	\
+		  bits_set(ALU_WORD0_PRED_SEL,				\
+			   sasm_pick2(flags, SASM_PS0, PRED_SEL_0,	\
+				      SASM_PS1, PRED_SEL_1)) |		\
+		  sasm_flag(flags, SASM_LAST, ALU_WORD0_LAST)),		\
+	sasm_word(bits_set(ALU_WORD1_OP2_SRC0_ABS,			\
+			   bits_get(src0, SASM_SRC_ABS)) |		\
+		  bits_set(ALU_WORD1_OP2_SRC1_ABS,			\
+			   bits_get(src1, SASM_SRC_ABS)) |		\
+		  sasm_flag(flags, SASM_UEM, ALU_WORD1_OP2_UPDATE_EXEC_MASK) | \
+		  sasm_flag(flags, SASM_UP, ALU_WORD1_OP2_UPDATE_PRED) | \
+		  bits_set(ALU_WORD1_OP2_WRITE_ENABLE,			\
+			   bits_get(dst, SASM_DST_WRITE)) |		\
+		  bits_set(ALU_WORD1_OP2_OUT_MOD,			\
+			   bits_get(dst, SASM_DST_OMOD)) |		\
+		  sasm_field(ALU_WORD1_INST, inst) |			\
+		  bits_set(ALU_WORD1_BANK_SWIZZLE,			\
+			   sasm_pick3(flags, SASM_021, 1, SASM_120, 2,	\
+				      SASM_102, 3) |			\
+			   sasm_pick2(flags, SASM_201, 4, SASM_210, 5) | \
+			   sasm_pick3(flags, SASM_122, 1, SASM_212, 2,	\
+				      SASM_221, 3) |			\
+			   sasm_one_of(flags, SASM_021 | SASM_120 |	\
+				       SASM_102 | SASM_201 | SASM_210 | \
+				       SASM_122 | SASM_212 | SASM_221)) | \
+		  bits_set(ALU_WORD1_DST_GPR,				\
+			   bits_get(dst, SASM_DST_GPR)) |		\
+		  bits_set(ALU_WORD1_DST_CHAN,				\
+			   bits_get(dst, SASM_DST_CHAN)) |		\
+		  sasm_only(flags, SASM_ALU_FLAGS))
+
+#define sasm_a_ixy(dst, src0, src1, flags)				\
+	sasm_a_op2(ALU_INST_INTERP_XY, dst, src0, src1, flags)
+#define sasm_a_iz(dst, src0, src1, flags)				\
+	sasm_a_op2(ALU_INST_INTERP_Z, dst, src0, src1, flags)
+
+/**** TEX ****/
+/* t.samp rD.swz, ps[sampler][rsrc][rA.swz] + [x, y, z, bias] */
+#define sasm_t_samp(dst, dswz, sampler, rsrc, src, sswz, x, y, z, bias,	\
+		    flags)						\
+	sasm_word(bits_set(TEX_WORD0_INST, TC_INST_SAMPLE) |		\
+		  sasm_flag(flags, SASM_FWQ, TEX_WORD0_FETCH_WHOLE_QUAD) | \
+		  sasm_field(TEX_WORD0_RSRC_ID, rsrc) |			\
+		  sasm_field(TEX_WORD0_SRC_GPR, src) |			\
+		  sasm_flag(flags, SASM_SREL, TEX_WORD0_SRC_REL) |	\
+		  sasm_flag(flags, SASM_ALT, TEX_WORD0_ALT_CONST) |	\
+		  bits_set(TEX_WORD0_RSRC_INDEX_MODE,			\
+			   sasm_pick2(flags, SASM_RIM0, 1, SASM_RIM1, 2)) | \
+		  bits_set(TEX_WORD0_SAMPLER_INDEX_MODE,		\
+			   sasm_pick2(flags, SASM_SIM0, 1, SASM_SIM1, 2))), \
+	sasm_word(sasm_field(TEX_WORD1_DST_GPR, dst) |			\
+		  sasm_flag(flags, SASM_DREL, TEX_WORD1_DST_REL) |	\
+		  sasm_put_swz(dswz, TEX_WORD1_DST_SEL_X,		\
+			       TEX_WORD1_DST_SEL_Y, TEX_WORD1_DST_SEL_Z, \
+			       TEX_WORD1_DST_SEL_W) |			\
+		  sasm_field(TEX_WORD1_LOD_BIAS, bias) |		\
+		  sasm_flag(flags, SASM_XN, TEX_WORD1_COORD_TYPE_X) |	\
+		  sasm_flag(flags, SASM_YN, TEX_WORD1_COORD_TYPE_Y) |	\
+		  sasm_flag(flags, SASM_ZN, TEX_WORD1_COORD_TYPE_Z) |	\
+		  sasm_flag(flags, SASM_WN, TEX_WORD1_COORD_TYPE_W)),	\
+	sasm_word(sasm_field(TEX_WORD2_OFFSET_X, x) |			\
+		  sasm_field(TEX_WORD2_OFFSET_Y, y) |			\
+		  sasm_field(TEX_WORD2_OFFSET_Z, z) |			\
+		  sasm_field(TEX_WORD2_SAMPLER_ID, sampler) |		\
+		  sasm_put_swz(sswz, TEX_WORD2_SRC_SEL_X,		\
+			       TEX_WORD2_SRC_SEL_Y, TEX_WORD2_SRC_SEL_Z, \
+			       TEX_WORD2_SRC_SEL_W) |			\
+		  sasm_only(flags, SASM_TEX_FLAGS)),			\
+	0
+
+/**** VTX ****/
+/* The words of a VTX, but the fields of VTX_WORD1_GPR or _SEM, in w1. */
+#define sasm_vtx(inst, w1, fmt, num, buf, off, dswz, src, c, flags)	\
+	sasm_word(bits_set(VTX_WORD0_INST, inst) |			\
+		  sasm_flag(flags, SASM_FWQ, VTX_WORD0_FETCH_WHOLE_QUAD) | \
+		  sasm_field(VTX_WORD0_BUF_ID, buf) |			\
+		  sasm_field(VTX_WORD0_SRC_GPR, src) |			\
+		  sasm_flag(flags, SASM_SREL, VTX_WORD0_SRC_REL) |	\
+		  sasm_field(VTX_WORD0_SRC_SEL_X, sasm_sel(c))),	\
+	sasm_word((w1) |						\
+		  sasm_put_swz(dswz, VTX_WORD1_DST_SEL_X,		\
+			       VTX_WORD1_DST_SEL_Y, VTX_WORD1_DST_SEL_Z, \
+			       VTX_WORD1_DST_SEL_W) |			\
+		  sasm_flag(flags, SASM_UCF, VTX_WORD1_USE_CONST_FIELDS) | \
+		  sasm_field(VTX_WORD1_DATA_FORMAT, fmt) |		\
+		  bits_set(VTX_WORD1_NUM_FORMAT_ALL,			\
+			   bits_get(num, SASM_NUM_FORMAT)) |		\
+		  bits_set(VTX_WORD1_FORMAT_COMP_ALL,			\
+			   bits_get(num, SASM_NUM_COMP)) |		\
+		  sasm_check((unsigned int)(num) <=			\
+			     (bits_on(SASM_NUM_COMP) | NUM_FORMAT_SCALED), \
+			     "num out of range") |			\
+		  sasm_flag(flags, SASM_SMA, VTX_WORD1_SRF_MODE_ALL)),	\
+	sasm_word(sasm_field(VTX_WORD2_OFFSET, off) |			\
+		  sasm_flag(flags, SASM_CBNS, VTX_WORD2_CONST_BUF_NO_STRIDE) | \
+		  sasm_flag(flags, SASM_MF, VTX_WORD2_MEGA_FETCH) |	\
+		  sasm_flag(flags, SASM_ALT, VTX_WORD2_ALT_CONST)),	\
+	0
+
+/*
+ * v.reg rD, fmt, num, fs[buf][off].swz, rA.c; with an FMT_*, and a
+ * NUM_FORMAT_*, of sasm_signed if -.
+ */
+#define sasm_v_reg(dst, fmt, num, buf, off, dswz, src, c, flags)	\
+	sasm_vtx(VC_INST_FETCH,						\
+		 sasm_field(VTX_WORD1_GPR_DST_GPR, dst) |		\
+		 sasm_flag(flags, SASM_DREL, VTX_WORD1_GPR_DST_REL) |	\
+		 sasm_only(flags, SASM_VTX_GPR_FLAGS),			\
+		 fmt, num, buf, off, dswz, src, c, flags)
+#define sasm_v_sem(id, fmt, num, buf, off, dswz, src, c, flags)	\
+	sasm_vtx(VC_INST_SEMANTIC,					\
+		 sasm_field(VTX_WORD1_SEM_ID, id) |			\
+		 sasm_only(flags, SASM_VTX_SEM_FLAGS),			\
+		 fmt, num, buf, off, dswz, src, c, flags)
+#endif
@@ -0,0 +1,275 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/* SSE2 is part of x86-64; AVX2 is detected at runtime. */
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+#include "scan.h"
+
+const unsigned char scan_class[256] = {
+	['\t'] = SCAN_SPACE, ['\n'] = SCAN_SPACE, ['\v'] = SCAN_SPACE,
+	['\f'] = SCAN_SPACE, ['\r'] = SCAN_SPACE, [' '] = SCAN_SPACE,
+
+	['.'] = SCAN_DELIM, [','] = SCAN_DELIM, [';'] = SCAN_DELIM,
+	['('] = SCAN_DELIM, [')'] = SCAN_DELIM, ['['] = SCAN_DELIM,
+	[']'] = SCAN_DELIM, ['-'] = SCAN_DELIM, ['+'] = SCAN_DELIM,
+	['/'] = SCAN_DELIM, ['*'] = SCAN_DELIM, ['$'] = SCAN_DELIM,
+
+	[':'] = SCAN_COLON,
+};
+
+/**** Scalar ****/
+static
+size_t scan_space_end_scalar(const char *buf, size_t i, size_t e)
+{
+	for (; i < e; ++i) {
+		if (!scan_is(buf[i], SCAN_SPACE))
+			break;
+	}
+	return i;
+}
+
+static
+size_t scan_token_end_scalar(const char *buf, size_t i, size_t e)
+{
+	for (; i < e; ++i) {
+		if (scan_is(buf[i], SCAN_STOP))
+			break;
+	}
+	return i;
+}
+
+static
+size_t scan_line_end_scalar(const char *buf, size_t i, size_t e)
+{
+	for (; i < e; ++i) {
+		if (buf[i] == '\n')
+			break;
+	}
+	return i;
+}
+
+static const struct scan_ops scan_scalar_ops = {
+	.space_end	= scan_space_end_scalar,
+	.token_end	= scan_token_end_scalar,
+	.line_end	= scan_line_end_scalar,
+};
+
+#ifdef SCAN_X86
+/**** SSE2, 16 bytes per step ****/
+
+/* Bit n is set if byte n of v is within [lo, hi]. */
+static inline
+unsigned int scan_range_sse2(__m128i v, char lo, char hi)
+{
+	__m128i t;
+
+	t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+	t = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(hi - lo)), t);
+	return _mm_movemask_epi8(t);
+}
+
+static inline
+unsigned int scan_eq_sse2(__m128i v, char c)
+{
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+static inline
+unsigned int scan_space_sse2(__m128i v)
+{
+	return scan_range_sse2(v, '\t', '\r') | scan_eq_sse2(v, ' ');
+}
+
+/* $ is 0x24, ( to / are 0x28-0x2f, : and ; are 0x3a-0x3b. */
+static inline
+unsigned int scan_stop_sse2(__m128i v)
+{
+	return scan_space_sse2(v) | scan_eq_sse2(v, '$') |
+		scan_range_sse2(v, '(', '/') | scan_range_sse2(v, ':', ';') |
+		scan_eq_sse2(v, '[') | scan_eq_sse2(v, ']');
+}
+
+static
+size_t scan_space_end_sse2(const char *buf, size_t i, size_t e)
+{
+	unsigned int m;
+	__m128i v;
+
+	for (; i + 16 <= e; i += 16) {
+		v = _mm_loadu_si128((const __m128i *)&buf[i]);
+		m = ~scan_space_sse2(v) & 0xffff;
+		if (m)
+			return i + __builtin_ctz(m);
+	}
+	return scan_space_end_scalar(buf, i, e);
+}
+
+static
+size_t scan_token_end_sse2(const char *buf, size_t i, size_t e)
+{
+	unsigned int m;
+	__m128i v;
+
+	for (; i + 16 <= e; i += 16) {
+		v = _mm_loadu_si128((const __m128i *)&buf[i]);
+		m = scan_stop_sse2(v);
+		if (m)
+			return i + __builtin_ctz(m);
+	}
+	return scan_token_end_scalar(buf, i, e);
+}
+
+static
+size_t scan_line_end_sse2(const char *buf, size_t i, size_t e)
+{
+	unsigned int m;
+	__m128i v;
+
+	for (; i + 16 <= e; i += 16) {
+		v = _mm_loadu_si128((const __m128i *)&buf[i]);
+		m = scan_eq_sse2(v, '\n');
+		if (m)
+			return i + __builtin_ctz(m);
+	}
+	return scan_line_end_scalar(buf, i, e);
+}
+
+static const struct scan_ops scan_sse2_ops = {
+	.space_end	= scan_space_end_sse2,
+	.token_end	= scan_token_end_sse2,
+	.line_end	= scan_line_end_sse2,
+};
+
+/**** AVX2, 32 bytes per step ****/
+
+/*
+ * Set membership through two 16-entry lookups, one on each nibble. The high
+ * nibbles of the members (0, 2, 3 and 5) each get a bit; the entry for a low
+ * nibble has the bits of the high nibbles that, with it, form a member.
+ * Bytes >= 0x80 have no bit in the high table.
+ */
+#define SCAN_HI_0			0x01
+#define SCAN_HI_2			0x02
+#define SCAN_HI_3			0x04
+#define SCAN_HI_5			0x08
+
+#define SCAN_HI_TAB							\
+	SCAN_HI_0, 0, SCAN_HI_2, SCAN_HI_3, 0, SCAN_HI_5, 0, 0,		\
+	0, 0, 0, 0, 0, 0, 0, 0
+
+/* \t-\r and space */
+#define SCAN_SPACE_LO_TAB						\
+	SCAN_HI_2, 0, 0, 0, 0, 0, 0, 0,					\
+	0, SCAN_HI_0, SCAN_HI_0, SCAN_HI_0,				\
+	SCAN_HI_0, SCAN_HI_0, 0, 0
+
+/* Spaces, $ ( ) * + , - . / : ; [ ] */
+#define SCAN_STOP_LO_TAB						\
+	SCAN_HI_2, 0, 0, 0, SCAN_HI_2, 0, 0, 0,				\
+	SCAN_HI_2,							\
+	SCAN_HI_0 | SCAN_HI_2,						\
+	SCAN_HI_0 | SCAN_HI_2 | SCAN_HI_3,				\
+	SCAN_HI_0 | SCAN_HI_2 | SCAN_HI_3 | SCAN_HI_5,			\
+	SCAN_HI_0 | SCAN_HI_2,						\
+	SCAN_HI_0 | SCAN_HI_2 | SCAN_HI_5,				\
+	SCAN_HI_2,							\
+	SCAN_HI_2
+
+__attribute__((target("avx2")))
+static inline
+unsigned int scan_lookup_avx2(__m256i v, __m256i lo_tab, __m256i hi_tab)
+{
+	__m256i lo, hi, nib;
+
+	nib = _mm256_set1_epi8(0x0f);
+	lo = _mm256_shuffle_epi8(lo_tab, _mm256_and_si256(v, nib));
+	hi = _mm256_shuffle_epi8(hi_tab,
+				 _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+	lo = _mm256_and_si256(lo, hi);
+	lo = _mm256_cmpeq_epi8(lo, _mm256_setzero_si256());
+	return ~_mm256_movemask_epi8(lo);
+}
+
+__attribute__((target("avx2")))
+static
+size_t scan_space_end_avx2(const char *buf, size_t i, size_t e)
+{
+	unsigned int m;
+	__m256i v, lo_tab, hi_tab;
+
+	lo_tab = _mm256_setr_epi8(SCAN_SPACE_LO_TAB, SCAN_SPACE_LO_TAB);
+	hi_tab = _mm256_setr_epi8(SCAN_HI_TAB, SCAN_HI_TAB);
+	for (; i + 32 <= e; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *)&buf[i]);
+		m = ~scan_lookup_avx2(v, lo_tab, hi_tab);
+		if (m)
+			return i + __builtin_ctz(m);
+	}
+	return scan_space_end_sse2(buf, i, e);
+}
+
+__attribute__((target("avx2")))
+static
+size_t scan_token_end_avx2(const char *buf, size_t i, size_t e)
+{
+	unsigned int m;
+	__m256i v, lo_tab, hi_tab;
+
+	lo_tab = _mm256_setr_epi8(SCAN_STOP_LO_TAB, SCAN_STOP_LO_TAB);
+	hi_tab = _mm256_setr_epi8(SCAN_HI_TAB, SCAN_HI_TAB);
+	for (; i + 32 <= e; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *)&buf[i]);
+		m = scan_lookup_avx2(v, lo_tab, hi_tab);
+		if (m)
+			return i + __builtin_ctz(m);
+	}
+	return scan_token_end_sse2(buf, i, e);
+}
+
+__attribute__((target("avx2")))
+static
+size_t scan_line_end_avx2(const char *buf, size_t i, size_t e)
+{
+	unsigned int m;
+	__m256i v, nl;
+
+	nl = _mm256_set1_epi8('\n');
+	for (; i + 32 <= e; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *)&buf[i]);
+		m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+		if (m)
+			return i + __builtin_ctz(m);
+	}
+	return scan_line_end_sse2(buf, i, e);
+}
+
+static const struct scan_ops scan_avx2_ops = {
+	.space_end	= scan_space_end_avx2,
+	.token_end	= scan_token_end_avx2,
+	.line_end	= scan_line_end_avx2,
+};
+#endif
+
+const struct scan_ops *scan_get_scalar_ops(void)
+{
+	return &scan_scalar_ops;
+}
+
+const struct scan_ops *scan_get_ops(void)
+{
+#ifdef SCAN_X86
+	if (__builtin_cpu_supports("avx2"))
+		return &scan_avx2_ops;
+	return &scan_sse2_ops;
+#else
+	return &scan_scalar_ops;
+#endif
+}
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+/* Character classes, as seen by the lexer. */
+#define SCAN_SPACE			1	/* isspace() in the C locale */
+#define SCAN_DELIM			2	/* . , ; ( ) [ ] - + / * $ */
+#define SCAN_COLON			4	/* Ends a label */
+#define SCAN_STOP			(SCAN_SPACE | SCAN_DELIM | SCAN_COLON)
+
+extern const unsigned char scan_class[256];
+
+/*
+ * Each returns the first index in [i, e) whose character ends the run, or e.
+ * space_end: first non-space. token_end: first SCAN_STOP. line_end: first \n.
+ */
+struct scan_ops {
+	size_t	(*space_end)(const char *buf, size_t i, size_t e);
+	size_t	(*token_end)(const char *buf, size_t i, size_t e);
+	size_t	(*line_end)(const char *buf, size_t i, size_t e);
+};
+
+static inline
+bool scan_is(char c, int class)
+{
+	return scan_class[(unsigned char)c] & class;
+}
+
+/* The fastest implementation this cpu supports. */
+const struct scan_ops	*scan_get_ops(void);
+const struct scan_ops	*scan_get_scalar_ops(void);
+#endif
@@ -0,0 +1,450 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "egasm.h"
+#include "cli.h"
+#include "serve.h"
+
+#define SERVE_BACKLOG			64
+#define SERVE_COPY_SIZE			(64 * 1024)
+
+struct serve;
+struct serve_worker {
+	struct serve			*s;
+
+	/* Kept warm across the requests; by EGASM_SINGLE_PASS. */
+	struct egasm			*ctxs[2];
+	char				*in;
+	uint32_t			*out;
+	size_t				max_in;
+	size_t				max_out;	/* In bytes */
+
+	pthread_t			thread;
+	int				err;	/* Of accept */
+};
+
+struct serve {
+	const struct cli_opts		*opts;
+	struct serve_worker		*workers;
+	int				num_workers;
+	int				fd;		/* Listening */
+};
+
+/* For the signal handler; the socket goes with the server. */
+static const char *serve_path;
+
+static
+void serve_stop(int sig)
+{
+	(void)sig;
+	unlink(serve_path);
+	_exit(0);
+}
+
+/* Up to n bytes; fewer only at the end of the stream. */
+static
+int serve_read_all(int fd, void *p, size_t n, size_t *out_n)
+{
+	size_t i;
+	ssize_t ret;
+
+	*out_n = 0;
+	for (i = 0; i < n; i += ret) {
+		ret = read(fd, (char *)p + i, n - i);
+		if (ret < 0 && errno == EINTR) {
+			ret = 0;
+			continue;
+		}
+		if (ret < 0)
+			return errno;
+		if (ret == 0)
+			break;
+	}
+	*out_n = i;
+	return 0;
+}
+
+static
+int serve_write_all(int fd, struct iovec *iov, int n)
+{
+	ssize_t ret;
+
+	while (n) {
+		ret = writev(fd, iov, n);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return errno;
+		for (; n && (size_t)ret >= iov->iov_len; --n, ++iov)
+			ret -= iov->iov_len;
+		if (n) {
+			iov->iov_base = (char *)iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+	return 0;
+}
+
+static
+int serve_reserve(void **p, size_t *max, size_t size)
+{
+	void *t;
+
+	if (size <= *max)
+		return 0;
+	t = realloc(*p, size);
+	if (t == NULL)
+		return ENOMEM;
+	*p = t;
+	*max = size;
+	return 0;
+}
+
+static
+int serve_worker_get_ctx(struct serve_worker *this, int flags,
+			 struct egasm **out)
+{
+	int err;
+	struct egasm **ctx;
+	const struct cli_opts *opts;
+
+	ctx = &this->ctxs[flags & EGASM_SINGLE_PASS ? 1 : 0];
+	if (*ctx) {
+		*out = *ctx;
+		return 0;
+	}
+
+	opts = this->s->opts;
+	err = egasm_create(flags, ctx);
+	if (!err && opts->num_chunk_threads > 1)
+		err = egasm_set_num_threads(*ctx, opts->num_chunk_threads);
+	if (!err && opts->cache_dir)
+		err = egasm_set_cache(*ctx, opts->cache_dir, opts->cache_size);
+	if (err) {
+		egasm_destroy(*ctx);
+		*ctx = NULL;
+		return err;
+	}
+	*out = *ctx;
+	return 0;
+}
+
+/* Reply to the request, whose header has been read; an error hangs up. */
+static
+int serve_worker_do(struct serve_worker *this, int fd,
+		    const struct serve_req *req)
+{
+	int err, flags;
+	size_t n, size;
+	struct serve_rep rep;
+	struct egasm *ctx;
+	struct egasm_diag diag;
+	struct iovec iov[2];
+
+	memset(&rep, 0, sizeof(rep));
+	rep.magic = serve_le32(SERVE_MAGIC);
+	iov[0].iov_base = &rep;
+	iov[0].iov_len = sizeof(rep);
+
+	size = serve_le32(req->size);
+	flags = serve_le32(req->flags);
+	err = 0;
+	if (size > SERVE_MAX_SIZE)
+		err = EFBIG;
+	else if (flags & ~EGASM_SINGLE_PASS)
+		err = EINVAL;
+	if (!err)
+		err = serve_reserve((void **)&this->in, &this->max_in, size + 1);
+	if (err) {
+		rep.err = serve_le32(err);
+		serve_write_all(fd, iov, 1);
+		return err;
+	}
+
+	err = serve_read_all(fd, this->in, size, &n);
+	if (!err && n < size)
+		err = EPIPE;
+	if (err)
+		return err;
+
+	memset(&diag, 0, sizeof(diag));
+	err = serve_worker_get_ctx(this, flags, &ctx);
+	if (!err)
+		err = egasm_prepare(ctx, this->in, size, &n, &diag);
+	if (!err)
+		err = serve_reserve((void **)&this->out, &this->max_out, n + 1);
+	if (!err)
+		err = egasm_emit(ctx, this->out, n);
+
+	if (err) {
+		rep.err = serve_le32(err);
+		if (diag.err) {
+			rep.inst = serve_le32(diag.inst);
+			rep.line = serve_le32(diag.line);
+			rep.pos = serve_le32(diag.pos);
+			memcpy(rep.stage, diag.stage,
+			       strnlen(diag.stage, sizeof(rep.stage)));
+		}
+		return serve_write_all(fd, iov, 1);
+	}
+
+	rep.num_words = serve_le32(n / sizeof(uint32_t));
+	iov[1].iov_base = this->out;
+	iov[1].iov_len = n;
+	return serve_write_all(fd, iov, 2);
+}
+
+static
+void serve_worker_conn(struct serve_worker *this, int fd)
+{
+	int err;
+	size_t n;
+	struct serve_req req;
+
+	for (;;) {
+		err = serve_read_all(fd, &req, sizeof(req), &n);
+		if (err || n < sizeof(req))
+			break;
+		if (serve_le32(req.magic) != SERVE_MAGIC)
+			break;
+		if (serve_worker_do(this, fd, &req))
+			break;
+	}
+	close(fd);
+}
+
+/*
+ * The workers take turns at accept; a connection is served by the one that
+ * accepted it, until the client hangs up. Those beyond the number of workers
+ * wait in the backlog.
+ */
+static
+void *serve_worker_run(void *arg)
+{
+	int fd;
+	struct serve_worker *this;
+
+	this = arg;
+	for (;;) {
+		fd = accept(this->s->fd, NULL, NULL);
+		if (fd >= 0) {
+			serve_worker_conn(this, fd);
+			continue;
+		}
+		if (errno == EINTR || errno == ECONNABORTED ||
+		    errno == EMFILE || errno == ENFILE ||
+		    errno == ENOBUFS || errno == ENOMEM)
+			continue;
+		this->err = errno;
+		break;
+	}
+	return NULL;
+}
+
+static
+int serve_addr(const char *path, struct sockaddr_un *sa)
+{
+	if (strlen(path) >= sizeof(sa->sun_path))
+		return ENAMETOOLONG;
+	memset(sa, 0, sizeof(*sa));
+	sa->sun_family = AF_UNIX;
+	strcpy(sa->sun_path, path);
+	return 0;
+}
+
+/* A socket left by a server that is gone is replaced; a live one is not. */
+static
+int serve_listen(const char *path, int *out_fd)
+{
+	int fd, err;
+	struct sockaddr_un sa;
+	struct stat st;
+
+	err = serve_addr(path, &sa);
+	if (err)
+		return err;
+
+	if (!lstat(path, &st) && S_ISSOCK(st.st_mode)) {
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0)
+			return errno;
+		err = connect(fd, (struct sockaddr *)&sa, sizeof(sa)) ? 0 :
+			EADDRINUSE;
+		close(fd);
+		if (err)
+			return err;
+		unlink(path);
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return errno;
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) ||
+	    listen(fd, SERVE_BACKLOG)) {
+		err = errno;
+		close(fd);
+		return err;
+	}
+	*out_fd = fd;
+	return 0;
+}
+
+/*
+ * Assemble the requests of any number of clients, on a pool of threads, each
+ * with contexts that stay warm across the requests; see serve.h.
+ */
+int serve_main(const struct cli_opts *opts, const char *path)
+{
+	int i, j, err;
+	struct serve s;
+	struct serve_worker *w;
+
+	signal(SIGPIPE, SIG_IGN);
+	memset(&s, 0, sizeof(s));
+	s.opts = opts;
+	err = serve_listen(path, &s.fd);
+	if (err) {
+		printf("%s: %s\n", path, strerror(err));
+		return err;
+	}
+	serve_path = path;
+	signal(SIGINT, serve_stop);
+	signal(SIGTERM, serve_stop);
+
+	s.num_workers = opts->num_threads;
+	if (s.num_workers == 0)
+		s.num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (s.num_workers < 1)
+		s.num_workers = 1;
+	s.workers = calloc(s.num_workers, sizeof(*s.workers));
+	if (s.workers == NULL) {
+		err = ENOMEM;
+		goto close;
+	}
+
+	printf("%s: listening, %d threads\n", path, s.num_workers);
+	fflush(stdout);
+	for (i = 0; i < s.num_workers; ++i)
+		s.workers[i].s = &s;
+	for (i = 1; i < s.num_workers; ++i) {
+		w = &s.workers[i];
+		if (pthread_create(&w->thread, NULL, serve_worker_run, w))
+			break;
+	}
+
+	/* Returns only once accept fails for good; the others follow. */
+	serve_worker_run(&s.workers[0]);
+	err = s.workers[0].err;
+	printf("%s: %s\n", path, strerror(err));
+	shutdown(s.fd, SHUT_RDWR);
+	while (--i > 0)
+		pthread_join(s.workers[i].thread, NULL);
+
+	for (i = 0; i < s.num_workers; ++i) {
+		w = &s.workers[i];
+		for (j = 0; j < 2; ++j)
+			egasm_destroy(w->ctxs[j]);
+		free(w->in);
+		free(w->out);
+	}
+	free(s.workers);
+close:
+	close(s.fd);
+	unlink(path);
+	return err;
+}
+
+/* The words, as -o bin writes them, from the server at sock. */
+int serve_client_main(const struct cli_opts *opts, const char *sock,
+		      const char *path)
+{
+	int fd, err;
+	size_t i, n, size;
+	struct input in;
+	struct sockaddr_un sa;
+	struct serve_req req;
+	struct serve_rep rep;
+	struct iovec iov[2];
+	char buf[SERVE_COPY_SIZE];
+
+	signal(SIGPIPE, SIG_IGN);
+	err = serve_addr(sock, &sa);
+	if (err)
+		return err;
+	err = input_open(&in, path);
+	if (err)
+		return err;
+	if (in.size > SERVE_MAX_SIZE) {
+		input_close(&in);
+		return EFBIG;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	err = fd < 0 ? errno : 0;
+	if (!err && connect(fd, (struct sockaddr *)&sa, sizeof(sa)))
+		err = errno;
+	if (err) {
+		printf("%s: %s\n", sock, strerror(err));
+		goto close;
+	}
+
+	req.magic = serve_le32(SERVE_MAGIC);
+	req.flags = serve_le32(opts->single_pass ? EGASM_SINGLE_PASS : 0);
+	req.size = serve_le32(in.size);
+	iov[0].iov_base = &req;
+	iov[0].iov_len = sizeof(req);
+	iov[1].iov_base = (void *)in.buf;
+	iov[1].iov_len = in.size;
+	err = serve_write_all(fd, iov, 2);
+	if (!err)
+		err = serve_read_all(fd, &rep, sizeof(rep), &n);
+	if (!err && (n < sizeof(rep) || serve_le32(rep.magic) != SERVE_MAGIC))
+		err = EPROTO;
+	if (err) {
+		printf("%s: %s\n", sock, strerror(err));
+		goto close;
+	}
+
+	err = (int32_t)serve_le32(rep.err);
+	if (err && rep.stage[0]) {
+		printf("%.*s err %d, line %d, i = %x, inst = %d\n",
+		       SERVE_STAGE_LEN, rep.stage, err,
+		       (int32_t)serve_le32(rep.line), serve_le32(rep.pos),
+		       (int32_t)serve_le32(rep.inst));
+		goto close;
+	} else if (err) {
+		printf("%s: %s\n", sock, strerror(err));
+		goto close;
+	}
+
+	size = (size_t)serve_le32(rep.num_words) * sizeof(uint32_t);
+	for (i = 0; !err && i < size; i += n) {
+		n = size - i < sizeof(buf) ? size - i : sizeof(buf);
+		err = serve_read_all(fd, buf, n, &n);
+		if (!err && n == 0)
+			err = EPROTO;
+		if (err)
+			break;
+		iov[0].iov_base = buf;
+		iov[0].iov_len = n;
+		err = serve_write_all(STDOUT_FILENO, iov, 1);
+	}
+close:
+	if (fd >= 0)
+		close(fd);
+	input_close(&in);
+	return err;
+}
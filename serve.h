@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdint.h>
+
+/*
+ * The protocol of -S, over a unix stream socket. A connection carries any
+ * number of requests, one after the other; each gets its reply before the
+ * next is read. Every field is little-endian.
+ */
+#define SERVE_MAGIC			0x73616765u	/* "egas" */
+#define SERVE_MAX_SIZE			(256u << 20)	/* Of an input */
+#define SERVE_STAGE_LEN			8
+
+/* Followed by size bytes of source. */
+struct serve_req {
+	uint32_t			magic;
+	uint32_t			flags;	/* EGASM_SINGLE_PASS */
+	uint32_t			size;
+};
+
+/*
+ * Followed, if err is 0, by num_words words, as egasm_emit writes them; else,
+ * the rest is as egasm_diag has it. stage is empty for errors not of the
+ * input. After an error in the request itself, such as an input too large,
+ * the server hangs up.
+ */
+struct serve_rep {
+	uint32_t			magic;
+	int32_t				err;	/* errno value */
+	uint32_t			num_words;
+	int32_t				inst;
+	int32_t				line;
+	uint32_t			pos;
+	char				stage[SERVE_STAGE_LEN];	/* NUL-padded */
+};
+
+static inline
+uint32_t serve_le32(uint32_t v)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap32(v);
+#endif
+	return v;
+}
+#endif
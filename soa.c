@@ -0,0 +1,300 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+
+/* AVX2 is detected at runtime. */
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SOA_X86
+#endif
+
+#include "main.h"
+
+#define SOA_MAX_WORDS			3
+
+static struct soa_fmt soa_fmts[SOA_NUM_FMTS];
+static pthread_once_t soa_once = PTHREAD_ONCE_INIT;
+
+/*
+ * The field of t that is all ones: wherever the compiler put it within
+ * inst_all.u, it is in one aligned 32 bits, as bit-fields of unsigned int do
+ * not straddle them. It joins a field of the same column, word and shift.
+ */
+static
+void soa_fmt_add(struct soa_fmt *this, const struct inst_all *t, int word,
+		 int pos, int bits)
+{
+	int i, c, k, cpos, lsh, rsh;
+	uint32_t u[SOA_MAX_UNITS];
+	struct soa_field *f;
+
+	_Static_assert(sizeof(t->u) <= sizeof(u), "SOA_MAX_UNITS");
+	memset(u, 0, sizeof(u));
+	memcpy(u, &t->u, sizeof(t->u));
+	for (i = 0; u[i] == 0; ++i)
+		;
+	cpos = __builtin_ctz(u[i]);
+	assert(u[i] >> cpos == align_mask(bits));
+	for (c = 0; c < this->num_units && this->units[c] != i; ++c)
+		;
+	if (c == this->num_units)
+		this->units[this->num_units++] = i;
+	if (word >= this->num_words)
+		this->num_words = word + 1;
+
+	lsh = pos > cpos ? pos - cpos : 0;
+	rsh = cpos > pos ? cpos - pos : 0;
+	for (k = 0, f = NULL; k < this->num_fields && f == NULL; ++k) {
+		f = &this->fields[k];
+		if (f->col != c || f->word != word || f->lsh != lsh ||
+		    f->rsh != rsh)
+			f = NULL;
+	}
+	if (f == NULL) {
+		assert(k < SOA_MAX_FIELDS && word < SOA_MAX_WORDS);
+		f = &this->fields[this->num_fields++];
+		f->mask = 0;
+		f->col = c;
+		f->word = word;
+		f->lsh = lsh;
+		f->rsh = rsh;
+	}
+	f->mask |= u[i];
+}
+
+#define SOA_FIELD(a, w, f, m, pos, bits)				\
+	memset(&t, 0, sizeof(t));					\
+	t.u.a.m = bits_mask(w##_##f);					\
+	soa_fmt_add(fmt, &t, word, pos, bits);
+
+/* As inst_alu_encode, inst_tex_encode_all and inst_vtx_encode_all pack. */
+static
+void soa_build(void)
+{
+	int word;
+	struct inst_all t;
+	struct soa_fmt *fmt;
+
+	fmt = &soa_fmts[SOA_ALU_OP2];
+	word = 0;
+	ALU_WORD0_FIELDS(SOA_FIELD, alu.w0)
+	word = 1;
+	ALU_WORD1_OP2_FIELDS(SOA_FIELD, alu.w1)
+	ALU_WORD1_FIELDS(SOA_FIELD, alu.w1)
+
+	fmt = &soa_fmts[SOA_ALU_OP3];
+	word = 0;
+	ALU_WORD0_FIELDS(SOA_FIELD, alu.w0)
+	word = 1;
+	ALU_WORD1_OP3_FIELDS(SOA_FIELD, alu.w1)
+	ALU_WORD1_FIELDS(SOA_FIELD, alu.w1)
+
+	fmt = &soa_fmts[SOA_TEX];
+	word = 0;
+	TEX_WORD0_FIELDS(SOA_FIELD, tex.w0)
+	word = 1;
+	TEX_WORD1_FIELDS(SOA_FIELD, tex.w1)
+	word = 2;
+	TEX_WORD2_FIELDS(SOA_FIELD, tex.w2)
+
+	fmt = &soa_fmts[SOA_VTX_GPR];
+	word = 0;
+	VTX_WORD0_FIELDS(SOA_FIELD, vtx.w0)
+	word = 1;
+	VTX_WORD1_GPR_FIELDS(SOA_FIELD, vtx.w1)
+	VTX_WORD1_FIELDS(SOA_FIELD, vtx.w1)
+	word = 2;
+	VTX_WORD2_FIELDS(SOA_FIELD, vtx.w2)
+
+	fmt = &soa_fmts[SOA_VTX_SEM];
+	word = 0;
+	VTX_WORD0_FIELDS(SOA_FIELD, vtx.w0)
+	word = 1;
+	VTX_WORD1_SEM_FIELDS(SOA_FIELD, vtx.w1)
+	VTX_WORD1_FIELDS(SOA_FIELD, vtx.w1)
+	word = 2;
+	VTX_WORD2_FIELDS(SOA_FIELD, vtx.w2)
+}
+
+/* The columns of the n instructions; the lanes from n on are 0. */
+static inline
+void soa_gather(const struct soa_fmt *fmt, const struct inst_all *insts,
+		const int *ix, int n, uint32_t cols[][SOA_LANES])
+{
+	int i, c;
+	const char *p;
+
+	for (i = 0; i < n; ++i) {
+		p = (const char *)&insts[ix[i]].u;
+		for (c = 0; c < fmt->num_units; ++c)
+			memcpy(&cols[c][i], &p[fmt->units[c] * sizeof(uint32_t)],
+			       sizeof(uint32_t));
+	}
+	for (; i < SOA_LANES; ++i) {
+		for (c = 0; c < fmt->num_units; ++c)
+			cols[c][i] = 0;
+	}
+}
+
+static inline
+void soa_scatter(const struct soa_fmt *fmt, struct inst_all *insts,
+		 const int *ix, int n, uint32_t words[][SOA_LANES])
+{
+	int i, k;
+	struct inst_base *base;
+
+	for (i = 0; i < n; ++i) {
+		base = &insts[ix[i]].base;
+		for (k = 0; k < fmt->num_words; ++k)
+			base->w[k] |= words[k][i];
+	}
+}
+
+/**** Scalar ****/
+static
+void soa_encode_scalar(const struct soa_fmt *fmt, struct inst_all *insts,
+		       const int *ix, int n)
+{
+	int i, k;
+	uint32_t cols[SOA_MAX_UNITS][SOA_LANES];
+	uint32_t words[SOA_MAX_WORDS][SOA_LANES];
+	const struct soa_field *f;
+
+	soa_gather(fmt, insts, ix, n, cols);
+	memset(words, 0, sizeof(words));
+	for (k = 0; k < fmt->num_fields; ++k) {
+		f = &fmt->fields[k];
+		for (i = 0; i < SOA_LANES; ++i)
+			words[f->word][i] |=
+				((cols[f->col][i] & f->mask) >> f->rsh) <<
+				f->lsh;
+	}
+	soa_scatter(fmt, insts, ix, n, words);
+}
+
+static const struct soa_ops soa_scalar_ops = {
+	.encode		= soa_encode_scalar,
+};
+
+#ifdef SOA_X86
+/**** AVX2, 8 instructions per step ****/
+_Static_assert(SOA_LANES == 8, "SOA_LANES");
+
+__attribute__((target("avx2")))
+static
+void soa_encode_avx2(const struct soa_fmt *fmt, struct inst_all *insts,
+		     const int *ix, int n)
+{
+	int k;
+	_Alignas(32) uint32_t cols[SOA_MAX_UNITS][SOA_LANES];
+	_Alignas(32) uint32_t words[SOA_MAX_WORDS][SOA_LANES];
+	__m256i v, w[SOA_MAX_WORDS];
+	const struct soa_field *f;
+
+	soa_gather(fmt, insts, ix, n, cols);
+	for (k = 0; k < SOA_MAX_WORDS; ++k)
+		w[k] = _mm256_setzero_si256();
+	for (k = 0; k < fmt->num_fields; ++k) {
+		f = &fmt->fields[k];
+		v = _mm256_load_si256((const __m256i *)cols[f->col]);
+		v = _mm256_and_si256(v, _mm256_set1_epi32(f->mask));
+		v = _mm256_srl_epi32(v, _mm_cvtsi32_si128(f->rsh));
+		v = _mm256_sll_epi32(v, _mm_cvtsi32_si128(f->lsh));
+		w[f->word] = _mm256_or_si256(w[f->word], v);
+	}
+	for (k = 0; k < fmt->num_words; ++k)
+		_mm256_store_si256((__m256i *)words[k], w[k]);
+	soa_scatter(fmt, insts, ix, n, words);
+}
+
+static const struct soa_ops soa_avx2_ops = {
+	.encode		= soa_encode_avx2,
+};
+#endif
+
+/* The format the instruction is encoded in, if in steps; else -1. */
+static
+int soa_fmt_of(const struct inst_all *in)
+{
+	switch (in->base.type) {
+	case IT_ALU_OP2:
+		return SOA_ALU_OP2;
+	case IT_ALU_OP3:
+		return SOA_ALU_OP3;
+	case IT_TEX:
+		return SOA_TEX;
+	case IT_VTX_GPR:
+	case IT_VTX_SEM:
+		/* As inst_vtx_encode_all chooses. */
+		if (in->u.vtx.w0.vc_inst == VC_INST_SEMANTIC)
+			return SOA_VTX_SEM;
+		return SOA_VTX_GPR;
+	default:
+		return -1;
+	}
+}
+
+void soa_construct(struct soa *this, const struct soa_ops *ops,
+		   struct inst_all *insts)
+{
+	pthread_once(&soa_once, soa_build);
+	this->ops = ops;
+	this->fmts = soa_fmts;
+	this->insts = insts;
+	memset(this->n, 0, sizeof(this->n));
+}
+
+/*
+ * Queue insts[i] for encoding, if it is of a format encoded in steps; a step
+ * is encoded once full. Until soa_flush, the words of those queued are not
+ * yet complete.
+ */
+bool soa_add(struct soa *this, int i)
+{
+	int f;
+
+	f = soa_fmt_of(&this->insts[i]);
+	if (f < 0)
+		return false;
+	this->ix[f][this->n[f]++] = i;
+	if (this->n[f] == SOA_LANES) {
+		this->ops->encode(&this->fmts[f], this->insts, this->ix[f],
+				  SOA_LANES);
+		this->n[f] = 0;
+	}
+	return true;
+}
+
+void soa_flush(struct soa *this)
+{
+	int f;
+
+	for (f = 0; f < SOA_NUM_FMTS; ++f) {
+		if (this->n[f] == 0)
+			continue;
+		this->ops->encode(&this->fmts[f], this->insts, this->ix[f],
+				  this->n[f]);
+		this->n[f] = 0;
+	}
+}
+
+const struct soa_ops *soa_get_scalar_ops(void)
+{
+	return &soa_scalar_ops;
+}
+
+const struct soa_ops *soa_get_ops(void)
+{
+#ifdef SOA_X86
+	if (__builtin_cpu_supports("avx2"))
+		return &soa_avx2_ops;
+#endif
+	return &soa_scalar_ops;
+}
@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef SOA_H
+#define SOA_H
+
+#define SOA_LANES			8	/* Instructions per step */
+#define SOA_MAX_UNITS			8	/* Of inst_all.u, in 32 bits */
+#define SOA_MAX_FIELDS			32	/* Per format, as merged */
+
+/* The formats encoded in steps; the rest, one at a time. */
+enum soa_fmt_id {
+	SOA_ALU_OP2,
+	SOA_ALU_OP3,
+	SOA_TEX,
+	SOA_VTX_GPR,
+	SOA_VTX_SEM,
+	SOA_NUM_FMTS,
+};
+
+/*
+ * The fields of a column that move by the same shift into the same word. Most
+ * words are held in a column much as they are encoded, and take one or two.
+ */
+struct soa_field {
+	unsigned int			mask;	/* Within the column */
+	unsigned char			col;
+	unsigned char			word;
+	unsigned char			lsh;
+	unsigned char			rsh;
+};
+
+/*
+ * The fields of a format, generated from its lists of fields. Column i holds
+ * the 32 bits units[i] of inst_all.u.
+ */
+struct soa_fmt {
+	struct soa_field		fields[SOA_MAX_FIELDS];
+	unsigned char			units[SOA_MAX_UNITS];
+	int				num_fields;
+	int				num_units;
+	int				num_words;
+};
+
+struct inst_all;
+
+/* Each ors the words of n <= SOA_LANES instructions, all of fmt. */
+struct soa_ops {
+	void	(*encode)(const struct soa_fmt *fmt, struct inst_all *insts,
+			  const int *ix, int n);
+};
+
+/*
+ * The instructions of asm_base.insts, gathered by format until a step is full;
+ * their fields are unpacked into columns, and packed into words, a column at
+ * a time.
+ */
+struct soa {
+	const struct soa_ops		*ops;
+	const struct soa_fmt		*fmts;
+	struct inst_all			*insts;
+	int				ix[SOA_NUM_FMTS][SOA_LANES];
+	int				n[SOA_NUM_FMTS];
+};
+
+void	soa_construct(struct soa *this, const struct soa_ops *ops,
+		      struct inst_all *insts);
+bool	soa_add(struct soa *this, int i);
+void	soa_flush(struct soa *this);
+
+/* The fastest implementation this cpu supports. */
+const struct soa_ops	*soa_get_ops(void);
+const struct soa_ops	*soa_get_scalar_ops(void);
+#endif
@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "main.h"
+#include "cli.h"
+
+#define STREAM_WORD_LEN			10	/* 0x%08x */
+
+/* An instruction printed before the label it references was defined. */
+struct stream_ref {
+	struct inst_all			in;
+	off_t				off;	/* Of its first word */
+	int				next;	/* In its label's chain, or free */
+};
+
+/*
+ * The last stage of the pipeline. On a seekable output, an instruction is
+ * printed as soon as it arrives, and its first word is rewritten in place once
+ * its label is defined; only those instructions are kept until then.
+ */
+struct stream_out {
+	struct out_buf			ob;
+	struct stream_ref		*refs;
+	int				*heads;		/* By sym id; -1 */
+	int				num_refs;
+	int				max_refs;
+	int				max_heads;
+	int				free;
+	bool				seekable;
+};
+
+static
+int stream_out_add_ref(struct stream_out *this, const struct pipe_rec *rec)
+{
+	int i, n, r, *h;
+	off_t off;
+	struct stream_ref *t;
+
+	off = out_buf_tell(&this->ob);
+
+	if (rec->label >= this->max_heads) {
+		n = this->max_heads ? 2 * this->max_heads : 256;
+		if (n <= rec->label)
+			n = rec->label + 1;
+		h = realloc(this->heads, n * sizeof(*h));
+		if (h == NULL)
+			return ENOMEM;
+		for (i = this->max_heads; i < n; ++i)
+			h[i] = -1;
+		this->heads = h;
+		this->max_heads = n;
+	}
+
+	r = this->free;
+	if (r >= 0) {
+		this->free = this->refs[r].next;
+	} else {
+		if (this->num_refs == this->max_refs) {
+			n = this->max_refs ? 2 * this->max_refs : 64;
+			t = realloc(this->refs, n * sizeof(*t));
+			if (t == NULL)
+				return ENOMEM;
+			this->refs = t;
+			this->max_refs = n;
+		}
+		r = this->num_refs++;
+	}
+
+	this->refs[r].in = rec->in;
+	this->refs[r].off = off;
+	this->refs[r].next = this->heads[rec->label];
+	this->heads[rec->label] = r;
+	return 0;
+}
+
+/* Rewrite the first words of the instructions that reference the label. */
+static
+int stream_out_patch(struct stream_out *this, int label, int pc)
+{
+	int r, next;
+	ssize_t ret;
+	char word[STREAM_WORD_LEN + 1];
+	struct stream_ref *ref;
+
+	if (label >= this->max_heads || this->heads[label] < 0)
+		return 0;
+
+	/* The words may still be in the buffer. */
+	if (out_buf_flush(&this->ob))
+		return this->ob.err;
+
+	for (r = this->heads[label]; r >= 0; r = next) {
+		ref = &this->refs[r];
+		next = ref->next;
+
+		inst_cf_patch_label_all(&ref->in, pc);
+		snprintf(word, sizeof(word), "0x%08x", ref->in.base.w[0]);
+		ret = pwrite(this->ob.fd, word, STREAM_WORD_LEN, ref->off);
+		if (ret < 0)
+			return errno;
+		if (ret != STREAM_WORD_LEN)
+			return EIO;
+
+		ref->next = this->free;
+		this->free = r;
+	}
+	this->heads[label] = -1;
+	return 0;
+}
+
+static
+int stream_out_print(void *arg, const char *buf, const struct pipe_rec *rec)
+{
+	int err;
+	struct stream_out *this;
+
+	this = arg;
+	err = 0;
+	if (rec->type == PIPE_REC_LABEL) {
+		out_buf_put_label(&this->ob, buf, rec->s, rec->e - rec->s);
+		err = stream_out_patch(this, rec->label, rec->in.base.pc);
+	} else {
+		if (rec->label >= 0)
+			err = stream_out_add_ref(this, rec);
+		if (!err)
+			out_buf_put_inst(&this->ob, &rec->in.base, buf, rec->s,
+					 rec->e);
+	}
+	return err ? err : this->ob.err;
+}
+
+/* A regular file not opened to append can be rewritten in place. */
+static
+bool stream_is_seekable(int fd)
+{
+	int flags;
+	struct stat st;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+		return false;
+	flags = fcntl(fd, F_GETFL);
+	return flags >= 0 && !(flags & O_APPEND);
+}
+
+/*
+ * Assemble the input as it is read, in memory that does not grow with it; for
+ * pipes, whose writer may be slow, and for generated sources too large to map.
+ * What precedes an error is printed, as it is assembled.
+ */
+int pipe_main(const char *path)
+{
+	int fd, err, flush_err;
+	struct asm_pipe *p;
+	struct egasm_diag diag;
+	struct stream_out out;
+
+	fd = STDIN_FILENO;
+	if (path && strcmp(path, "-")) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			return errno;
+	}
+
+	memset(&out, 0, sizeof(out));
+	out.free = -1;
+	out.seekable = stream_is_seekable(STDOUT_FILENO);
+	err = out_buf_construct(&out.ob);
+	if (err)
+		goto close;
+	out_buf_reset(&out.ob, STDOUT_FILENO);
+
+	/* Large; keep it off the stack. */
+	p = malloc(sizeof(*p));
+	err = p ? asm_pipe_construct(p) : ENOMEM;
+	if (!err) {
+		p->emit_unresolved = out.seekable;
+		err = asm_pipe_assemble(p, fd, stream_out_print, &out, &diag);
+
+		/* What was emitted before any error, too. */
+		flush_err = out_buf_flush(&out.ob);
+		if (err && diag.err == 0)
+			printf("%s\n", strerror(err));
+		else if (err)
+			printf("%s err %d, line %d, i = %zx, inst = %d\n",
+			       diag.stage, err, diag.line, diag.pos, diag.inst);
+		else
+			err = flush_err;
+		asm_pipe_destruct(p);
+	}
+	free(p);
+	out_buf_destruct(&out.ob);
+	free(out.refs);
+	free(out.heads);
+close:
+	if (fd != STDIN_FILENO)
+		close(fd);
+	return err;
+}
@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "main.h"
+
+/* FNV-1a */
+static
+unsigned int sym_hash(const char *s, int len)
+{
+	int i;
+	unsigned int h;
+
+	h = 2166136261u;
+	for (i = 0; i < len; ++i) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/* The index of the slot of the name, or of the empty slot that ends its run. */
+static
+int sym_tab_find_slot(const struct sym_tab *this, const char *s, int len,
+		      unsigned int hash)
+{
+	int i, slot;
+	const struct sym *sym;
+
+	for (i = hash & (this->num_slots - 1);;
+	     i = (i + 1) & (this->num_slots - 1)) {
+		slot = this->slots[i];
+		if (slot == 0)
+			return i;
+		sym = &this->syms[slot - 1];
+		if (sym->hash != hash || sym->len != len)
+			continue;
+		if (!memcmp(sym->name, s, len))
+			return i;
+	}
+}
+
+/* Keep the load factor at or below 1/2. */
+static
+int sym_tab_grow(struct sym_tab *this)
+{
+	int i, j, num_slots, max_syms, *slots;
+	struct sym *syms;
+
+	if (this->num_syms == this->max_syms) {
+		max_syms = this->max_syms ? 2 * this->max_syms : 256;
+		syms = arena_realloc(this->arena, this->syms,
+				     this->max_syms * sizeof(*syms),
+				     max_syms * sizeof(*syms));
+		if (syms == NULL)
+			return ENOMEM;
+		this->syms = syms;
+		this->max_syms = max_syms;
+	}
+
+	if (2 * (this->num_syms + 1) <= this->num_slots)
+		return 0;
+
+	num_slots = this->num_slots ? 2 * this->num_slots : 512;
+	slots = arena_alloc(this->arena, num_slots * sizeof(*slots));
+	if (slots == NULL)
+		return ENOMEM;
+	memset(slots, 0, num_slots * sizeof(*slots));
+
+	/* Rehash. The names are unique; no need to compare them. */
+	for (i = 0; i < this->num_syms; ++i) {
+		for (j = this->syms[i].hash & (num_slots - 1); slots[j];
+		     j = (j + 1) & (num_slots - 1))
+			;
+		slots[j] = i + 1;
+	}
+	this->slots = slots;
+	this->num_slots = num_slots;
+	return 0;
+}
+
+/* Return the id of the sym named buf[s, s + len), adding it if necessary. */
+int sym_tab_intern(struct sym_tab *this, size_t s, int len, int *out)
+{
+	int err, *slot;
+	unsigned int hash;
+	const char *name;
+	char *copy;
+	struct sym *sym;
+
+	err = sym_tab_grow(this);
+	if (err)
+		return err;
+
+	name = &this->buf[s];
+	hash = sym_hash(name, len);
+	slot = &this->slots[sym_tab_find_slot(this, name, len, hash)];
+	if (*slot) {
+		*out = *slot - 1;
+		return 0;
+	}
+
+	if (this->copy_names) {
+		copy = arena_alloc(this->arena, len);
+		if (copy == NULL)
+			return ENOMEM;
+		memcpy(copy, name, len);
+		name = copy;
+	}
+
+	sym = &this->syms[this->num_syms];
+	sym->name = name;
+	sym->len = len;
+	sym->hash = hash;
+	sym->pc = -1;
+	sym->refs = -1;
+	*slot = ++this->num_syms;
+	*out = *slot - 1;
+	return 0;
+}
+
+/* The id of the sym named s[0, len); -1 if none. The table is not modified. */
+int sym_tab_find(const struct sym_tab *this, const char *s, int len)
+{
+	int i;
+
+	if (this->num_slots == 0)
+		return -1;
+	i = sym_tab_find_slot(this, s, len, sym_hash(s, len));
+	return this->slots[i] - 1;
+}
+
+int sym_tab_define(struct sym_tab *this, int id, int pc)
+{
+	struct sym *sym;
+
+	assert(id >= 0 && id < this->num_syms);
+	sym = &this->syms[id];
+	if (sym->pc >= 0)
+		return EEXIST;	/* Duplicate label */
+	sym->pc = pc;
+	return 0;
+}
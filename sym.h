@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef SYM_H
+#define SYM_H
+
+/* A label. The name is within the source buffer, unless copied. */
+struct sym {
+	const char			*name;
+	int				len;
+	unsigned int			hash;
+	int				pc;	/* -1 until defined. */
+	int				refs;	/* asm_base.patches chain; -1 */
+};
+
+/* Open-addressed (linear probing) hash of label names to their syms. */
+struct sym_tab {
+	const char			*buf;
+	struct arena			*arena;
+
+	struct sym			*syms;
+	int				*slots;	/* sym id + 1; 0 if empty. */
+
+	int				num_syms;
+	int				max_syms;
+	int				num_slots;	/* Power of 2 */
+
+	/* Into the arena; for a source buffer that does not outlive it. */
+	bool				copy_names;
+};
+
+static inline
+void sym_tab_construct(struct sym_tab *this, const char *buf,
+		       struct arena *arena)
+{
+	memset(this, 0, sizeof(*this));
+	this->buf = buf;
+	this->arena = arena;
+}
+
+static inline
+int sym_tab_get_pc(const struct sym_tab *this, int id)
+{
+	assert(id >= 0 && id < this->num_syms);
+	return this->syms[id].pc;
+}
+
+static inline
+int sym_tab_get_refs(const struct sym_tab *this, int id)
+{
+	assert(id >= 0 && id < this->num_syms);
+	return this->syms[id].refs;
+}
+
+static inline
+void sym_tab_set_refs(struct sym_tab *this, int id, int refs)
+{
+	assert(id >= 0 && id < this->num_syms);
+	this->syms[id].refs = refs;
+}
+
+int	sym_tab_intern(struct sym_tab *this, size_t s, int len, int *out);
+int	sym_tab_find(const struct sym_tab *this, const char *s, int len);
+int	sym_tab_define(struct sym_tab *this, int id, int pc);
+#endif
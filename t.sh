@@ -0,0 +1,7 @@
+# Build and run the checks in t/; after b.sh.
+set -e
+for t in scan soa; do
+	cc -O2 -Wall -Wextra -Wpedantic -I. t/$t.c libegasm.a -lpthread -o t/$t -g
+	./t/$t
+done
+sh t/serve.sh
@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+/*
+ * The SSE2 and AVX2 scanners give the same ends as the scalar one, for every
+ * start and end in buffers of runs that cross the 16 and 32 byte edges; and
+ * the lexer gives the same tokens with each, with # comments and padding
+ * that move the text across those edges. scan.c is included for its tables.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "main.h"
+#include "../scan.c"
+
+#define T_NUM_BUFS			200
+#define T_BUF_SIZE			256
+#define T_NUM_SHIFTS			64
+#define T_MAX_OPS			3
+
+static uint64_t t_seed = 0x2545f4914f6cdd1dull;
+
+static
+unsigned int t_rand(unsigned int n)
+{
+	t_seed ^= t_seed << 13;
+	t_seed ^= t_seed >> 7;
+	t_seed ^= t_seed << 17;
+	return (t_seed >> 32) % n;
+}
+
+/* The implementations this cpu has; the scalar one first. */
+static
+int t_get_ops(const struct scan_ops **ops)
+{
+	int n;
+
+	n = 0;
+	ops[n++] = scan_get_scalar_ops();
+#ifdef SCAN_X86
+	ops[n++] = &scan_sse2_ops;
+	if (__builtin_cpu_supports("avx2"))
+		ops[n++] = &scan_avx2_ops;
+#endif
+	return n;
+}
+
+/* Runs of one character, of up to 70, so that they cross the edges. */
+static
+void t_fill(char *buf, size_t size)
+{
+	static const char chars[] = " \t\n\r\v\f#;,.:([+-/*$aZ0_\x80\xff";
+	size_t i, n;
+	char c;
+
+	for (i = 0; i < size; i += n) {
+		c = chars[t_rand(sizeof(chars) - 1)];
+		n = t_rand(71);
+		if (n > size - i)
+			n = size - i;
+		memset(&buf[i], c, n);
+	}
+}
+
+static
+int t_check_ends(const struct scan_ops **ops, int num_ops)
+{
+	int b, k;
+	size_t i, e, r[3][T_MAX_OPS];
+	char buf[T_BUF_SIZE];
+
+	for (b = 0; b < T_NUM_BUFS; ++b) {
+		t_fill(buf, sizeof(buf));
+		for (i = 0; i < sizeof(buf); ++i) {
+			for (e = i; e <= sizeof(buf); ++e) {
+				for (k = 0; k < num_ops; ++k) {
+					r[0][k] = ops[k]->space_end(buf, i, e);
+					r[1][k] = ops[k]->token_end(buf, i, e);
+					r[2][k] = ops[k]->line_end(buf, i, e);
+				}
+				for (k = 1; k < num_ops; ++k) {
+					if (r[0][k] == r[0][0] &&
+					    r[1][k] == r[1][0] &&
+					    r[2][k] == r[2][0])
+						continue;
+					printf("scan: buf %d [%zu, %zu), ops %d: "
+					       "%zu %zu %zu, not %zu %zu %zu\n",
+					       b, i, e, k, r[0][k], r[1][k],
+					       r[2][k], r[0][0], r[1][0],
+					       r[2][0]);
+					return 1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/* A program whose lines, padding and comments move with shift. */
+static
+size_t t_put_prog(char *p, int shift)
+{
+	static const char *const lines[] = {
+		"c.alu(2) l1;",
+		"c.tc(1) cc.b(3) l2 wqm, b;",
+		"a.ixy r3.y, +-r0.x, p63.w ps1, imga, 120;",
+		"a.iz -.z/2, k3[31].z, -k0[0].x last, uem, up, 210;",
+		"t.samp r4.xyzw, ps[3][9][r2.yx00] + [1, 2, 3, 4] rim1, xn;",
+		"v.reg r1, flt3, s, fs[3][16].xyz1, r0.y drel, mf;",
+		"v.sem 200, flt2, -i, fs[1][65535].xy0_, r127.w alt, srel;",
+		"c.ret;",
+	};
+	int i, k;
+	char *s;
+
+	s = p;
+	p += sprintf(p, "%*s", shift, "");
+	for (i = 0; i < 64; ++i) {
+		p += sprintf(p, "%*s", (int)t_rand(40), "");
+		if (i == 16)
+			p += sprintf(p, "l1:%*s", (int)t_rand(3), "");
+		if (i == 40)
+			p += sprintf(p, "l2:\n");
+		p += sprintf(p, "%s", lines[t_rand(8)]);
+		p += sprintf(p, "%*s", (int)t_rand(33), "");
+		if (t_rand(2)) {
+			*p++ = '#';
+			for (k = t_rand(70); k > 0; --k)
+				*p++ = "ab #;\t:"[t_rand(7)];
+		}
+		*p++ = '\n';
+	}
+	return p - s;
+}
+
+static
+bool t_same_tokens(const struct token *t0, const struct token *t1, int n)
+{
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		if (t0[i].s != t1[i].s || t0[i].len != t1[i].len ||
+		    t0[i].val != t1[i].val || t0[i].swz != t1[i].swz ||
+		    t0[i].type != t1[i].type || t0[i].kw != t1[i].kw)
+			return false;
+	}
+	return true;
+}
+
+static
+int t_check_lex(const struct scan_ops **ops, int num_ops)
+{
+	int k, shift, err[T_MAX_OPS];
+	size_t len;
+	char *text;
+	struct asm_base as[T_MAX_OPS];
+
+	text = malloc(64 * 256);
+	if (text == NULL)
+		return 1;
+	for (k = 0; k < num_ops; ++k)
+		asm_base_construct(&as[k], "", 0);
+	for (shift = 0; shift < T_NUM_SHIFTS; ++shift) {
+		len = t_put_prog(text, shift);
+		for (k = 0; k < num_ops; ++k) {
+			asm_base_reset(&as[k], text, len);
+			as[k].scan = ops[k];
+			err[k] = asm_base_assemble(&as[k], NULL);
+		}
+		if (err[0]) {
+			printf("scan: shift %d: err %d\n", shift, err[0]);
+			return 1;
+		}
+		for (k = 1; k < num_ops; ++k) {
+			if (err[k] == 0 &&
+			    as[k].num_tokens == as[0].num_tokens &&
+			    as[k].num_labels == as[0].num_labels &&
+			    t_same_tokens(as[k].tokens, as[0].tokens,
+					  as[0].num_tokens) &&
+			    t_same_tokens(as[k].labels, as[0].labels,
+					  as[0].num_labels))
+				continue;
+			printf("scan: shift %d, ops %d: the tokens differ\n",
+			       shift, k);
+			return 1;
+		}
+	}
+	for (k = 0; k < num_ops; ++k)
+		asm_base_destruct(&as[k]);
+	free(text);
+	return 0;
+}
+
+int main(void)
+{
+	int num_ops;
+	const struct scan_ops *ops[T_MAX_OPS];
+
+	num_ops = t_get_ops(ops);
+	if (num_ops == 1)
+		printf("scan: only the scalar scanner on this cpu\n");
+	if (t_check_ends(ops, num_ops) || t_check_lex(ops, num_ops))
+		return 1;
+	printf("scan: ok; %d implementations\n", num_ops);
+	return 0;
+}
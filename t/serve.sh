@@ -0,0 +1,48 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-only
+# Copyright (c) 2022 Amol Surati
+
+# A truncated instruction sent to -S gets a parse error back, and the server
+# keeps serving. Run from the top, after b.sh.
+
+set -u
+A=${A:-./a.out}
+D=$(mktemp -d)
+S=$D/sock
+trap 'kill $P 2>/dev/null; rm -rf "$D"' EXIT
+
+printf '\tc.fs;\n' > "$D/bad.s"
+printf '\tc.tc(1) l1;\n\tc.ret;\nl1:\n\tt.samp r1.xyzw, ps[0][0][r1.xyzw];\n' \
+	> "$D/good.s"
+
+"$A" -S "$S" -j 1 > /dev/null &
+P=$!
+i=0
+while [ ! -S "$S" ] && [ $i -lt 50 ]; do
+	sleep 0.1
+	i=$((i + 1))
+done
+
+fail() {
+	echo "serve: $1"
+	exit 1
+}
+
+for f in bad.s good.s bad.s good.s; do
+	"$A" -r "$S" "$D/$f" > "$D/out" 2>&1
+	err=$?
+	case $f in
+	bad.s)
+		[ $err -eq 22 ] || fail "$f: exit $err, not 22"
+		grep -q '^parse err 22, line 1' "$D/out" ||
+			fail "$f: $(cat "$D/out")"
+		;;
+	good.s)
+		[ $err -eq 0 ] || fail "$f: exit $err"
+		"$A" -o bin "$D/$f" | cmp -s - "$D/out" ||
+			fail "$f: differs from a local assembly"
+		;;
+	esac
+	kill -0 $P 2>/dev/null || fail "the server is gone after $f"
+done
+echo "serve: ok"
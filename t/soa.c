@@ -0,0 +1,227 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+/*
+ * The encoders of soa_get_ops and soa_get_scalar_ops give the same words. The
+ * programs are of random ALU, TEX and VTX instructions, the formats soa
+ * encodes in steps, with random fields and flags; a line that does not
+ * assemble on its own is dropped.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "main.h"
+
+#define T_NUM_PROGS			200
+#define T_NUM_LINES			1000
+#define T_LINE_SIZE			160
+
+static uint64_t t_seed = 0x9e3779b97f4a7c15ull;
+
+static
+unsigned int t_rand(unsigned int n)
+{
+	t_seed ^= t_seed << 13;
+	t_seed ^= t_seed >> 7;
+	t_seed ^= t_seed << 17;
+	return (t_seed >> 32) % n;
+}
+
+static
+char t_sel(void)
+{
+	return "xyzw01_"[t_rand(7)];
+}
+
+static
+char t_chan(void)
+{
+	return "xyzw"[t_rand(4)];
+}
+
+/* Each of flags, at random; of those in a group, one at most. */
+static
+char *t_put_flags(char *p, const char *const *flags)
+{
+	int i, n;
+	const char *f;
+
+	for (i = 0, n = 0; flags[i]; ++i) {
+		if (t_rand(3))
+			continue;
+		f = flags[i];
+		if (strchr(f, '|'))
+			f = t_rand(2) ? f + strcspn(f, "|") + 1 : "";
+		if (*f == 0)
+			continue;
+		p += sprintf(p, "%s %.*s", n++ ? "," : "",
+			     (int)strcspn(f, "|"), f);
+	}
+	return p;
+}
+
+static
+char *t_put_src(char *p)
+{
+	if (t_rand(2))
+		*p++ = '+';
+	if (t_rand(2))
+		*p++ = '-';
+	switch (t_rand(3)) {
+	case 0:
+		p += sprintf(p, "r%u", t_rand(128));
+		break;
+	case 1:
+		p += sprintf(p, "p%u", t_rand(32));
+		break;
+	default:
+		p += sprintf(p, "k%u[%u]", t_rand(4), t_rand(32));
+		break;
+	}
+	return p + sprintf(p, ".%c", t_chan());
+}
+
+static
+void t_put_alu(char *p)
+{
+	static const char *const flags[] = {
+		"ps0|ps1", "last", "iml|img|imga", "uem", "up",
+		"021|120|102|201|210", NULL,
+	};
+	static const char *const omods[] = {"", "*2", "*4", "/2"};
+
+	p += sprintf(p, "\ta.%s ", t_rand(2) ? "ixy" : "iz");
+	if (t_rand(8))
+		p += sprintf(p, "r%u", t_rand(128));
+	else
+		*p++ = '-';
+	p += sprintf(p, ".%c%s, ", t_chan(), omods[t_rand(4)]);
+	p = t_put_src(p);
+	p += sprintf(p, ", ");
+	p = t_put_src(p);
+	p = t_put_flags(p, flags);
+	strcpy(p, ";\n");
+}
+
+static
+void t_put_tex(char *p)
+{
+	static const char *const flags[] = {
+		"alt", "srel", "drel", "fwq", "rim0|rim1", "sim0|sim1", "xn",
+		"yn", "zn", "wn", NULL,
+	};
+
+	p += sprintf(p, "\tt.samp r%u.%c%c%c%c, %s[%u][%u][r%u.%c%c%c%c]",
+		     t_rand(128), t_sel(), t_sel(), t_sel(), t_sel(),
+		     t_rand(2) ? "ps" : "vs", t_rand(32), t_rand(256),
+		     t_rand(128), t_sel(), t_sel(), t_sel(), t_sel());
+	if (t_rand(2))
+		p += sprintf(p, " + [%u, %u, %u, %u]", t_rand(32), t_rand(32),
+			     t_rand(32), t_rand(128));
+	p = t_put_flags(p, flags);
+	strcpy(p, ";\n");
+}
+
+static
+void t_put_vtx(char *p)
+{
+	static const char *const flags[] = {
+		"alt", "cbns", "mf", "ucf", "sma", "fwq", "srel", "drel", NULL,
+	};
+
+	if (t_rand(2))
+		p += sprintf(p, "\tv.reg r%u", t_rand(128));
+	else
+		p += sprintf(p, "\tv.sem %u", t_rand(256));
+	p += sprintf(p, ", %s, %s%c, fs[%u][%u].%c%c%c%c, r%u.%c",
+		     t_rand(2) ? "flt2" : "flt3", t_rand(2) ? "-" : "",
+		     "nis"[t_rand(3)], t_rand(256), t_rand(65536), t_sel(),
+		     t_sel(), t_sel(), t_sel(), t_rand(128), t_chan());
+	p = t_put_flags(p, flags);
+	strcpy(p, ";\n");
+}
+
+/* Assemble text with ops into as; the error is returned. */
+static
+int t_assemble(struct asm_base *as, const struct soa_ops *ops,
+	       const char *text, size_t len)
+{
+	asm_base_reset(as, text, len);
+	as->soa = ops;
+	return asm_base_assemble(as, NULL);
+}
+
+int main(void)
+{
+	int i, k, p, err0, err1;
+	long num_insts, num_dropped;
+	size_t len;
+	char line[T_LINE_SIZE];
+	char *text;
+	const struct inst_base *b0, *b1;
+	struct asm_base as0, as1;
+
+	if (soa_get_ops() == soa_get_scalar_ops())
+		printf("soa: only the scalar encoder on this cpu\n");
+
+	text = malloc(T_NUM_LINES * T_LINE_SIZE);
+	if (text == NULL)
+		return 1;
+	asm_base_construct(&as0, "", 0);
+	asm_base_construct(&as1, "", 0);
+	num_insts = num_dropped = 0;
+	for (p = 0; p < T_NUM_PROGS; ++p) {
+		for (i = 0, len = 0; i < T_NUM_LINES; ++i) {
+			switch (t_rand(3)) {
+			case 0:
+				t_put_alu(line);
+				break;
+			case 1:
+				t_put_tex(line);
+				break;
+			default:
+				t_put_vtx(line);
+				break;
+			}
+			if (t_assemble(&as0, soa_get_scalar_ops(), line,
+				       strlen(line))) {
+				++num_dropped;
+				continue;
+			}
+			memcpy(&text[len], line, strlen(line));
+			len += strlen(line);
+		}
+
+		err0 = t_assemble(&as0, soa_get_ops(), text, len);
+		err1 = t_assemble(&as1, soa_get_scalar_ops(), text, len);
+		if (err0 || err1 || as0.num_insts != as1.num_insts) {
+			printf("soa: prog %d: err %d and %d\n", p, err0, err1);
+			return 1;
+		}
+
+		for (i = 0; i < as0.num_insts; ++i) {
+			b0 = &as0.insts[i].base;
+			b1 = &as1.insts[i].base;
+			for (k = 0; k < b0->num_words; ++k) {
+				if (b0->w[k] == b1->w[k])
+					continue;
+				printf("soa: prog %d, inst %d, word %d: "
+				       "%08x and %08x\n", p, i, k,
+				       (uint32_t)b0->w[k], (uint32_t)b1->w[k]);
+				return 1;
+			}
+		}
+		num_insts += as0.num_insts;
+	}
+	asm_base_destruct(&as1);
+	asm_base_destruct(&as0);
+	free(text);
+	printf("soa: ok; %ld instructions, %ld lines dropped\n", num_insts,
+	       num_dropped);
+	return 0;
+}
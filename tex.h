@@ -4,105 +4,60 @@
 #ifndef TEX_H
 #define TEX_H
 
+#include "isa.h"
+
 /**** TEX_WORD0 ****/
-#define TEX_WORD0_INST_POS				0
-#define TEX_WORD0_INST_MOD_POS				5
-#define TEX_WORD0_FETCH_WHOLE_QUAD_POS			7
-#define TEX_WORD0_RSRC_ID_POS				8
-#define TEX_WORD0_SRC_GPR_POS				16
-#define TEX_WORD0_SRC_REL_POS				23
-#define TEX_WORD0_ALT_CONST_POS				24
-#define TEX_WORD0_RSRC_INDEX_MODE_POS			25
-#define TEX_WORD0_SAMPLER_INDEX_MODE_POS		27
-#define TEX_WORD0_INST_BITS				5
-#define TEX_WORD0_INST_MOD_BITS				2
-#define TEX_WORD0_FETCH_WHOLE_QUAD_BITS			1
-#define TEX_WORD0_RSRC_ID_BITS				8
-#define TEX_WORD0_SRC_GPR_BITS				7
-#define TEX_WORD0_SRC_REL_BITS				1
-#define TEX_WORD0_ALT_CONST_BITS			1
-#define TEX_WORD0_RSRC_INDEX_MODE_BITS			2
-#define TEX_WORD0_SAMPLER_INDEX_MODE_BITS		2
+#define TEX_WORD0_FIELDS(X, a)							\
+	X(a, TEX_WORD0, INST, tex_inst, 0, 5)					\
+	X(a, TEX_WORD0, INST_MOD, inst_mod, 5, 2)				\
+	X(a, TEX_WORD0, FETCH_WHOLE_QUAD, fetch_whole_quad, 7, 1)		\
+	X(a, TEX_WORD0, RSRC_ID, rsrc_id, 8, 8)					\
+	X(a, TEX_WORD0, SRC_GPR, src_gpr, 16, 7)				\
+	X(a, TEX_WORD0, SRC_REL, src_rel, 23, 1)				\
+	X(a, TEX_WORD0, ALT_CONST, alt_const, 24, 1)				\
+	X(a, TEX_WORD0, RSRC_INDEX_MODE, rsrc_index_mode, 25, 2)		\
+	X(a, TEX_WORD0, SAMPLER_INDEX_MODE, sampler_index_mode, 27, 2)
+enum { TEX_WORD0_FIELDS(ISA_CONSTS, ) };
 
 /**** TEX_WORD1 ****/
-#define TEX_WORD1_DST_GPR_POS				0
-#define TEX_WORD1_DST_REL_POS				7
-#define TEX_WORD1_DST_SEL_X_POS				9
-#define TEX_WORD1_DST_SEL_Y_POS				12
-#define TEX_WORD1_DST_SEL_Z_POS				15
-#define TEX_WORD1_DST_SEL_W_POS				18
-#define TEX_WORD1_LOD_BIAS_POS				21
-#define TEX_WORD1_COORD_TYPE_X_POS			28
-#define TEX_WORD1_COORD_TYPE_Y_POS			29
-#define TEX_WORD1_COORD_TYPE_Z_POS			30
-#define TEX_WORD1_COORD_TYPE_W_POS			31
-#define TEX_WORD1_DST_GPR_BITS				7
-#define TEX_WORD1_DST_REL_BITS				1
-#define TEX_WORD1_DST_SEL_X_BITS			3
-#define TEX_WORD1_DST_SEL_Y_BITS			3
-#define TEX_WORD1_DST_SEL_Z_BITS			3
-#define TEX_WORD1_DST_SEL_W_BITS			3
-#define TEX_WORD1_LOD_BIAS_BITS				7
-#define TEX_WORD1_COORD_TYPE_X_BITS			1
-#define TEX_WORD1_COORD_TYPE_Y_BITS			1
-#define TEX_WORD1_COORD_TYPE_Z_BITS			1
-#define TEX_WORD1_COORD_TYPE_W_BITS			1
+#define TEX_WORD1_FIELDS(X, a)							\
+	X(a, TEX_WORD1, DST_GPR, dst_gpr, 0, 7)					\
+	X(a, TEX_WORD1, DST_REL, dst_rel, 7, 1)					\
+	X(a, TEX_WORD1, DST_SEL_X, dst_sel_x, 9, 3)				\
+	X(a, TEX_WORD1, DST_SEL_Y, dst_sel_y, 12, 3)				\
+	X(a, TEX_WORD1, DST_SEL_Z, dst_sel_z, 15, 3)				\
+	X(a, TEX_WORD1, DST_SEL_W, dst_sel_w, 18, 3)				\
+	X(a, TEX_WORD1, LOD_BIAS, lod_bias, 21, 7)				\
+	X(a, TEX_WORD1, COORD_TYPE_X, coord_type_x, 28, 1)			\
+	X(a, TEX_WORD1, COORD_TYPE_Y, coord_type_y, 29, 1)			\
+	X(a, TEX_WORD1, COORD_TYPE_Z, coord_type_z, 30, 1)			\
+	X(a, TEX_WORD1, COORD_TYPE_W, coord_type_w, 31, 1)
+enum { TEX_WORD1_FIELDS(ISA_CONSTS, ) };
 
 /**** TEX_WORD2 ****/
-#define TEX_WORD2_OFFSET_X_POS				0
-#define TEX_WORD2_OFFSET_Y_POS				5
-#define TEX_WORD2_OFFSET_Z_POS				10
-#define TEX_WORD2_SAMPLER_ID_POS			15
-#define TEX_WORD2_SRC_SEL_X_POS				20
-#define TEX_WORD2_SRC_SEL_Y_POS				23
-#define TEX_WORD2_SRC_SEL_Z_POS				26
-#define TEX_WORD2_SRC_SEL_W_POS				29
-#define TEX_WORD2_OFFSET_X_BITS				5
-#define TEX_WORD2_OFFSET_Y_BITS				5
-#define TEX_WORD2_OFFSET_Z_BITS				5
-#define TEX_WORD2_SAMPLER_ID_BITS			5
-#define TEX_WORD2_SRC_SEL_X_BITS			3
-#define TEX_WORD2_SRC_SEL_Y_BITS			3
-#define TEX_WORD2_SRC_SEL_Z_BITS			3
-#define TEX_WORD2_SRC_SEL_W_BITS			3
+#define TEX_WORD2_FIELDS(X, a)							\
+	X(a, TEX_WORD2, OFFSET_X, offset_x, 0, 5)				\
+	X(a, TEX_WORD2, OFFSET_Y, offset_y, 5, 5)				\
+	X(a, TEX_WORD2, OFFSET_Z, offset_z, 10, 5)				\
+	X(a, TEX_WORD2, SAMPLER_ID, sampler_id, 15, 5)				\
+	X(a, TEX_WORD2, SRC_SEL_X, src_sel_x, 20, 3)				\
+	X(a, TEX_WORD2, SRC_SEL_Y, src_sel_y, 23, 3)				\
+	X(a, TEX_WORD2, SRC_SEL_Z, src_sel_z, 26, 3)				\
+	X(a, TEX_WORD2, SRC_SEL_W, src_sel_w, 29, 3)
+enum { TEX_WORD2_FIELDS(ISA_CONSTS, ) };
 
 #define TC_INST_SAMPLE					16
 
 struct inst_tex_w0 {
-	int				tex_inst;
-	int				inst_mod;
-	int				fetch_whole_quad;
-	int				rsrc_id;
-	int				src_gpr;
-	int				src_rel;
-	int				alt_const;
-	int				rsrc_index_mode;
-	int				sampler_index_mode;
+	TEX_WORD0_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_tex_w1 {
-	int				dst_gpr;
-	int				dst_rel;
-	int				dst_sel_x;
-	int				dst_sel_y;
-	int				dst_sel_z;
-	int				dst_sel_w;
-	int				lod_bias;
-	int				coord_type_x;
-	int				coord_type_y;
-	int				coord_type_z;
-	int				coord_type_w;
+	TEX_WORD1_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_tex_w2 {
-	int				offset_x;
-	int				offset_y;
-	int				offset_z;
-	int				sampler_id;
-	int				src_sel_x;
-	int				src_sel_y;
-	int				src_sel_z;
-	int				src_sel_w;
+	TEX_WORD2_FIELDS(ISA_MEMBER, )
 };
 
 /* Instructions */
@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+/* Fails with ENOSYS, or EPERM where disabled; the callers fall back. */
+int uring_construct(struct uring *this, unsigned int entries)
+{
+	int err;
+	long fd;
+	char *sq, *cq;
+	struct io_uring_params p;
+
+	memset(this, 0, sizeof(*this));
+	memset(&p, 0, sizeof(p));
+	fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (fd < 0)
+		return errno;
+	this->fd = fd;
+
+	this->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	this->cq_ring_size = p.cq_off.cqes +
+		p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (this->cq_ring_size > this->sq_ring_size)
+			this->sq_ring_size = this->cq_ring_size;
+		this->cq_ring_size = this->sq_ring_size;
+	}
+	this->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	sq = mmap(NULL, this->sq_ring_size, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (sq == MAP_FAILED)
+		goto fail;
+	this->sq_ring = sq;
+
+	cq = sq;
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+		cq = mmap(NULL, this->cq_ring_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (cq == MAP_FAILED)
+			goto fail;
+	}
+	this->cq_ring = cq;
+
+	this->sqes = mmap(NULL, this->sqes_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (this->sqes == MAP_FAILED) {
+		this->sqes = NULL;
+		goto fail;
+	}
+
+	this->sq_head = (unsigned int *)(sq + p.sq_off.head);
+	this->sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+	this->sq_array = (unsigned int *)(sq + p.sq_off.array);
+	this->sq_mask = *(unsigned int *)(sq + p.sq_off.ring_mask);
+	this->sq_entries = p.sq_entries;
+	this->sq_queued = *this->sq_tail;
+
+	this->cq_head = (unsigned int *)(cq + p.cq_off.head);
+	this->cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+	this->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	this->cq_mask = *(unsigned int *)(cq + p.cq_off.ring_mask);
+	return 0;
+fail:
+	err = errno;
+	uring_destruct(this);
+	return err;
+}
+
+void uring_destruct(struct uring *this)
+{
+	if (this->sqes)
+		munmap(this->sqes, this->sqes_size);
+	if (this->cq_ring && this->cq_ring != this->sq_ring)
+		munmap(this->cq_ring, this->cq_ring_size);
+	if (this->sq_ring)
+		munmap(this->sq_ring, this->sq_ring_size);
+	close(this->fd);
+	memset(this, 0, sizeof(*this));
+	this->fd = -1;
+}
+
+/* For IORING_OP_READ_FIXED, by index into iov. */
+int uring_register_buffers(struct uring *this, const struct iovec *iov,
+			   unsigned int n)
+{
+	if (syscall(__NR_io_uring_register, this->fd, IORING_REGISTER_BUFFERS,
+		    iov, n))
+		return errno;
+	return 0;
+}
+
+/* A cleared entry, queued; NULL if the queue is full. */
+struct io_uring_sqe *uring_get_sqe(struct uring *this)
+{
+	unsigned int i;
+	struct io_uring_sqe *sqe;
+
+	if (this->sq_queued - __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE) >=
+	    this->sq_entries)
+		return NULL;
+	i = this->sq_queued & this->sq_mask;
+	sqe = &this->sqes[i];
+	memset(sqe, 0, sizeof(*sqe));
+	this->sq_array[i] = i;
+	++this->sq_queued;
+	return sqe;
+}
+
+/* Submit what is queued, and wait for at least wait_nr completions. */
+int uring_submit(struct uring *this, unsigned int wait_nr)
+{
+	long ret;
+	unsigned int n;
+
+	__atomic_store_n(this->sq_tail, this->sq_queued, __ATOMIC_RELEASE);
+	for (;;) {
+		/* Those not yet taken, after a signal, too. */
+		n = this->sq_queued -
+			__atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+		ret = syscall(__NR_io_uring_enter, this->fd, n, wait_nr,
+			      wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (ret >= 0 || errno != EINTR)
+			break;
+	}
+	return ret < 0 ? errno : 0;
+}
+
+/*
+ * Drop the last submission the kernel has not yet taken, and return it; NULL
+ * if it has taken them all.
+ */
+struct io_uring_sqe *uring_unqueue(struct uring *this)
+{
+	if (this->sq_queued == __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE))
+		return NULL;
+	--this->sq_queued;
+	__atomic_store_n(this->sq_tail, this->sq_queued, __ATOMIC_RELEASE);
+	return &this->sqes[this->sq_queued & this->sq_mask];
+}
+
+/* The oldest completion not yet seen; NULL if none. */
+struct io_uring_cqe *uring_peek(struct uring *this)
+{
+	unsigned int head;
+
+	head = *this->cq_head;
+	if (head == __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE))
+		return NULL;
+	return &this->cqes[head & this->cq_mask];
+}
+
+void uring_seen(struct uring *this)
+{
+	__atomic_store_n(this->cq_head, *this->cq_head + 1, __ATOMIC_RELEASE);
+}
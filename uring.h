@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/*
+ * An io_uring, by the raw system calls; one thread submits and reaps. The
+ * submissions are queued by uring_get_sqe, and go to the kernel together
+ * with the next uring_submit.
+ */
+struct uring {
+	unsigned int			*sq_head;
+	unsigned int			*sq_tail;
+	unsigned int			*sq_array;
+	struct io_uring_sqe		*sqes;
+	unsigned int			sq_mask;
+	unsigned int			sq_entries;
+	unsigned int			sq_queued;	/* Our tail */
+
+	unsigned int			*cq_head;
+	unsigned int			*cq_tail;
+	struct io_uring_cqe		*cqes;
+	unsigned int			cq_mask;
+
+	void				*sq_ring;
+	void				*cq_ring;
+	size_t				sq_ring_size;
+	size_t				cq_ring_size;
+	size_t				sqes_size;
+	int				fd;
+};
+
+int	uring_construct(struct uring *this, unsigned int entries);
+void	uring_destruct(struct uring *this);
+int	uring_register_buffers(struct uring *this, const struct iovec *iov,
+			       unsigned int n);
+struct io_uring_sqe	*uring_get_sqe(struct uring *this);
+int	uring_submit(struct uring *this, unsigned int wait_nr);
+struct io_uring_sqe	*uring_unqueue(struct uring *this);
+struct io_uring_cqe	*uring_peek(struct uring *this);
+void	uring_seen(struct uring *this);
+#endif
@@ -4,56 +4,47 @@
 #ifndef VTX_H
 #define VTX_H
 
+#include "isa.h"
+
 /**** VTX_WORD0 ****/
-#define VTX_WORD0_INST_POS				0
-#define VTX_WORD0_FETCH_TYPE_POS			5
-#define VTX_WORD0_FETCH_WHOLE_QUAD_POS			7
-#define VTX_WORD0_BUF_ID_POS				8
-#define VTX_WORD0_SRC_GPR_POS				16
-#define VTX_WORD0_SRC_REL_POS				23
-#define VTX_WORD0_SRC_SEL_X_POS				24
-#define VTX_WORD0_MEGA_FETCH_COUNT_POS			26
-#define VTX_WORD0_INST_BITS				5
-#define VTX_WORD0_FETCH_TYPE_BITS			2
-#define VTX_WORD0_FETCH_WHOLE_QUAD_BITS			1
-#define VTX_WORD0_BUF_ID_BITS				8
-#define VTX_WORD0_SRC_GPR_BITS				7
-#define VTX_WORD0_SRC_REL_BITS				1
-#define VTX_WORD0_SRC_SEL_X_BITS			2
-#define VTX_WORD0_MEGA_FETCH_COUNT_BITS			6
+#define VTX_WORD0_FIELDS(X, a)							\
+	X(a, VTX_WORD0, INST, vc_inst, 0, 5)					\
+	X(a, VTX_WORD0, FETCH_TYPE, fetch_type, 5, 2)				\
+	X(a, VTX_WORD0, FETCH_WHOLE_QUAD, fetch_whole_quad, 7, 1)		\
+	X(a, VTX_WORD0, BUF_ID, buffer_id, 8, 8)				\
+	X(a, VTX_WORD0, SRC_GPR, src_gpr, 16, 7)				\
+	X(a, VTX_WORD0, SRC_REL, src_rel, 23, 1)				\
+	X(a, VTX_WORD0, SRC_SEL_X, src_sel_x, 24, 2)				\
+	X(a, VTX_WORD0, MEGA_FETCH_COUNT, mega_fetch_count, 26, 6)
+enum { VTX_WORD0_FIELDS(ISA_CONSTS, ) };
 
 #define VC_INST_FETCH					0
 #define VC_INST_SEMANTIC				1
 
 /**** VTX_WORD1_GPR ****/
-#define VTX_WORD1_GPR_DST_GPR_POS			0
-#define VTX_WORD1_GPR_DST_REL_POS			7
-#define VTX_WORD1_GPR_DST_GPR_BITS			7
-#define VTX_WORD1_GPR_DST_REL_BITS			1
+#define VTX_WORD1_GPR_FIELDS(X, a)						\
+	X(a, VTX_WORD1_GPR, DST_GPR, dst_gpr, 0, 7)				\
+	X(a, VTX_WORD1_GPR, DST_REL, dst_rel, 7, 1)
+enum { VTX_WORD1_GPR_FIELDS(ISA_CONSTS, ) };
 
 /**** VTX_WORD1_SEM ****/
-#define VTX_WORD1_SEM_ID_POS				0
-#define VTX_WORD1_SEM_ID_BITS				8
+#define VTX_WORD1_SEM_FIELDS(X, a)						\
+	X(a, VTX_WORD1_SEM, ID, sem_id, 0, 8)
+enum { VTX_WORD1_SEM_FIELDS(ISA_CONSTS, ) };
 
 /**** VTX_WORD1 ****/
-#define VTX_WORD1_DST_SEL_X_POS				9
-#define VTX_WORD1_DST_SEL_Y_POS				12
-#define VTX_WORD1_DST_SEL_Z_POS				15
-#define VTX_WORD1_DST_SEL_W_POS				18
-#define VTX_WORD1_USE_CONST_FIELDS_POS			21
-#define VTX_WORD1_DATA_FORMAT_POS			22
-#define VTX_WORD1_NUM_FORMAT_ALL_POS			28
-#define VTX_WORD1_FORMAT_COMP_ALL_POS			30
-#define VTX_WORD1_SRF_MODE_ALL_POS			31
-#define VTX_WORD1_DST_SEL_X_BITS			3
-#define VTX_WORD1_DST_SEL_Y_BITS			3
-#define VTX_WORD1_DST_SEL_Z_BITS			3
-#define VTX_WORD1_DST_SEL_W_BITS			3
-#define VTX_WORD1_USE_CONST_FIELDS_BITS			1
-#define VTX_WORD1_DATA_FORMAT_BITS			6
-#define VTX_WORD1_NUM_FORMAT_ALL_BITS			2
-#define VTX_WORD1_FORMAT_COMP_ALL_BITS			1
-#define VTX_WORD1_SRF_MODE_ALL_BITS			1
+/* GPR or SEM, and then these. */
+#define VTX_WORD1_FIELDS(X, a)							\
+	X(a, VTX_WORD1, DST_SEL_X, dst_sel_x, 9, 3)				\
+	X(a, VTX_WORD1, DST_SEL_Y, dst_sel_y, 12, 3)				\
+	X(a, VTX_WORD1, DST_SEL_Z, dst_sel_z, 15, 3)				\
+	X(a, VTX_WORD1, DST_SEL_W, dst_sel_w, 18, 3)				\
+	X(a, VTX_WORD1, USE_CONST_FIELDS, use_const_fields, 21, 1)		\
+	X(a, VTX_WORD1, DATA_FORMAT, data_format, 22, 6)			\
+	X(a, VTX_WORD1, NUM_FORMAT_ALL, num_format_all, 28, 2)			\
+	X(a, VTX_WORD1, FORMAT_COMP_ALL, format_comp_all, 30, 1)		\
+	X(a, VTX_WORD1, SRF_MODE_ALL, srf_mode_all, 31, 1)
+enum { VTX_WORD1_FIELDS(ISA_CONSTS, ) };
 
 #define FMT_32_32_FLOAT					30
 #define FMT_32_32_32_32_FLOAT				35
@@ -68,54 +59,29 @@
 #define NUM_FORMAT_SCALED				2
 
 /**** VTX_WORD2 ****/
-#define VTX_WORD2_OFFSET_POS				0
-#define VTX_WORD2_ENDIAN_SWAP_POS			16
-#define VTX_WORD2_CONST_BUF_NO_STRIDE_POS		18
-#define VTX_WORD2_MEGA_FETCH_POS			19
-#define VTX_WORD2_ALT_CONST_POS				20
-#define VTX_WORD2_BUF_INDEX_MODE_POS			21
-#define VTX_WORD2_OFFSET_BITS				16
-#define VTX_WORD2_ENDIAN_SWAP_BITS			2
-#define VTX_WORD2_CONST_BUF_NO_STRIDE_BITS		1
-#define VTX_WORD2_MEGA_FETCH_BITS			1
-#define VTX_WORD2_ALT_CONST_BITS			1
-#define VTX_WORD2_BUF_INDEX_MODE_BITS			2
+#define VTX_WORD2_FIELDS(X, a)							\
+	X(a, VTX_WORD2, OFFSET, offset, 0, 16)					\
+	X(a, VTX_WORD2, ENDIAN_SWAP, endian_swap, 16, 2)			\
+	X(a, VTX_WORD2, CONST_BUF_NO_STRIDE, const_buf_no_stride, 18, 1)	\
+	X(a, VTX_WORD2, MEGA_FETCH, mega_fetch, 19, 1)				\
+	X(a, VTX_WORD2, ALT_CONST, alt_const, 20, 1)				\
+	X(a, VTX_WORD2, BUF_INDEX_MODE, buffer_index_mode, 21, 2)
+enum { VTX_WORD2_FIELDS(ISA_CONSTS, ) };
 
 struct inst_vtx_w0 {
-	int				vc_inst;
-	int				fetch_type;
-	int				fetch_whole_quad;
-	int				buffer_id;
-	int				src_gpr;
-	int				src_rel;
-	int				src_sel_x;
-	int				mega_fetch_count;
+	VTX_WORD0_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_vtx_w1 {
-	int				sem_id;		/* only for vtx_sem */
-
-	int				dst_gpr;	/* only for vtx_gpr */
-	int				dst_rel;
-
-	int				dst_sel_x;
-	int				dst_sel_y;
-	int				dst_sel_z;
-	int				dst_sel_w;
-	int				use_const_fields;
-	int				data_format;
-	int				num_format_all;
-	int				format_comp_all;
-	int				srf_mode_all;
+	VTX_WORD1_SEM_FIELDS(ISA_MEMBER, )	/* only for vtx_sem */
+
+	VTX_WORD1_GPR_FIELDS(ISA_MEMBER, )	/* only for vtx_gpr */
+
+	VTX_WORD1_FIELDS(ISA_MEMBER, )
 };
 
 struct inst_vtx_w2 {
-	int				offset;
-	int				endian_swap;
-	int				const_buf_no_stride;
-	int				mega_fetch;
-	int				alt_const;
-	int				buffer_index_mode;
+	VTX_WORD2_FIELDS(ISA_MEMBER, )
 };
 
 /* Instructions */
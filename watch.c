@@ -0,0 +1,289 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* Copyright (c) 2022 Amol Surati */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "main.h"
+#include "cli.h"
+
+#define WATCH_SETTLE_MS			20	/* For the events of one save */
+#define WATCH_EVENTS_SIZE		4096
+
+struct watch {
+	const struct cli_opts		*opts;
+	const char			*path;
+	const char			*name;	/* Within its directory */
+	const char			*out;
+	struct asm_inc			inc;
+	struct out_buf			ob;	/* For hex */
+	int				fd;	/* Of out, for bin */
+};
+
+static
+double watch_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static
+int watch_pwrite_all(int fd, const char *p, size_t n, off_t off)
+{
+	ssize_t ret;
+
+	while (n) {
+		ret = pwrite(fd, p, n, off);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return errno;
+		p += ret;
+		n -= ret;
+		off += ret;
+	}
+	return 0;
+}
+
+/* The words of an instruction, little-endian; returns the end. */
+static
+char *watch_put_words(char *p, const struct inst_base *base)
+{
+	int i;
+	uint32_t w;
+
+	for (i = 0; i < base->num_words; ++i) {
+		w = base->w[i];
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		w = __builtin_bswap32(w);
+#endif
+		memcpy(p, &w, sizeof(w));
+		p += sizeof(w);
+	}
+	return p;
+}
+
+/*
+ * The binary is rewritten in place: only the words that changed, and, should
+ * the pcs have moved, everything from the edit on.
+ */
+static
+int watch_write_bin(struct watch *this)
+{
+	int i, err;
+	off_t off;
+	size_t size;
+	char *buf, *p, words[16];
+	const struct asm_inc *inc;
+	const struct inst_base *base;
+
+	inc = &this->inc;
+	for (i = 0; i < inc->num_dirty; ++i) {
+		if (inc->moved && inc->dirty[i] >= inc->first)
+			break;
+		base = &inc->as.insts[inc->dirty[i]].base;
+		p = watch_put_words(words, base);
+		err = watch_pwrite_all(this->fd, words, p - words,
+				       (off_t)base->pc * 8);
+		if (err)
+			return err;
+	}
+	if (!inc->moved)
+		return 0;
+
+	for (i = inc->first, size = 0; i < inc->as.num_insts; ++i)
+		size += inc->as.insts[i].base.num_words * sizeof(uint32_t);
+	buf = malloc(size + 1);
+	if (buf == NULL)
+		return ENOMEM;
+	for (i = inc->first, p = buf; i < inc->as.num_insts; ++i)
+		p = watch_put_words(p, &inc->as.insts[i].base);
+
+	/* Where the first instruction from the edit on goes. */
+	off = 0;
+	if (inc->first > 0) {
+		base = &inc->as.insts[inc->first - 1].base;
+		off = ((off_t)base->pc * 2 + base->num_words) *
+			sizeof(uint32_t);
+	}
+	err = watch_pwrite_all(this->fd, buf, p - buf, off);
+	if (!err && ftruncate(this->fd, off + (p - buf)))
+		err = errno;
+	free(buf);
+	return err;
+}
+
+/* Text is written out whole, to a file renamed over out once complete. */
+static
+int watch_write_text(struct watch *this)
+{
+	int fd, err, ret;
+	char tmp[PATH_MAX];
+
+	ret = snprintf(tmp, sizeof(tmp), "%s.tmp", this->out);
+	if (ret < 0 || (size_t)ret >= sizeof(tmp))
+		return ENAMETOOLONG;
+
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return errno;
+	err = out_write(&this->ob, fd, this->opts->fmt, &this->inc.as, 1);
+	if (close(fd) && !err)
+		err = errno;
+	if (!err && rename(tmp, this->out))
+		err = errno;
+	if (err)
+		unlink(tmp);
+	return err;
+}
+
+/* Reassemble, and bring out up to date; errors leave it as it was. */
+static
+void watch_run(struct watch *this)
+{
+	int err;
+	double start;
+	struct input in;
+	struct egasm_diag diag;
+
+	err = input_open(&in, this->path);
+	if (err) {
+		printf("%s: %s\n", this->path, strerror(err));
+		return;
+	}
+
+	start = watch_now();
+	err = asm_inc_update(&this->inc, in.buf, in.size, &diag);
+	input_close(&in);
+	if (err && diag.err) {
+		printf("%s err %d, line %d, i = %zx, inst = %d\n", diag.stage,
+		       err, diag.line, diag.pos, diag.inst);
+		return;
+	} else if (err) {
+		printf("%s: %s\n", this->path, strerror(err));
+		return;
+	}
+
+	if (this->opts->fmt == OUT_BIN)
+		err = watch_write_bin(this);
+	else
+		err = watch_write_text(this);
+	if (err) {
+		printf("%s: %s\n", this->out, strerror(err));
+		return;
+	}
+
+	printf("%s: %d insts, %d parsed, %d changed%s, %.3f ms\n", this->path,
+	       this->inc.as.num_insts, this->inc.num_parsed,
+	       this->inc.num_dirty, this->inc.moved ? ", moved" : "",
+	       (watch_now() - start) * 1e3);
+	fflush(stdout);
+}
+
+/* Whether the events include one for the input; editors often rename. */
+static
+bool watch_is_ours(const struct watch *this, const char *buf, ssize_t len)
+{
+	const char *p;
+	const struct inotify_event *ev;
+
+	for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+		ev = (const struct inotify_event *)p;
+		if (ev->len && !strcmp(ev->name, this->name))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Assemble path into out, and again each time path is saved. Only the edited
+ * instructions are lexed and parsed again; see asm_inc.
+ */
+int watch_main(const struct cli_opts *opts, const char *path, const char *out)
+{
+	int ifd, err;
+	bool ours;
+	ssize_t len;
+	char dir[PATH_MAX], *slash;
+	_Alignas(struct inotify_event) char events[WATCH_EVENTS_SIZE];
+	struct pollfd pfd;
+	struct watch w;
+
+	memset(&w, 0, sizeof(w));
+	w.opts = opts;
+	w.path = path;
+	w.out = out;
+	w.fd = -1;
+
+	if (strlen(path) >= sizeof(dir))
+		return ENAMETOOLONG;
+	strcpy(dir, path);
+	slash = strrchr(dir, '/');
+	w.name = slash ? &path[slash - dir + 1] : path;
+	if (slash == NULL)
+		strcpy(dir, ".");
+	else if (slash == dir)
+		dir[1] = 0;
+	else
+		*slash = 0;
+
+	ifd = inotify_init1(IN_CLOEXEC);
+	if (ifd < 0)
+		return errno;
+	if (inotify_add_watch(ifd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		err = errno;
+		goto close;
+	}
+
+	err = asm_inc_construct(&w.inc);
+	if (err)
+		goto close;
+	if (opts->fmt == OUT_HEX)
+		err = out_buf_construct(&w.ob);
+	if (!err && opts->fmt == OUT_BIN) {
+		w.fd = open(out, O_RDWR | O_CREAT, 0666);
+		err = w.fd < 0 ? errno : 0;
+	}
+	if (err)
+		goto inc;
+
+	pfd.fd = ifd;
+	pfd.events = POLLIN;
+	for (watch_run(&w);;) {
+		/* Wait for a save, and then for it to settle. */
+		ours = false;
+		do {
+			len = read(ifd, events, sizeof(events));
+			if (len < 0 && errno == EINTR)
+				continue;
+			if (len < 0) {
+				err = errno;
+				goto out;
+			}
+			ours = ours || watch_is_ours(&w, events, len);
+		} while (!ours || poll(&pfd, 1, WATCH_SETTLE_MS) > 0);
+		watch_run(&w);
+	}
+out:
+	if (w.fd >= 0)
+		close(w.fd);
+	if (opts->fmt == OUT_HEX)
+		out_buf_destruct(&w.ob);
+inc:
+	asm_inc_destruct(&w.inc);
+close:
+	close(ifd);
+	return err;
+}